@@ -2,6 +2,20 @@
 #include "../mat.h"
 #include "../quat.h"
 #include "../maths.h"
+#include "../binary.h"
+#include "../point_cloud.h"
+#include "../parallel.h"
+#include "../occlusion.h"
+#include "../colour.h"
+#include "../noise.h"
+#include "../sampling.h"
+#include "../curves.h"
+#include "../spatial.h"
+#include "../kdtree.h"
+#include "../octree.h"
+#include "../rtree.h"
+#include "../voxel.h"
+#include "../isosurface.h"
 #include <stdio.h>
 
 #define CATCH_CONFIG_MAIN
@@ -3320,3 +3334,2599 @@ TEST_CASE( "Barycentric 3D", "[maths]")
         REQUIRE(require_func(bary, fratio));
     }
 }
+
+TEST_CASE( "Binary Container", "[binary]")
+{
+    const char* filename = "binary_container_test.bin";
+
+    std::vector<vec3f> points;
+    for(u32 i = 0; i < 1000; ++i)
+        points.push_back(vec3f((f32)i, (f32)i * 0.5f, (f32)i * -2.0f));
+
+    std::vector<mat4> mats;
+    mats.push_back(mat4::create_identity());
+    mats.push_back(mat::create_translation(vec3f(1.0f, 2.0f, 3.0f)));
+
+    std::vector<quat> quats;
+    quats.push_back(quat(0.1f, 0.2f, 0.3f));
+
+    {
+        binary_writer writer;
+        REQUIRE(writer.open(filename));
+        REQUIRE(writer.write_section("points", points));
+        REQUIRE(writer.write_section("points_soa", points, SOA));
+        REQUIRE(writer.write_section("mats", mats));
+        REQUIRE(writer.write_section("quats", quats));
+
+        // stream in chunks
+        REQUIRE(writer.begin_section<vec3f>("streamed_soa", SOA, points.size()));
+        for(size_t i = 0; i < points.size(); i += 300)
+            REQUIRE(writer.append(&points[i], min<size_t>(300, points.size() - i)));
+        REQUIRE(writer.end_section());
+
+        // mismatched type is rejected
+        REQUIRE(writer.begin_section<vec2f>("rejected"));
+        REQUIRE(!writer.append(&points[0], 1));
+        REQUIRE(writer.end_section());
+
+        REQUIRE(writer.close());
+    }
+
+    {
+        binary_file file;
+        REQUIRE(file.open(filename));
+        REQUIRE(file.section_count() == 6);
+
+        typed_span<const vec3f> aos = file.get<vec3f>("points");
+        REQUIRE(aos.size() == points.size());
+        REQUIRE(((size_t)aos.data % k_binary_alignment) == 0);
+        for(size_t i = 0; i < points.size(); ++i)
+            REQUIRE(aos[i] == points[i]);
+
+        // type and layout mismatches return empty spans
+        REQUIRE(file.get<vec4f>("points").empty());
+        REQUIRE(file.get<vec3f>("points_soa").empty());
+        REQUIRE(file.get<vec3f>("missing").empty());
+
+        const char* soa_names[] = { "points_soa", "streamed_soa" };
+        for(auto name : soa_names)
+        {
+            for(size_t c = 0; c < 3; ++c)
+            {
+                typed_span<const f32> comp = file.get_component<vec3f>(name, c);
+                REQUIRE(comp.size() == points.size());
+                REQUIRE(((size_t)comp.data % k_binary_alignment) == 0);
+                for(size_t i = 0; i < points.size(); ++i)
+                    REQUIRE(comp[i] == points[i][c]);
+            }
+            REQUIRE(file.get_component<vec3f>(name, 3).empty());
+        }
+
+        typed_span<const mat4> m = file.get<mat4>("mats");
+        REQUIRE(m.size() == 2);
+        REQUIRE(m[1] == mats[1]);
+
+        typed_span<const quat> q = file.get<quat>("quats");
+        REQUIRE(q.size() == 1);
+        for(size_t i = 0; i < 4; ++i)
+            REQUIRE(q[0].v[i] == quats[0].v[i]);
+    }
+
+    // corrupt section tables are rejected on open instead of handing out spans past the end of the mapping
+    {
+        FILE* fp = fopen(filename, "rb");
+        REQUIRE(fp);
+        fseek(fp, 0, SEEK_END);
+        std::vector<u8> bytes((size_t)ftell(fp));
+        fseek(fp, 0, SEEK_SET);
+        REQUIRE(fread(bytes.data(), 1, bytes.size(), fp) == bytes.size());
+        fclose(fp);
+
+        binary_header header;
+        memcpy(&header, bytes.data(), sizeof(header));
+
+        const char* corrupt_filename = "binary_container_corrupt.bin";
+        auto open_bytes = [&](const std::vector<u8>& patched) {
+            FILE* out = fopen(corrupt_filename, "wb");
+            fwrite(patched.data(), 1, patched.size(), out);
+            fclose(out);
+
+            binary_file file;
+            bool ok = file.open(corrupt_filename);
+            remove(corrupt_filename);
+            return ok;
+        };
+
+        auto open_patched = [&](size_t section, std::function<void(binary_section&)> patch) {
+            std::vector<u8> patched = bytes;
+            binary_section s;
+            size_t at = (size_t)header.table_offset + section * sizeof(binary_section);
+            memcpy(&s, &patched[at], sizeof(s));
+            patch(s);
+            memcpy(&patched[at], &s, sizeof(s));
+            return open_bytes(patched);
+        };
+
+        auto open_patched_header = [&](std::function<void(binary_header&)> patch) {
+            std::vector<u8> patched = bytes;
+            binary_header h = header;
+            patch(h);
+            memcpy(patched.data(), &h, sizeof(h));
+            return open_bytes(patched);
+        };
+
+        // header version and size must match what the writer produced
+        REQUIRE(open_patched_header([](binary_header&) {}));
+        REQUIRE(!open_patched_header([](binary_header& h) { h.version = 0; }));
+        REQUIRE(!open_patched_header([](binary_header& h) { h.version = k_binary_version + 1; }));
+        REQUIRE(!open_patched_header([](binary_header& h) { h.file_size += 1; }));
+        REQUIRE(!open_patched_header([](binary_header& h) { h.file_size -= 1; }));
+
+        std::vector<u8> truncated(bytes.begin(), bytes.end() - 1);
+        REQUIRE(!open_bytes(truncated));
+        std::vector<u8> extended = bytes;
+        extended.push_back(0);
+        REQUIRE(!open_bytes(extended));
+
+        // sections 0 "points" is aos, 1 "points_soa" is soa
+        REQUIRE(open_patched(0, [](binary_section&) {}));
+        REQUIRE(!open_patched(0, [](binary_section& s) { s.count += 1; }));
+        REQUIRE(!open_patched(0, [](binary_section& s) { s.count = UINT64_MAX / 8; }));
+        REQUIRE(!open_patched(0, [](binary_section& s) { s.element_size = 4; }));
+        REQUIRE(!open_patched(0, [](binary_section& s) { s.offset += 4; }));
+        REQUIRE(!open_patched(0, [](binary_section& s) { s.size = UINT64_MAX - s.offset + 1; }));
+        REQUIRE(!open_patched(1, [](binary_section& s) { s.count = s.stride / sizeof(f32) + 1; }));
+        REQUIRE(!open_patched(1, [](binary_section& s) { s.stride *= 2; }));
+        REQUIRE(!open_patched(1, [](binary_section& s) { s.stride += 4; }));
+        REQUIRE(!open_patched(1, [](binary_section& s) { s.scalar = 100; }));
+        REQUIRE(!open_patched(1, [](binary_section& s) { s.layout = 2; }));
+    }
+
+    remove(filename);
+}
+
+namespace
+{
+    vec3f point_cloud_test_point(u32 i)
+    {
+        return vec3f((f32)i, (f32)(i % 100) * 0.25f, -(f32)i * 0.5f);
+    }
+
+    template<typename T>
+    void write_swapped(FILE* fp, T v, bool swap)
+    {
+        u8 bytes[sizeof(T)];
+        memcpy(bytes, &v, sizeof(T));
+        if(swap)
+            std::reverse(bytes, bytes + sizeof(T));
+        fwrite(bytes, 1, sizeof(T), fp);
+    }
+
+    bool check_point_cloud(const char* filename, u32 num_points, e_point_cloud_format format)
+    {
+        point_cloud_reader reader;
+        if(!reader.open(filename) || reader.format() != format)
+            return false;
+
+        static point_block block;
+        u32 total = 0;
+        while(reader.read(block))
+        {
+            for(size_t i = 0; i < block.count; ++i)
+                if(!(block.get(i) == point_cloud_test_point(total + (u32)i)))
+                    return false;
+            total += (u32)block.count;
+        }
+        return !reader.error() && total == num_points;
+    }
+}
+
+TEST_CASE( "Point Cloud Reader", "[point_cloud]")
+{
+    const char* filename = "point_cloud_test.ply";
+    const u32   num_points = (u32)k_point_block_size * 2 + 17;
+
+    // xyz with comments, blank lines and extra columns
+    FILE* fp = fopen(filename, "wb");
+    fprintf(fp, "# comment\n\n");
+    for(u32 i = 0; i < num_points; ++i)
+    {
+        vec3f p = point_cloud_test_point(i);
+        fprintf(fp, "%f %f %f 255 0 0\n", p.x, p.y, p.z);
+    }
+    fclose(fp);
+    REQUIRE(check_point_cloud(filename, num_points, POINT_CLOUD_XYZ));
+
+    // ascii ply with properties before and after xyz and a face element
+    fp = fopen(filename, "wb");
+    fprintf(fp, "ply\nformat ascii 1.0\ncomment test\nelement vertex %u\n", num_points);
+    fprintf(fp, "property uchar red\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\n");
+    fprintf(fp, "element face 1\nproperty list uchar int vertex_indices\nend_header\n");
+    for(u32 i = 0; i < num_points; ++i)
+    {
+        vec3f p = point_cloud_test_point(i);
+        fprintf(fp, "7 %f %f %f 1.0\n", p.x, p.y, p.z);
+    }
+    fprintf(fp, "3 0 1 2\n");
+    fclose(fp);
+    REQUIRE(check_point_cloud(filename, num_points, POINT_CLOUD_PLY_ASCII));
+
+    // binary little and big endian, with mixed types and an element before the vertices
+    for(u32 be = 0; be < 2; ++be)
+    {
+        bool swap = be == 1;
+        fp = fopen(filename, "wb");
+        fprintf(fp, "ply\nformat %s 1.0\n", be ? "binary_big_endian" : "binary_little_endian");
+        fprintf(fp, "element camera 2\nproperty float fov\nproperty uchar id\n");
+        fprintf(fp, "element vertex %u\nproperty double x\nproperty float y\nproperty uchar pad\nproperty float z\n", num_points);
+        fprintf(fp, "end_header\n");
+        for(u32 c = 0; c < 2; ++c)
+        {
+            write_swapped(fp, 90.0f, swap);
+            write_swapped(fp, (u8)c, swap);
+        }
+        for(u32 i = 0; i < num_points; ++i)
+        {
+            vec3f p = point_cloud_test_point(i);
+            write_swapped(fp, (f64)p.x, swap);
+            write_swapped(fp, p.y, swap);
+            write_swapped(fp, (u8)0xff, swap);
+            write_swapped(fp, p.z, swap);
+        }
+        fclose(fp);
+        REQUIRE(check_point_cloud(filename, num_points, be ? POINT_CLOUD_PLY_BINARY_BE : POINT_CLOUD_PLY_BINARY_LE));
+    }
+
+    // binary float fast path, truncated data is reported as an error
+    fp = fopen(filename, "wb");
+    fprintf(fp, "ply\nformat binary_little_endian 1.0\nelement vertex %u\n", num_points);
+    fprintf(fp, "property float x\nproperty float y\nproperty float z\nend_header\n");
+    for(u32 i = 0; i < num_points; ++i)
+    {
+        vec3f p = point_cloud_test_point(i);
+        fwrite(&p.v[0], sizeof(f32), 3, fp);
+    }
+    fclose(fp);
+    REQUIRE(check_point_cloud(filename, num_points, POINT_CLOUD_PLY_BINARY_LE));
+    REQUIRE(!check_point_cloud(filename, num_points + 1, POINT_CLOUD_PLY_BINARY_LE));
+
+    remove(filename);
+}
+
+TEST_CASE( "Parallel For", "[parallel]")
+{
+    thread_pool pool(4);
+    serial_executor serial;
+    REQUIRE(pool.num_threads() == 4);
+
+    // every element visited exactly once, chunk boundaries independent of the executor
+    const size_t count = 100003;
+    const size_t chunk = 1000;
+    std::vector<u32> visits(count, 0);
+    std::vector<f64> chunk_sums(parallel_chunk_count(count, chunk), 0.0);
+    std::atomic<size_t> misaligned{0};
+    parallel_for(pool, count, chunk, [&](size_t begin, size_t end) {
+        misaligned += begin % chunk;
+        for(size_t i = begin; i < end; ++i)
+        {
+            visits[i]++;
+            chunk_sums[begin / chunk] += sqrt((f64)i);
+        }
+    });
+
+    bool all_once = true;
+    for(auto v : visits)
+        all_once &= v == 1;
+    REQUIRE(all_once);
+    REQUIRE(misaligned == 0);
+
+    std::vector<f64> serial_sums(chunk_sums.size(), 0.0);
+    parallel_for(serial, count, chunk, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i)
+            serial_sums[begin / chunk] += sqrt((f64)i);
+    });
+    REQUIRE(serial_sums == chunk_sums);
+
+    // nested parallel_for runs serially instead of deadlocking
+    std::atomic<size_t> nested{0};
+    parallel_for(pool, 8, 1, [&](size_t, size_t) {
+        parallel_for(pool, 10, 3, [&](size_t begin, size_t end) {
+            nested += end - begin;
+        });
+    });
+    REQUIRE(nested == 80);
+
+    // a throwing task is rethrown once the workers stop, and later runs are still parallel
+    std::atomic<size_t> ran{0};
+    bool threw = false;
+    try
+    {
+        pool.run(64, [&](size_t i) {
+            ran++;
+            if(i == 0)
+                throw std::runtime_error("task failed");
+        });
+    }
+    catch(const std::runtime_error&)
+    {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(ran >= 1);
+
+    auto distinct_threads = [](executor& exec, size_t num_tasks) {
+        std::mutex ids_mutex;
+        std::vector<std::thread::id> ids;
+        exec.run(num_tasks, [&](size_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            std::lock_guard<std::mutex> lock(ids_mutex);
+            if(std::find(ids.begin(), ids.end(), std::this_thread::get_id()) == ids.end())
+                ids.push_back(std::this_thread::get_id());
+        });
+        return ids.size();
+    };
+    REQUIRE(distinct_threads(pool, 32) > 1);
+
+    // a nested run on a different pool is not forced serial, and nesting back into the outer pool does not deadlock
+    thread_pool outer(2);
+    size_t inner_threads[2] = {0, 0};
+    std::atomic<size_t> round_trip{0};
+    outer.run(2, [&](size_t i) {
+        inner_threads[i] = distinct_threads(pool, 32);
+        pool.run(4, [&](size_t) {
+            outer.run(3, [&](size_t) { round_trip++; });
+        });
+    });
+    REQUIRE(max(inner_threads[0], inner_threads[1]) > 1);
+    REQUIRE(round_trip == 24);
+}
+
+TEST_CASE( "Parallel Batch Functions", "[parallel]")
+{
+    thread_pool pool(3);
+    srand(4455);
+
+    const size_t count = 10000;
+    std::vector<vec3f> pos(count), extent(count);
+    std::vector<f32> radius(count);
+    std::vector<vec2f> points(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        pos[i] = vec3f((f32)(rand() % 400) - 200.0f, (f32)(rand() % 400) - 200.0f, (f32)(rand() % 400) - 200.0f);
+        extent[i] = vec3f((f32)(rand() % 20) + 1.0f, (f32)(rand() % 20) + 1.0f, (f32)(rand() % 20) + 1.0f);
+        radius[i] = (f32)(rand() % 20) + 1.0f;
+        points[i] = vec2f((f32)(rand() % 100), (f32)(rand() % 100));
+    }
+
+    mat4 view = mat::create_translation(vec3f(0.0f, 0.0f, -50.0f));
+    mat4 proj = mat::create_perspective_projection(-0.5f, 0.5f, -0.5f, 0.5f, 0.1f, 500.0f);
+    mat4 view_proj = proj * view;
+    vec4f planes[6];
+    get_frustum_planes_from_matrix(view_proj, &planes[0]);
+
+    std::unique_ptr<bool[]> aabb_inside(new bool[count]);
+    std::unique_ptr<bool[]> sphere_inside(new bool[count]);
+    std::unique_ptr<bool[]> poly_inside(new bool[count]);
+    std::vector<vec3f> transformed(count);
+
+    std::vector<vec2f> poly = { {10.0f, 10.0f}, {90.0f, 20.0f}, {50.0f, 50.0f}, {80.0f, 90.0f}, {5.0f, 70.0f} };
+
+    aabb_vs_frustum(pool, pos.data(), extent.data(), count, &planes[0], aabb_inside.get(), 512);
+    sphere_vs_frustum(pool, pos.data(), radius.data(), count, &planes[0], sphere_inside.get(), 512);
+    point_inside_poly(pool, points.data(), count, poly, poly_inside.get(), 512);
+    transform_points(pool, view_proj, pos.data(), count, transformed.data(), 512);
+
+    bool match = true;
+    u32  num_inside = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        match &= aabb_inside[i] == aabb_vs_frustum(pos[i], extent[i], &planes[0]);
+        match &= sphere_inside[i] == sphere_vs_frustum(pos[i], radius[i], &planes[0]);
+        match &= poly_inside[i] == point_inside_poly(points[i], poly);
+        match &= require_func(transformed[i], view_proj.transform_vector(pos[i]));
+        num_inside += aabb_inside[i] ? 1 : 0;
+    }
+    REQUIRE(match);
+    REQUIRE(num_inside > 0);
+    REQUIRE(num_inside < count);
+}
+
+TEST_CASE( "Parallel Convex Hull", "[parallel]")
+{
+    thread_pool pool(4);
+    srand(6677);
+
+    std::vector<vec2f> points;
+    for(u32 i = 0; i < 200000; ++i)
+    {
+        // points in a disc, so the hull has many vertices
+        f32 a = (f32)(rand() % 10000) / 10000.0f * (f32)M_TWO_PI;
+        f32 r = sqrt((f32)(rand() % 10000) / 10000.0f) * 100.0f;
+        points.push_back(vec2f(cos(a) * r + 50.0f, sin(a) * r - 20.0f));
+    }
+
+    std::vector<vec2f> hull;
+    convex_hull_from_points(pool, hull, points, 10000);
+    REQUIRE(hull.size() > 8);
+
+    // same result regardless of executor and chunk size
+    serial_executor serial;
+    std::vector<vec2f> serial_hull;
+    convex_hull_from_points(serial, serial_hull, points, 3333);
+    REQUIRE(serial_hull.size() == hull.size());
+    for(size_t i = 0; i < hull.size(); ++i)
+        REQUIRE(serial_hull[i] == hull[i]);
+
+    // every input point is inside or on the hull
+    bool all_inside = true;
+    for(auto& p : points)
+    {
+        for(size_t i = 0; i < hull.size(); ++i)
+        {
+            vec2f a = hull[i];
+            vec2f b = hull[(i + 1) % hull.size()];
+            all_inside &= cross(b - a, p - a) >= -0.001f;
+        }
+    }
+    REQUIRE(all_inside);
+
+    // compatible with point_inside_convex_hull
+    REQUIRE(point_inside_convex_hull(vec2f(50.0f, -20.0f), hull));
+    REQUIRE(point_inside_convex_hull(vec2f(100.0f, -20.0f), hull));
+    REQUIRE(!point_inside_convex_hull(vec2f(200.0f, -20.0f), hull));
+    REQUIRE(!point_inside_convex_hull(vec2f(50.0f, 90.0f), hull));
+
+    // matches the winding of the single threaded hull
+    std::vector<vec2f> square = { {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}, {0.5f, 0.5f}, {0.2f, 0.7f} };
+    std::vector<vec2f> hull_a, hull_b;
+    convex_hull_from_points(hull_a, square);
+    convex_hull_from_points(pool, hull_b, square);
+    REQUIRE(hull_a.size() == 4);
+    REQUIRE(hull_b.size() == 4);
+    size_t offset = 0;
+    while(!(hull_b[offset] == hull_a[0]))
+        ++offset;
+    for(size_t i = 0; i < 4; ++i)
+        REQUIRE(hull_a[i] == hull_b[(i + offset) % 4]);
+}
+
+TEST_CASE( "Occlusion Buffer", "[occlusion]")
+{
+    // camera at the origin looking down -z
+    mat4 proj = mat::create_perspective_projection_yup(deg_to_rad(90.0f), 2.0f, 0.1f, 1000.0f);
+
+    occlusion_buffer ob;
+    ob.init(100, 50);
+    ob.set_view_projection(proj);
+
+    // wall at z = -10 covering x -5 to 5, y -5 to 5
+    vec3f wall[] = {
+        {-5.0f, -5.0f, -10.0f}, {5.0f, -5.0f, -10.0f}, {5.0f, 5.0f, -10.0f}, {-5.0f, 5.0f, -10.0f}
+    };
+    u32 indices[] = {0, 1, 2, 0, 2, 3};
+    ob.rasterise_occluders(wall, 4, indices, 6);
+    ob.build_hierarchy();
+
+    // rasterised depth matches project_to_sc
+    vec3f sc = project_to_sc(vec3f(0.0f, 0.0f, -10.0f), proj, vec2i(100, 50));
+    REQUIRE(require_func(ob.depth((u32)sc.x, (u32)sc.y), sc.z));
+    REQUIRE(ob.depth(0, 0) == 1.0f);
+
+    // behind the wall
+    REQUIRE(!ob.is_visible(vec3f(-1.0f, -1.0f, -30.0f), vec3f(1.0f, 1.0f, -20.0f)));
+    REQUIRE(!ob.is_visible(vec3f(-4.0f, -4.0f, -12.0f), vec3f(4.0f, 4.0f, -11.0f)));
+
+    // in front of the wall
+    REQUIRE(ob.is_visible(vec3f(-1.0f, -1.0f, -6.0f), vec3f(1.0f, 1.0f, -5.0f)));
+
+    // behind but poking out the side of the wall
+    REQUIRE(ob.is_visible(vec3f(3.0f, -1.0f, -21.0f), vec3f(12.0f, 1.0f, -20.0f)));
+
+    // intersecting the wall
+    REQUIRE(ob.is_visible(vec3f(-1.0f, -1.0f, -11.0f), vec3f(1.0f, 1.0f, -9.0f)));
+
+    // crossing the near plane is conservatively visible
+    REQUIRE(ob.is_visible(vec3f(-1.0f, -1.0f, -30.0f), vec3f(1.0f, 1.0f, 1.0f)));
+
+    // off screen
+    REQUIRE(!ob.is_visible(vec3f(-1.0f, 100.0f, -21.0f), vec3f(1.0f, 101.0f, -20.0f)));
+
+    // batch matches single
+    vec3f mins[] = { {-1.0f, -1.0f, -30.0f}, {-1.0f, -1.0f, -6.0f}, {3.0f, -1.0f, -21.0f} };
+    vec3f maxs[] = { {1.0f, 1.0f, -20.0f}, {1.0f, 1.0f, -5.0f}, {12.0f, 1.0f, -20.0f} };
+    bool visible[3];
+    ob.is_visible(mins, maxs, 3, visible);
+    REQUIRE(!visible[0]);
+    REQUIRE(visible[1]);
+    REQUIRE(visible[2]);
+
+    // without occluders everything on screen is visible
+    ob.clear();
+    ob.build_hierarchy();
+    REQUIRE(ob.is_visible(vec3f(-1.0f, -1.0f, -30.0f), vec3f(1.0f, 1.0f, -20.0f)));
+}
+
+TEST_CASE( "Batch Projection", "[maths]")
+{
+    srand(9988);
+
+    mat4 view = mat::create_translation(vec3f(1.0f, -2.0f, -40.0f)) * mat::create_y_rotation(0.3f);
+    mat4 proj = mat::create_perspective_projection_yup(deg_to_rad(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    mat4 view_proj = proj * view;
+    vec2i viewport = vec2i(1280, 720);
+
+    const size_t count = 257;
+    std::vector<vec3f> points(count);
+    for(auto& p : points)
+        p = vec3f((f32)(rand() % 40) - 20.0f, (f32)(rand() % 40) - 20.0f, (f32)(rand() % 40) - 20.0f);
+
+    std::vector<vec3f> ndc(count), sc(count), sc_vdown(count);
+    project_to_ndc(points.data(), count, view_proj, ndc.data());
+    project_to_sc(points.data(), count, view_proj, viewport, sc.data());
+    project_to_sc_vdown(points.data(), count, view_proj, viewport, sc_vdown.data());
+
+    std::vector<vec3f> un_ndc(count), un_sc(count), un_sc_vdown(count);
+    unproject_ndc(ndc.data(), count, view_proj, un_ndc.data());
+    unproject_sc(sc.data(), count, view_proj, viewport, un_sc.data());
+    unproject_sc_vdown(sc_vdown.data(), count, view_proj, viewport, un_sc_vdown.data());
+
+    // strided, reading positions out of interleaved vertices
+    struct vertex { vec2f uv; f32 position[3]; u32 colour; };
+    std::vector<vertex> vertices(count);
+    for(size_t i = 0; i < count; ++i)
+        memcpy(vertices[i].position, &points[i].v[0], sizeof(f32) * 3);
+
+    std::vector<vec3f> strided(count);
+    project_points(get_project_to_sc_matrix(view_proj, viewport), &vertices[0].position[0], sizeof(vertex), count,
+                   strided.data(), sizeof(vec3f));
+
+    // soa
+    std::vector<f32> x(count), y(count), z(count), xo(count), yo(count), zo(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+    project_points(get_project_to_sc_vdown_matrix(view_proj, viewport), x.data(), y.data(), z.data(), count,
+                   xo.data(), yo.data(), zo.data());
+
+    bool match = true;
+    for(size_t i = 0; i < count; ++i)
+    {
+        match &= require_func(ndc[i], project_to_ndc(points[i], view_proj));
+        match &= require_func(sc[i], project_to_sc(points[i], view_proj, viewport));
+        match &= require_func(sc_vdown[i], project_to_sc_vdown(points[i], view_proj, viewport));
+        match &= require_func(un_ndc[i], unproject_ndc(ndc[i], view_proj));
+        match &= require_func(un_sc[i], unproject_sc(sc[i], view_proj, viewport));
+        match &= require_func(un_sc_vdown[i], unproject_sc_vdown(sc_vdown[i], view_proj, viewport));
+        match &= require_func(un_ndc[i], points[i]);
+        match &= require_func(strided[i], sc[i]);
+        match &= require_func(vec3f(xo[i], yo[i], zo[i]), sc_vdown[i]);
+    }
+    REQUIRE(match);
+}
+
+TEST_CASE( "Camera Ray Generator", "[maths]")
+{
+    mat4 view = mat::create_translation(vec3f(0.0f, -5.0f, -30.0f)) * mat::create_x_rotation(0.2f);
+    mat4 proj = mat::create_perspective_projection_yup(deg_to_rad(70.0f), 37.0f / 21.0f, 0.1f, 100.0f);
+    mat4 view_proj = proj * view;
+    vec2i viewport = vec2i(37, 21);
+
+    for(u32 vdown = 0; vdown < 2; ++vdown)
+    {
+        camera_ray_generator gen;
+        gen.init(view_proj, viewport, vdown == 1);
+        REQUIRE(gen.num_tiles_x() == 5);
+        REQUIRE(gen.num_tiles_y() == 3);
+
+        vec2f jitter[k_ray_packet_size];
+        for(u32 i = 0; i < k_ray_packet_size; ++i)
+            jitter[i] = vec2f((f32)(i % 7) / 7.0f, (f32)(i % 5) / 5.0f);
+
+        bool match = true;
+        for(u32 ty = 0; ty < gen.num_tiles_y(); ++ty)
+        {
+            for(u32 tx = 0; tx < gen.num_tiles_x(); ++tx)
+            {
+                ray_packet packet;
+                gen.generate(tx, ty, packet, ty == 1 ? jitter : nullptr);
+                match &= packet.width == (tx == 4 ? 5u : 8u);
+                match &= packet.height == (ty == 2 ? 5u : 8u);
+
+                for(u32 i = 0; i < k_ray_packet_size; ++i)
+                {
+                    vec2f j = ty == 1 ? jitter[i] : vec2f(0.5f);
+                    vec3f sc = vec3f((f32)(packet.x + i % 8) + j.x, (f32)(packet.y + i / 8) + j.y, -1.0f);
+                    vec3f far_sc = vec3f(sc.xy, 1.0f);
+
+                    vec3f o = vdown ? unproject_sc_vdown(sc, view_proj, viewport) : unproject_sc(sc, view_proj, viewport);
+                    vec3f f = vdown ? unproject_sc_vdown(far_sc, view_proj, viewport) : unproject_sc(far_sc, view_proj, viewport);
+                    vec3f d = normalised(f - o);
+
+                    match &= require_func(vec3f(packet.ox[i], packet.oy[i], packet.oz[i]), o);
+                    match &= require_func(vec3f(packet.dx[i], packet.dy[i], packet.dz[i]), d);
+
+                    vec3f so, sd;
+                    gen.generate(sc.xy, so, sd);
+                    match &= require_func(so, o);
+                    match &= require_func(sd, d);
+                }
+            }
+        }
+        REQUIRE(match);
+    }
+}
+
+TEST_CASE( "Batch Colour Conversion", "[maths]")
+{
+    srand(2024);
+
+    // random colours plus greys, primaries and ties between the max channels
+    std::vector<vec3f> colours;
+    for(u32 i = 0; i < 1000; ++i)
+        colours.push_back(vec3f((f32)(rand() % 256) / 255.0f, (f32)(rand() % 256) / 255.0f, (f32)(rand() % 256) / 255.0f));
+
+    f32 special[][3] = {
+        {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.5f, 0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 1.0f}, {1.0f, 0.0f, 1.0f}, {0.2f, 0.8f, 0.8f}
+    };
+    for(auto& c : special)
+        colours.push_back(vec3f(c[0], c[1], c[2]));
+
+    size_t count = colours.size();
+    std::vector<f32> r(count), g(count), b(count), h(count), s(count), v(count);
+    std::vector<f32> rgba(count * 4), hsva(count * 4);
+    for(size_t i = 0; i < count; ++i)
+    {
+        r[i] = colours[i].r;
+        g[i] = colours[i].g;
+        b[i] = colours[i].b;
+        for(u32 c = 0; c < 3; ++c)
+            rgba[i * 4 + c] = colours[i][c];
+        rgba[i * 4 + 3] = 0.25f;
+    }
+
+    hsva = rgba;
+    rgb_to_hsv(r.data(), g.data(), b.data(), count, h.data(), s.data(), v.data());
+    rgb_to_hsv(rgba.data(), count, 4, hsva.data());
+
+    bool match = true;
+    for(size_t i = 0; i < count; ++i)
+    {
+        vec3f expected = rgb_to_hsv(colours[i]);
+        match &= require_func(vec3f(h[i], s[i], v[i]), expected);
+        match &= require_func(vec3f(hsva[i * 4], hsva[i * 4 + 1], hsva[i * 4 + 2]), expected);
+    }
+    REQUIRE(match);
+
+    // back to rgb, in place on the interleaved buffer, alpha untouched
+    std::vector<f32> ro(count), go(count), bo(count);
+    hsv_to_rgb(h.data(), s.data(), v.data(), count, ro.data(), go.data(), bo.data());
+    hsv_to_rgb(hsva.data(), count, 4, hsva.data());
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        vec3f expected = hsv_to_rgb(vec3f(h[i], s[i], v[i]));
+        match &= require_func(vec3f(ro[i], go[i], bo[i]), expected);
+        match &= require_func(vec3f(ro[i], go[i], bo[i]), colours[i]);
+        match &= require_func(vec3f(hsva[i * 4], hsva[i * 4 + 1], hsva[i * 4 + 2]), colours[i]);
+        match &= hsva[i * 4 + 3] == 0.25f;
+    }
+    REQUIRE(match);
+}
+
+TEST_CASE( "Batch rgba8 and sRGB", "[maths]")
+{
+    // pack / unpack
+    std::vector<u32> packed;
+    for(u32 i = 0; i < 1024; ++i)
+        packed.push_back(i * 0x9e3779b9);
+
+    std::vector<vec4f> unpacked(packed.size());
+    rgba8_to_vec4f(packed.data(), packed.size(), unpacked.data());
+
+    std::vector<u32> repacked(packed.size());
+    vec4f_to_rgba8(unpacked.data(), unpacked.size(), repacked.data());
+
+    bool match = true;
+    for(size_t i = 0; i < packed.size(); ++i)
+    {
+        match &= require_func(unpacked[i], rgba8_to_vec4f(packed[i]));
+        match &= repacked[i] == packed[i];
+    }
+    REQUIRE(match);
+
+    // clamping and rounding
+    vec4f out_of_range[] = {
+        vec4f(-1.0f, 2.0f, 0.5f, 1.0f), vec4f(0.499f / 255.0f, 0.501f / 255.0f, 254.6f / 255.0f, 0.0f)
+    };
+    u32 clamped[2];
+    vec4f_to_rgba8(out_of_range, 2, clamped);
+    REQUIRE(clamped[0] == 0xff80ff00);
+    REQUIRE(clamped[1] == 0x00ff0100);
+
+    // srgb decode table matches the exact transfer function
+    std::vector<u32> grey(256);
+    for(u32 i = 0; i < 256; ++i)
+        grey[i] = i | (i << 8) | (i << 16) | (i << 24);
+
+    std::vector<vec4f> linear(256);
+    srgb8_to_linear(grey.data(), grey.size(), linear.data());
+    for(u32 i = 0; i < 256; ++i)
+    {
+        f32 expected = srgb_to_linear((f32)i / 255.0f);
+        match &= linear[i].x == expected && linear[i].y == expected && linear[i].z == expected;
+        match &= require_func(linear[i].w, (f32)i / 255.0f);
+        match &= require_func(linear_to_srgb(expected), (f32)i / 255.0f);
+    }
+    REQUIRE(match);
+
+    // fast encode round trips every code
+    std::vector<u32> encoded(256);
+    linear_to_srgb8(linear.data(), linear.size(), encoded.data());
+    for(u32 i = 0; i < 256; ++i)
+        match &= encoded[i] == grey[i];
+    REQUIRE(match);
+
+    // and stays within 1 of the exact encode everywhere, mostly exact
+    u32 exact = 0;
+    const u32 samples = 100000;
+    for(u32 i = 0; i <= samples; ++i)
+    {
+        f32 x = (f32)i / (f32)samples;
+        s32 ref = (s32)(linear_to_srgb(x) * 255.0f + 0.5f);
+        s32 fast = (s32)linear_to_srgb8(x);
+        match &= abs(ref - fast) <= 1;
+        exact += ref == fast ? 1 : 0;
+    }
+    REQUIRE(match);
+    REQUIRE(exact > samples * 98 / 100);
+
+    REQUIRE(linear_to_srgb8(-1.0f) == 0);
+    REQUIRE(linear_to_srgb8(0.0f) == 0);
+    REQUIRE(linear_to_srgb8(1.0f) == 255);
+    REQUIRE(linear_to_srgb8(100.0f) == 255);
+    REQUIRE(linear_to_srgb8(std::numeric_limits<f32>::quiet_NaN()) == 255);
+}
+
+TEST_CASE( "Colour LUT 3D", "[colour]")
+{
+    srand(3131);
+
+    std::vector<f32> rgb;
+    for(u32 i = 0; i < 500 * 3; ++i)
+        rgb.push_back((f32)(rand() % 1001) / 1000.0f);
+
+    // corners and out of range values
+    f32 extra[] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, -0.5f, 1.5f, 0.25f};
+    rgb.insert(rgb.end(), extra, extra + 12);
+    size_t count = rgb.size() / 3;
+
+    e_lut_interpolation modes[] = {e_lut_interpolation::trilinear, e_lut_interpolation::tetrahedral};
+
+    // both interpolations reproduce an affine grade exactly
+    auto affine = [](const vec3f& c) {
+        return vec3f(0.9f * c.r + 0.1f * c.g + 0.02f, 0.05f * c.r + 0.8f * c.g + 0.15f * c.b - 0.01f, 0.2f * c.g + 0.7f * c.b + 0.05f);
+    };
+
+    colour_lut3d lut;
+    lut.bake(17, affine);
+    REQUIRE(lut.size() == 17);
+
+    bool match = true;
+    for(auto mode : modes)
+    {
+        std::vector<f32> out(rgb.size());
+        lut.apply(rgb.data(), count, 3, out.data(), mode);
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            vec3f in = vec3f(saturate(rgb[i * 3]), saturate(rgb[i * 3 + 1]), saturate(rgb[i * 3 + 2]));
+            vec3f o = vec3f(out[i * 3], out[i * 3 + 1], out[i * 3 + 2]);
+            match &= require_func(o, affine(in));
+            match &= require_func(lut.sample(in, mode), o);
+        }
+    }
+    REQUIRE(match);
+
+    // identity
+    colour_lut3d identity;
+    identity.init(5);
+    for(size_t i = 0; i < count; ++i)
+    {
+        vec3f in = vec3f(saturate(rgb[i * 3]), saturate(rgb[i * 3 + 1]), saturate(rgb[i * 3 + 2]));
+        match &= require_func(identity.sample(in), in);
+        match &= require_func(identity.sample(in, e_lut_interpolation::tetrahedral), in);
+    }
+    REQUIRE(match);
+
+    // a baked chain of non linear functions is close to evaluating the chain per pixel
+    std::vector<colour_lut3d::colour_func> chain;
+    chain.push_back([](const vec3f& c) { return rgb_to_hsv(c); });
+    chain.push_back([](const vec3f& c) { return vec3f(c.x, c.y * 0.5f, c.z); });
+    chain.push_back([](const vec3f& c) { return hsv_to_rgb(c); });
+    chain.push_back([](const vec3f& c) { return vec3f(powf(c.x, 1.2f), powf(c.y, 1.2f), powf(c.z, 1.2f)); });
+
+    colour_lut3d graded;
+    graded.bake(33, chain);
+
+    std::vector<f32> r(count), g(count), b(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        r[i] = saturate(rgb[i * 3]);
+        g[i] = saturate(rgb[i * 3 + 1]);
+        b[i] = saturate(rgb[i * 3 + 2]);
+    }
+
+    for(auto mode : modes)
+    {
+        std::vector<f32> ro(count), go(count), bo(count);
+        graded.apply(r.data(), g.data(), b.data(), count, ro.data(), go.data(), bo.data(), mode);
+
+        f32 max_err = 0.0f;
+        for(size_t i = 0; i < count; ++i)
+        {
+            vec3f expected = vec3f(r[i], g[i], b[i]);
+            for(auto& f : chain)
+                expected = f(expected);
+
+            max_err = max(max_err, fabsf(ro[i] - expected.r), fabsf(go[i] - expected.g), fabsf(bo[i] - expected.b));
+            match &= require_func(graded.sample(vec3f(r[i], g[i], b[i]), mode), vec3f(ro[i], go[i], bo[i]));
+        }
+        REQUIRE(max_err < 0.02f);
+
+        // in place over a count that is not a whole number of blocks
+        std::vector<f32> ri = r, gi = g, bi = b;
+        graded.apply(ri.data(), gi.data(), bi.data(), count, ri.data(), gi.data(), bi.data(), mode);
+        REQUIRE((ri == ro && gi == go && bi == bo));
+    }
+    REQUIRE(match);
+
+    // entries on the grid are returned exactly
+    graded.set(3, 4, 5, vec3f(0.1f, 0.2f, 0.3f));
+    REQUIRE(require_func(graded.get(3, 4, 5), vec3f(0.1f, 0.2f, 0.3f)));
+    REQUIRE(require_func(graded.sample(vec3f(3.0f, 4.0f, 5.0f) / 32.0f), vec3f(0.1f, 0.2f, 0.3f)));
+    REQUIRE(require_func(graded.sample(vec3f(3.0f, 4.0f, 5.0f) / 32.0f, e_lut_interpolation::tetrahedral), vec3f(0.1f, 0.2f, 0.3f)));
+}
+
+namespace
+{
+    template <size_t N>
+    void test_noise_dimension()
+    {
+        srand(4242);
+
+        const size_t count = 2000;
+        std::vector<f32> soa[N];
+        for(size_t k = 0; k < N; ++k)
+            for(size_t i = 0; i < count; ++i)
+                soa[k].push_back((f32)(rand() % 20000) / 100.0f - 100.0f);
+
+        const f32* coords[N];
+        for(size_t k = 0; k < N; ++k)
+            coords[k] = soa[k].data();
+
+        auto point = [&](size_t i) {
+            Vec<N, f32> p;
+            for(size_t k = 0; k < N; ++k)
+                p[k] = soa[k][i];
+            return p;
+        };
+
+        e_noise types[] = {e_noise::value, e_noise::perlin, e_noise::simplex, e_noise::worley};
+        for(auto type : types)
+        {
+            std::vector<f32> batch(count), batch_fbm(count), batch_ridged(count);
+            noise<N>(type, coords, count, 7, batch.data());
+            fbm<N>(type, coords, count, 7, batch_fbm.data(), 4);
+            ridged<N>(type, coords, count, 7, batch_ridged.data(), 4);
+
+            bool ok = true;
+            f32  max_abs = 0.0f;
+            u32  seed_differs = 0;
+            for(size_t i = 0; i < count; ++i)
+            {
+                Vec<N, f32> p = point(i);
+                f32 n = noise<N>(type, p, 7);
+
+                // deterministic, batch matches single and another seed gives another field
+                ok &= n == noise<N>(type, p, 7);
+                ok &= n == batch[i];
+                ok &= require_func(batch_fbm[i], fbm<N>(type, p, 7, 4));
+                ok &= require_func(batch_ridged[i], ridged<N>(type, p, 7, 4));
+                seed_differs += n != noise<N>(type, p, 8) ? 1 : 0;
+
+                if(type == e_noise::worley)
+                {
+                    f32 f1, f2;
+                    worley_noise<N>(p, 7, f1, f2);
+                    ok &= f1 == n && f1 >= 0.0f && f2 >= f1;
+                }
+                else
+                {
+                    ok &= n >= -1.0f && n <= 1.0f;
+                    ok &= batch_fbm[i] >= -1.0f && batch_fbm[i] <= 1.0f;
+                }
+                ok &= batch_ridged[i] >= 0.0f && batch_ridged[i] <= 1.0f;
+
+                // continuous
+                Vec<N, f32> q = p;
+                q[0] += 0.001f;
+                ok &= fabsf(noise<N>(type, q, 7) - n) < 0.05f;
+
+                max_abs = max(max_abs, fabsf(n));
+            }
+
+            REQUIRE(ok);
+            REQUIRE(seed_differs > count * 9 / 10);
+            REQUIRE(max_abs > 0.3f);
+        }
+
+        // gradient noise is 0 on the lattice
+        Vec<N, f32> lattice;
+        for(size_t k = 0; k < N; ++k)
+            lattice[k] = (f32)(k * 3) - 2.0f;
+        REQUIRE(perlin_noise(lattice, 3) == 0.0f);
+    }
+}
+
+TEST_CASE( "Noise", "[noise]")
+{
+    test_noise_dimension<2>();
+    test_noise_dimension<3>();
+    test_noise_dimension<4>();
+
+    // zero octaves sum to 0 rather than dividing by a zero amplitude
+    f32 x[3] = {0.3f, 1.7f, -2.2f}, y[3] = {0.1f, 0.5f, 4.0f};
+    const f32* coords[2] = {x, y};
+    f32 out[3] = {1.0f, 1.0f, 1.0f};
+    REQUIRE(fbm<2>(e_noise::perlin, vec2f(0.3f, 0.1f), 0, 0) == 0.0f);
+    REQUIRE(ridged<2>(e_noise::perlin, vec2f(0.3f, 0.1f), 0, 0) == 0.0f);
+    fbm<2>(e_noise::perlin, coords, 3, 0, out, 0);
+    REQUIRE((out[0] == 0.0f && out[1] == 0.0f && out[2] == 0.0f));
+    out[0] = out[1] = out[2] = 1.0f;
+    ridged<2>(e_noise::simplex, coords, 3, 0, out, 0);
+    REQUIRE((out[0] == 0.0f && out[1] == 0.0f && out[2] == 0.0f));
+}
+
+TEST_CASE( "PCG32 and Sampling", "[sampling]")
+{
+    // reference output of pcg32_srandom(42, 54)
+    pcg32 rng(42, 54);
+    u32 expected[] = {0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e};
+    for(u32 e : expected)
+        REQUIRE(rng.next() == e);
+
+    // lanes match independent generators on consecutive streams
+    pcg32_lanes lanes(42, 54);
+    for(u32 i = 0; i < 4; ++i)
+    {
+        u32 r[k_sampling_lanes];
+        lanes.next(r);
+        for(size_t l = 0; l < k_sampling_lanes; ++l)
+        {
+            pcg32 g(42, 54 + l);
+            for(u32 j = 0; j < i; ++j)
+                g.next();
+            REQUIRE(r[l] == g.next());
+        }
+    }
+
+    for(u32 i = 0; i < 1000; ++i)
+    {
+        REQUIRE(rng.next_bounded(7) < 7);
+        f32 f = rng.next_f32();
+        REQUIRE((f >= 0.0f && f < 1.0f));
+    }
+
+    const size_t count = 100003;
+    pcg32_lanes sampler(7);
+    bool ok = true;
+
+    // disk, mean r^2 = 1/2
+    {
+        std::vector<vec2f> pts(count);
+        sample_disk(sampler, count, pts.data());
+        f64 r2 = 0.0;
+        for(auto& p : pts)
+        {
+            ok &= mag2(p) <= 1.0f;
+            r2 += mag2(p);
+        }
+        REQUIRE(fabs(r2 / count - 0.5) < 0.01);
+    }
+
+    // directions, unit length with zero mean
+    {
+        std::vector<vec3f> dirs(count);
+        sample_direction(sampler, count, dirs.data());
+        vec3f mean = vec3f::zero();
+        for(auto& d : dirs)
+        {
+            ok &= fabsf(mag(d) - 1.0f) < 1e-4f;
+            mean += d;
+        }
+        mean /= (f32)count;
+        REQUIRE(mag(mean) < 0.01f);
+    }
+
+    // sphere, inside with mean r^2 = 3/5 about the centre
+    {
+        vec3f centre = vec3f(1.0f, 2.0f, 3.0f);
+        std::vector<vec3f> pts(count);
+        sample_sphere(sampler, centre, 2.0f, count, pts.data());
+        f64 r2 = 0.0;
+        for(auto& p : pts)
+        {
+            f32 d2 = mag2(p - centre) / 4.0f;
+            ok &= d2 <= 1.0001f;
+            r2 += d2;
+        }
+        REQUIRE(fabs(r2 / count - 0.6) < 0.01);
+    }
+
+    // triangle, inside with mean at the centroid
+    {
+        vec3f t0 = vec3f(0.0f, 0.0f, 0.0f), t1 = vec3f(4.0f, 0.0f, 1.0f), t2 = vec3f(1.0f, 3.0f, -1.0f);
+        std::vector<vec3f> pts(count);
+        sample_triangle(sampler, t0, t1, t2, count, pts.data());
+        vec3f mean = vec3f::zero();
+        for(auto& p : pts)
+        {
+            vec3f b = maths::barycentric<3, f32>(p, t0, t1, t2);
+            ok &= b.x >= -1e-4f && b.y >= -1e-4f && b.z >= -1e-4f;
+            mean += p;
+        }
+        mean /= (f32)count;
+        REQUIRE(require_func(mean, (t0 + t1 + t2) / 3.0f));
+    }
+
+    // cosine hemisphere, E[cos] = 2/3 around a single normal and per sample normals
+    {
+        vec3f n = normalized(vec3f(0.3f, -0.5f, 0.8f));
+        std::vector<vec3f> dirs(count);
+        sample_cosine_hemisphere(sampler, n, count, dirs.data());
+
+        std::vector<vec3f> normals(count);
+        sample_direction(sampler, count, normals.data());
+        std::vector<vec3f> per_normal(count);
+        sample_cosine_hemisphere(sampler, normals.data(), count, per_normal.data());
+
+        f64 c = 0.0, cn = 0.0;
+        for(size_t i = 0; i < count; ++i)
+        {
+            f32 d = dot(dirs[i], n);
+            f32 dn = dot(per_normal[i], normals[i]);
+            ok &= d >= -1e-4f && dn >= -1e-4f;
+            ok &= fabsf(mag(dirs[i]) - 1.0f) < 1e-3f;
+            c += d;
+            cn += dn;
+        }
+        REQUIRE(fabs(c / count - 2.0 / 3.0) < 0.01);
+        REQUIRE(fabs(cn / count - 2.0 / 3.0) < 0.01);
+    }
+
+    REQUIRE(ok);
+
+    // deterministic
+    pcg32_lanes a(99), b(99);
+    std::vector<vec3f> da(100), db(100);
+    sample_direction(a, 100, da.data());
+    sample_direction(b, 100, db.data());
+    for(size_t i = 0; i < 100; ++i)
+        ok &= da[i].x == db[i].x && da[i].y == db[i].y && da[i].z == db[i].z;
+    REQUIRE(ok);
+}
+
+namespace
+{
+    // true if the first 2^m points form a (t, m, 2) net, every elementary interval of area 2^(t - m) holds 2^t points
+    bool is_net(const std::vector<vec2f>& pts, u32 t, u32 m)
+    {
+        for(u32 j = 0; j <= m - t; ++j)
+        {
+            u32 nx = 1u << j;
+            u32 ny = 1u << (m - t - j);
+            std::vector<u32> cells(nx * ny, 0);
+            for(u32 i = 0; i < (1u << m); ++i)
+            {
+                u32 cx = (u32)(pts[i].x * nx);
+                u32 cy = (u32)(pts[i].y * ny);
+                cells[cy * nx + cx]++;
+            }
+            for(u32 c : cells)
+                if(c != (1u << t))
+                    return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE( "Low Discrepancy Sequences", "[sampling]")
+{
+    // first points of the sobol sequence in index (not gray code) order
+    f32 sobol0[] = {0.0f, 0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f};
+    f32 sobol1[] = {0.0f, 0.5f, 0.75f, 0.25f, 0.625f, 0.125f, 0.375f, 0.875f};
+    for(u32 i = 0; i < 8; ++i)
+    {
+        REQUIRE(sobol(i, 0) == sobol0[i]);
+        REQUIRE(sobol(i, 1) == sobol1[i]);
+    }
+
+    // pairs of dimensions form (t, m, 2) nets, t = 0 for the first two, owen scrambling preserves this
+    const u32 m = 8;
+    const u32 n = 1u << m;
+    std::vector<vec3f> s3(n), o3(n);
+    sobol(0, n, s3.data());
+    sobol_owen(0, n, 1234, o3.data());
+
+    u32 pairs[][3] = {{0, 1, 0}, {0, 2, 1}, {1, 2, 1}};
+    for(auto& pr : pairs)
+    {
+        std::vector<vec2f> sp(n), op(n);
+        for(u32 i = 0; i < n; ++i)
+        {
+            sp[i] = vec2f(s3[i][pr[0]], s3[i][pr[1]]);
+            op[i] = vec2f(o3[i][pr[0]], o3[i][pr[1]]);
+        }
+        REQUIRE(is_net(sp, pr[2], m));
+        REQUIRE(is_net(op, pr[2], m));
+    }
+
+    // scrambling with different seeds gives different points
+    std::vector<vec2f> oa(16), ob(16);
+    sobol_owen(0, 16, 1, oa.data());
+    sobol_owen(0, 16, 2, ob.data());
+    u32 differ = 0;
+    for(u32 i = 0; i < 16; ++i)
+        differ += oa[i].x != ob[i].x ? 1 : 0;
+    REQUIRE(differ > 8);
+
+    // halton
+    REQUIRE(radical_inverse(2, 1) == 0.5f);
+    REQUIRE(radical_inverse(2, 6) == 0.375f);
+    REQUIRE(require_func(radical_inverse(3, 1), 1.0f / 3.0f));
+    REQUIRE(require_func(radical_inverse(3, 5), 2.0f / 3.0f + 1.0f / 9.0f));
+
+    std::vector<vec2f> h(n);
+    halton(1, n, h.data());
+    bool ok = true;
+    for(u32 i = 0; i < n; ++i)
+    {
+        ok &= h[i].x == halton(i + 1, 0);
+        ok &= h[i].y == radical_inverse(3, i + 1);
+    }
+    REQUIRE(ok);
+
+    // halton in bases 2 and 3 is stratified on 2^a x 3^b grids
+    std::vector<u32> grid(4 * 3, 0);
+    std::vector<vec2f> h12(12);
+    halton(0, 12, h12.data());
+    for(auto& p : h12)
+        grid[(u32)(p.y * 3) * 4 + (u32)(p.x * 4)]++;
+    for(u32 c : grid)
+        REQUIRE(c == 1);
+
+    // r sequences match the double precision recurrence
+    std::vector<vec2f> r(n);
+    r2(0, n, r.data());
+    std::vector<vec3f> rr(n);
+    r3(0, n, rr.data());
+    for(u32 i = 0; i < n; ++i)
+    {
+        f64 g2 = M_PLASTIC;
+        f64 g3 = M_PHI3;
+        f64 x = fmod(0.5 + i / g2, 1.0);
+        f64 y = fmod(0.5 + i / (g2 * g2), 1.0);
+        ok &= fabs(r[i].x - x) < 1e-6;
+        ok &= fabs(r[i].y - y) < 1e-6;
+        ok &= fabs(rr[i].z - fmod(0.5 + i / (g3 * g3 * g3), 1.0)) < 1e-6;
+        ok &= fabs(r1(i) - fmod(0.5 + i * M_INV_PHI, 1.0)) < 1e-6;
+    }
+    REQUIRE(ok);
+
+    // mean of x * y over the unit square is 1 / 4, the expected error of 256 random samples is about 0.012
+    f64 err_sobol = 0.0, err_r2 = 0.0, err_halton = 0.0;
+    for(u32 i = 0; i < n; ++i)
+    {
+        err_sobol += o3[i].x * o3[i].y;
+        err_r2 += r[i].x * r[i].y;
+        err_halton += h[i].x * h[i].y;
+    }
+    REQUIRE(fabs(err_sobol / n - 0.25) < 0.005);
+    REQUIRE(fabs(err_r2 / n - 0.25) < 0.005);
+    REQUIRE(fabs(err_halton / n - 0.25) < 0.005);
+}
+
+TEST_CASE( "Spline", "[curves]")
+{
+    // interior segments match the per call catmull-rom functions in util.h
+    vec3f cp[] = {
+        vec3f(0.0f, 0.0f, 0.0f), vec3f(1.0f, 2.0f, 0.0f), vec3f(3.0f, 2.5f, 1.0f),
+        vec3f(4.0f, 0.0f, 2.0f), vec3f(7.0f, -1.0f, 2.0f), vec3f(8.0f, 1.0f, 0.0f)
+    };
+    const size_t ncp = sizeof(cp) / sizeof(cp[0]);
+
+    spline3f uniform, centripetal;
+    uniform.init(cp, ncp, 0.0f);
+    centripetal.init(cp, ncp);
+    REQUIRE(centripetal.num_segments() == ncp - 1);
+
+    for(u32 seg = 1; seg < ncp - 2; ++seg)
+    {
+        for(u32 i = 0; i <= 8; ++i)
+        {
+            f32 u = (f32)i / 8.0f;
+            f32 t = ((f32)seg + u) / (f32)(ncp - 1);
+            vec3f a = catmul_rom_spline(u, cp[seg - 1], cp[seg], cp[seg + 1], cp[seg + 2]);
+            vec3f b = catmul_rom_spline_centripital(u, cp[seg - 1], cp[seg], cp[seg + 1], cp[seg + 2]);
+            REQUIRE(dist(uniform.position(t), a) < 1e-4f);
+            REQUIRE(dist(centripetal.position(t), b) < 1e-4f);
+        }
+    }
+
+    // open splines pass through every control point
+    for(u32 i = 0; i < ncp; ++i)
+        REQUIRE(dist(centripetal.position((f32)i / (f32)(ncp - 1)), cp[i]) < 1e-4f);
+
+    // tangent is the derivative of position
+    std::vector<f32> ts;
+    for(u32 i = 1; i < 64; ++i)
+        ts.push_back((f32)i / 64.0f + 0.001f);
+    std::vector<vec3f> pos(ts.size()), tan(ts.size());
+    centripetal.position(ts.data(), ts.size(), pos.data());
+    centripetal.tangent(ts.data(), ts.size(), tan.data());
+    for(size_t i = 0; i < ts.size(); ++i)
+    {
+        const f32 h = 1e-3f;
+        vec3f fd = (centripetal.position(ts[i] + h) - centripetal.position(ts[i] - h)) / (2.0f * h);
+        REQUIRE(pos[i] == centripetal.position(ts[i]));
+        REQUIRE(dist(fd, tan[i]) < 0.05f * max(mag(tan[i]), 1.0f));
+    }
+
+    // evenly spaced collinear points give a straight line of known length
+    vec2f line[] = { vec2f(0.0f, 0.0f), vec2f(1.0f, 0.0f), vec2f(2.0f, 0.0f), vec2f(3.0f, 0.0f) };
+    spline2f straight;
+    straight.init(line, 4);
+    REQUIRE(straight.length() == Approx(3.0f));
+    REQUIRE(straight.param_at_distance(1.5f) == Approx(0.5f));
+    REQUIRE(straight.distance_at_param(0.25f) == Approx(0.75f));
+
+    // arc length against a dense polyline
+    f64 poly_len = 0.0;
+    vec3f prev = centripetal.position(0.0f);
+    for(u32 i = 1; i <= 100000; ++i)
+    {
+        vec3f p = centripetal.position((f32)i / 100000.0f);
+        poly_len += dist(prev, p);
+        prev = p;
+    }
+    REQUIRE(fabs(centripetal.length() - poly_len) < 1e-3 * poly_len);
+
+    // distance and param round trip
+    for(u32 i = 0; i <= 32; ++i)
+    {
+        f32 s = centripetal.length() * (f32)i / 32.0f;
+        REQUIRE(centripetal.distance_at_param(centripetal.param_at_distance(s)) == Approx(s).margin(1e-3f));
+    }
+
+    // constant speed sampling spaces points evenly along the curve
+    const size_t ns = 200;
+    std::vector<vec3f> even(ns);
+    centripetal.sample_uniform(ns, even.data());
+    REQUIRE(dist(even.front(), cp[0]) < 1e-4f);
+    REQUIRE(dist(even.back(), cp[ncp - 1]) < 1e-4f);
+    f32 spacing = centripetal.length() / (f32)(ns - 1);
+    for(size_t i = 1; i < ns; ++i)
+        REQUIRE(fabs(dist(even[i], even[i - 1]) - spacing) < 0.01f * spacing);
+
+    // closed loops join up smoothly
+    vec2f square[] = { vec2f(0.0f, 0.0f), vec2f(1.0f, 0.0f), vec2f(1.0f, 1.0f), vec2f(0.0f, 1.0f) };
+    spline2f loop;
+    loop.init(square, 4, 0.5f, true);
+    REQUIRE(loop.num_segments() == 4);
+    REQUIRE(dist(loop.position(0.0f), loop.position(1.0f)) < 1e-5f);
+    REQUIRE(dist(loop.tangent(0.0f), loop.tangent(1.0f)) < 1e-4f);
+
+    // closest point matches a brute force search, and lies inside the segment bounds
+    pcg32 rng(11);
+    std::vector<vec3f> queries(64);
+    for(auto& q : queries)
+        q = vec3f(rng.next_f32() * 10.0f - 1.0f, rng.next_f32() * 6.0f - 2.0f, rng.next_f32() * 4.0f - 1.0f);
+    std::vector<vec3f> closest(queries.size());
+    std::vector<f32> closest_t(queries.size());
+    centripetal.closest_point(queries.data(), queries.size(), closest.data(), closest_t.data());
+    for(size_t i = 0; i < queries.size(); ++i)
+    {
+        f32 brute = FLT_MAX;
+        for(u32 j = 0; j <= 20000; ++j)
+            brute = min(brute, dist(centripetal.position((f32)j / 20000.0f), queries[i]));
+        REQUIRE(dist(closest[i], queries[i]) <= brute + 1e-4f);
+        REQUIRE(dist(closest[i], centripetal.position(closest_t[i])) < 1e-4f);
+    }
+
+    for(size_t i = 0; i < centripetal.num_segments(); ++i)
+    {
+        vec3f bmin, bmax;
+        centripetal.segment_aabb(i, bmin, bmax);
+        for(u32 j = 0; j <= 16; ++j)
+        {
+            vec3f p = centripetal.position(((f32)i + (f32)j / 16.0f) / (f32)centripetal.num_segments());
+            REQUIRE(point_inside_aabb(bmin - vec3f(1e-4f), bmax + vec3f(1e-4f), p));
+        }
+    }
+}
+
+TEST_CASE( "Spline Degenerate", "[curves]")
+{
+    // empty splines have no segments and evaluate to zero
+    spline3f empty;
+    empty.init(nullptr, 0);
+    REQUIRE(empty.num_segments() == 0);
+    REQUIRE(empty.length() == 0.0f);
+    REQUIRE(empty.position(0.5f) == vec3f(0.0f));
+    REQUIRE(empty.tangent(0.5f) == vec3f(0.0f));
+    REQUIRE(empty.distance_at_param(0.5f) == 0.0f);
+    REQUIRE(empty.param_at_distance(1.0f) == 0.0f);
+
+    f32 t = 1.0f;
+    REQUIRE(empty.closest_point(vec3f(1.0f), &t) == vec3f(0.0f));
+    REQUIRE(t == 0.0f);
+
+    vec3f samples[4];
+    empty.sample_uniform(4, samples);
+    REQUIRE(samples[3] == vec3f(0.0f));
+
+    // a single point is a zero length spline sitting on the point
+    vec3f p = vec3f(1.0f, 2.0f, 3.0f);
+    spline3f single;
+    single.init(&p, 1);
+    REQUIRE(single.num_segments() == 1);
+    REQUIRE(single.length() == 0.0f);
+    REQUIRE(single.position(0.0f) == p);
+    REQUIRE(single.position(0.7f) == p);
+    REQUIRE(single.distance_at_param(1.0f) == 0.0f);
+    REQUIRE(single.position_at_distance(5.0f) == p);
+    REQUIRE(single.closest_point(vec3f(0.0f)) == p);
+
+    single.sample_uniform(4, samples);
+    for (u32 i = 0; i < 4; ++i)
+        REQUIRE(samples[i] == p);
+
+    // reinitialising an empty spline with points works as normal
+    vec3f points[3] = {vec3f(0.0f), vec3f(1.0f, 0.0f, 0.0f), vec3f(2.0f, 0.0f, 0.0f)};
+    empty.init(points, 3);
+    REQUIRE(empty.length() == Approx(2.0f));
+}
+
+namespace
+{
+    // max distance from points on the curve to the polyline
+    template<class F>
+    f32 polyline_error(const std::vector<vec2f>& poly, F curve)
+    {
+        f32 err = 0.0f;
+        for(u32 i = 0; i <= 512; ++i)
+        {
+            vec2f p = curve((f32)i / 512.0f);
+            f32 d = FLT_MAX;
+            for(size_t j = 0; j + 1 < poly.size(); ++j)
+                d = min(d, point_segment_distance(p, poly[j], poly[j + 1]));
+            err = max(err, d);
+        }
+        return err;
+    }
+}
+
+TEST_CASE( "Bezier and BSpline", "[curves]")
+{
+    vec2f p0(0.0f, 0.0f), p1(1.0f, 3.0f), p2(4.0f, 3.0f), p3(5.0f, 0.0f);
+
+    // end points, tangents and splitting
+    REQUIRE(cubic_bezier(0.0f, p0, p1, p2, p3) == p0);
+    REQUIRE(cubic_bezier(1.0f, p0, p1, p2, p3) == p3);
+    REQUIRE(dist(cubic_bezier_tangent(0.0f, p0, p1, p2, p3), 3.0f * (p1 - p0)) < 1e-5f);
+    REQUIRE(dist(quadratic_bezier(0.5f, p0, p1, p2), 0.25f * p0 + 0.5f * p1 + 0.25f * p2) < 1e-5f);
+    REQUIRE(dist(quadratic_bezier_tangent(1.0f, p0, p1, p2), 2.0f * (p2 - p1)) < 1e-5f);
+
+    vec2f l[4], r[4];
+    split_cubic_bezier(0.3f, p0, p1, p2, p3, l, r);
+    vec2f q[3], s[3];
+    split_quadratic_bezier(0.6f, p0, p1, p2, q, s);
+    for(u32 i = 0; i <= 10; ++i)
+    {
+        f32 t = (f32)i / 10.0f;
+        REQUIRE(dist(cubic_bezier(t, l[0], l[1], l[2], l[3]), cubic_bezier(t * 0.3f, p0, p1, p2, p3)) < 1e-5f);
+        REQUIRE(dist(cubic_bezier(t, r[0], r[1], r[2], r[3]), cubic_bezier(0.3f + t * 0.7f, p0, p1, p2, p3)) < 1e-5f);
+        REQUIRE(dist(quadratic_bezier(t, q[0], q[1], q[2]), quadratic_bezier(t * 0.6f, p0, p1, p2)) < 1e-5f);
+        REQUIRE(dist(quadratic_bezier(t, s[0], s[1], s[2]), quadratic_bezier(0.6f + t * 0.4f, p0, p1, p2)) < 1e-5f);
+    }
+
+    // b-spline segments equal their bezier form and join with matching tangents
+    vec2f b[4];
+    bspline_to_bezier(p0, p1, p2, p3, b[0], b[1], b[2], b[3]);
+    for(u32 i = 0; i <= 10; ++i)
+    {
+        f32 t = (f32)i / 10.0f;
+        REQUIRE(dist(bspline(t, p0, p1, p2, p3), cubic_bezier(t, b[0], b[1], b[2], b[3])) < 1e-5f);
+        REQUIRE(dist(bspline_tangent(t, p0, p1, p2, p3), cubic_bezier_tangent(t, b[0], b[1], b[2], b[3])) < 1e-4f);
+    }
+    vec2f p4(6.0f, 2.0f);
+    REQUIRE(dist(bspline(1.0f, p0, p1, p2, p3), bspline(0.0f, p1, p2, p3, p4)) < 1e-5f);
+    REQUIRE(dist(bspline_tangent(1.0f, p0, p1, p2, p3), bspline_tangent(0.0f, p1, p2, p3, p4)) < 1e-5f);
+
+    // flattening stays within tolerance and adapts to curvature
+    const f32 tol = 0.01f;
+    std::vector<vec2f> poly;
+    flatten_cubic_bezier(p0, p1, p2, p3, tol, poly);
+    REQUIRE(poly.front() == p0);
+    REQUIRE(poly.back() == p3);
+    REQUIRE(polyline_error(poly, [&](f32 t) { return cubic_bezier(t, p0, p1, p2, p3); }) <= tol);
+
+    std::vector<vec2f> coarse;
+    flatten_cubic_bezier(p0, p1, p2, p3, 0.1f, coarse);
+    REQUIRE(coarse.size() < poly.size());
+
+    std::vector<vec2f> straight;
+    flatten_cubic_bezier(vec2f(0.0f, 0.0f), vec2f(1.0f, 0.0f), vec2f(2.0f, 0.0f), vec2f(3.0f, 0.0f), tol, straight);
+    REQUIRE(straight.size() == 2);
+
+    std::vector<vec2f> quad;
+    flatten_quadratic_bezier(p0, p1, p2, tol, quad);
+    REQUIRE(polyline_error(quad, [&](f32 t) { return quadratic_bezier(t, p0, p1, p2); }) <= tol);
+
+    // a circle from 4 cubic arcs flattened into a polygon for the 2d poly tests
+    const f32 k = 0.5522847f;
+    vec2f c[] = {
+        vec2f(1.0f, 0.0f), vec2f(1.0f, k), vec2f(k, 1.0f), vec2f(0.0f, 1.0f), vec2f(-k, 1.0f), vec2f(-1.0f, k),
+        vec2f(-1.0f, 0.0f), vec2f(-1.0f, -k), vec2f(-k, -1.0f), vec2f(0.0f, -1.0f), vec2f(k, -1.0f), vec2f(1.0f, -k)
+    };
+    std::vector<vec2f> circle;
+    for(u32 i = 0; i < 4; ++i)
+        flatten_cubic_bezier(c[i * 3], c[i * 3 + 1], c[i * 3 + 2], c[(i * 3 + 3) % 12], tol, circle);
+    REQUIRE(circle.back() == circle.front());
+    circle.pop_back();
+    for(auto& v : circle)
+        REQUIRE(fabs(mag(v) - 1.0f) < tol);
+
+    REQUIRE(point_inside_poly(vec2f(0.0f, 0.0f), circle));
+    REQUIRE(point_inside_poly(vec2f(0.7f, 0.7f), circle));
+    REQUIRE(!point_inside_poly(vec2f(0.72f, 0.72f), circle));
+    std::vector<vec2f> ips;
+    REQUIRE(line_vs_poly(vec2f(-2.0f, 0.1f), vec2f(2.0f, 0.1f), circle, ips));
+    REQUIRE(ips.size() == 2);
+
+    // closed b-spline loop is a polygon without a repeated end point
+    vec2f sq[] = { vec2f(-1.0f, -1.0f), vec2f(1.0f, -1.0f), vec2f(1.0f, 1.0f), vec2f(-1.0f, 1.0f) };
+    std::vector<vec2f> rounded;
+    flatten_bspline(sq, 4, tol, rounded, true);
+    REQUIRE(!(rounded.back() == rounded.front()));
+    REQUIRE(point_inside_poly(vec2f(0.0f, 0.0f), rounded));
+    REQUIRE(!point_inside_poly(vec2f(0.9f, 0.9f), rounded));
+
+    std::vector<vec2f> open;
+    vec2f pts[] = { p0, p1, p2, p3, p4 };
+    flatten_bspline(pts, 5, tol, open);
+    REQUIRE(dist(open.front(), bspline(0.0f, p0, p1, p2, p3)) < 1e-5f);
+    REQUIRE(dist(open.back(), bspline(1.0f, p1, p2, p3, p4)) < 1e-5f);
+
+    // batch evaluation and flattening of many curves
+    pcg32 rng(3);
+    const size_t n = 100;
+    std::vector<vec2f> cps(n * 4);
+    for(auto& v : cps)
+        v = vec2f(rng.next_f32() * 10.0f, rng.next_f32() * 10.0f);
+
+    std::vector<vec2f> at(n);
+    cubic_bezier(cps.data(), n, 0.37f, at.data());
+    for(size_t i = 0; i < n; ++i)
+        REQUIRE(dist(at[i], cubic_bezier(0.37f, cps[i * 4], cps[i * 4 + 1], cps[i * 4 + 2], cps[i * 4 + 3])) < 1e-4f);
+
+    std::vector<vec2f> flat;
+    std::vector<u32> offsets;
+    flatten_cubic_beziers(cps.data(), n, tol, flat, offsets);
+    REQUIRE(offsets.size() == n + 1);
+    REQUIRE(offsets[n] == flat.size());
+    for(size_t i = 0; i < n; ++i)
+    {
+        const vec2f* cp = &cps[i * 4];
+        std::vector<vec2f> curve(flat.begin() + offsets[i], flat.begin() + offsets[i + 1]);
+        REQUIRE(dist(curve.front(), cp[0]) < 1e-5f);
+        REQUIRE(dist(curve.back(), cp[3]) < 1e-4f);
+        REQUIRE(polyline_error(curve, [&](f32 t) { return cubic_bezier(t, cp[0], cp[1], cp[2], cp[3]); }) <= tol);
+    }
+
+    // zero, negative and nan tolerances are clamped and huge curves are capped
+    for(f32 bad : {0.0f, -1.0f, std::numeric_limits<f32>::quiet_NaN()})
+    {
+        u32 segs = cubic_bezier_segments(cps[0], cps[1], cps[2], cps[3], bad);
+        REQUIRE(segs >= 1);
+        REQUIRE(segs <= k_bezier_max_segments);
+    }
+    REQUIRE(cubic_bezier_segments(p0, p0, p0, p0, 0.0f) == 1);
+    REQUIRE(cubic_bezier_segments(vec2f(0.0f), vec2f(1e30f, 0.0f), vec2f(-1e30f, 0.0f), vec2f(0.0f), tol) ==
+            k_bezier_max_segments);
+
+    flatten_cubic_beziers(cps.data(), 2, 0.0f, flat, offsets);
+    REQUIRE(offsets[2] == flat.size());
+    REQUIRE(offsets[1] > offsets[0]);
+    REQUIRE(offsets[2] > offsets[1]);
+}
+
+TEST_CASE( "Curve Table", "[curves]")
+{
+    // baked shaping functions match the originals
+    curve_table stop3;
+    stop3.bake([](f32 x) { return smooth_stop3(x); });
+    REQUIRE(stop3.size() == k_curve_table_default_size);
+
+    curve_table pc;
+    pc.bake([](f32 x) { return pcurve(x, 2.0f, 3.0f); }, 512);
+
+    f32 err_linear = 0.0f, err_cubic = 0.0f, err_pcurve = 0.0f;
+    for(u32 i = 0; i <= 1000; ++i)
+    {
+        f32 x = (f32)i / 1000.0f;
+        err_linear = max(err_linear, fabs(stop3(x) - smooth_stop3(x)));
+        err_cubic = max(err_cubic, fabs(stop3.evaluate(x, e_curve_interpolation::cubic) - smooth_stop3(x)));
+        err_pcurve = max(err_pcurve, fabs(pc.evaluate(x, e_curve_interpolation::cubic) - pcurve(x, 2.0f, 3.0f)));
+    }
+    REQUIRE(err_linear < 1e-4f);
+    REQUIRE(err_cubic < 1e-5f);
+    REQUIRE(err_cubic < err_linear);
+    REQUIRE(err_pcurve < 1e-5f);
+
+    // ends are exact and inputs outside the range clamp
+    REQUIRE(stop3(0.0f) == 0.0f);
+    REQUIRE(stop3(1.0f) == 1.0f);
+    REQUIRE(stop3.evaluate(1.0f, e_curve_interpolation::cubic) == 1.0f);
+    REQUIRE(stop3(-3.0f) == 0.0f);
+    REQUIRE(stop3.evaluate(7.0f, e_curve_interpolation::cubic) == 1.0f);
+
+    // custom input range
+    curve_table ex;
+    ex.bake([](f32 x) { return exp_step(x, 1.0f, 2.0f); }, 1024, 0.0f, 4.0f);
+    for(u32 i = 0; i <= 100; ++i)
+    {
+        f32 x = (f32)i / 25.0f;
+        REQUIRE(fabs(ex.evaluate(x, e_curve_interpolation::cubic) - exp_step(x, 1.0f, 2.0f)) < 1e-5f);
+    }
+
+    // composition applies the chain in order
+    curve_table chain;
+    chain.bake({ [](f32 x) { return smooth_start2(x); }, [](f32 x) { return cubic_pulse(0.5f, 0.5f, x); } }, 64);
+    for(u32 i = 0; i < chain.size(); ++i)
+    {
+        f32 x = (f32)i / (f32)(chain.size() - 1);
+        REQUIRE(chain.data()[i] == Approx(cubic_pulse(0.5f, 0.5f, smooth_start2(x))).margin(1e-6f));
+    }
+
+    // batch evaluation matches single lookups, in place
+    pcg32 rng(9);
+    std::vector<f32> x(1000), lin(1000), cub(1000);
+    for(auto& v : x)
+        v = rng.next_f32() * 1.2f - 0.1f;
+    stop3.evaluate(x.data(), x.size(), lin.data());
+    stop3.evaluate(x.data(), x.size(), cub.data(), e_curve_interpolation::cubic);
+    bool ok = true;
+    for(size_t i = 0; i < x.size(); ++i)
+    {
+        ok &= lin[i] == stop3.evaluate(x[i]);
+        ok &= cub[i] == stop3.evaluate(x[i], e_curve_interpolation::cubic);
+    }
+    REQUIRE(ok);
+
+    std::vector<f32> in_place = x;
+    stop3.evaluate(in_place.data(), in_place.size(), in_place.data());
+    REQUIRE(in_place == lin);
+
+    // an empty range bakes a constant rather than dividing by zero
+    curve_table flat;
+    flat.bake([](f32 x) { return x * 2.0f + 1.0f; }, 16, 0.5f, 0.5f);
+    for(f32 v : {-10.0f, 0.0f, 0.5f, 0.75f, 100.0f, std::numeric_limits<f32>::infinity()})
+    {
+        REQUIRE(flat(v) == 2.0f);
+        REQUIRE(flat.evaluate(v, e_curve_interpolation::cubic) == 2.0f);
+    }
+}
+
+TEST_CASE( "Morton and Hilbert", "[spatial]")
+{
+    // morton codes against a bit by bit interleave
+    pcg32 rng(17);
+    bool ok = true;
+    for(u32 i = 0; i < 1000; ++i)
+    {
+        u64 x = rng.next() & 0x1fffff, y = rng.next() & 0x1fffff, z = rng.next() & 0x1fffff;
+        u64 expected = 0;
+        for(u32 b = 0; b < 21; ++b)
+            expected |= (((x >> b) & 1) << (b * 3)) | (((y >> b) & 1) << (b * 3 + 1)) | (((z >> b) & 1) << (b * 3 + 2));
+
+        u64 d, dx, dy, dz;
+        morton_xyz3d(x, y, z, &d);
+        morton_d2xyz(d, dx, dy, dz);
+        ok &= d == expected && dx == x && dy == y && dz == z;
+
+        u64 x2 = rng.next(), y2 = rng.next(), d2;
+        morton_xy2d(x2, y2, &d2);
+        morton_d2xy(d2, dx, dy);
+        ok &= dx == x2 && dy == y2;
+    }
+    REQUIRE(ok);
+
+    // every hilbert index maps to a unique cell, and consecutive indices are neighbouring cells
+    const u32 bits2 = 4;
+    std::vector<bool> seen(1 << (bits2 * 2), false);
+    u64 px = 0, py = 0;
+    for(u64 d = 0; d < (1u << (bits2 * 2)); ++d)
+    {
+        u64 x, y, back;
+        hilbert_d2xy(d, x, y, bits2);
+        hilbert_xy2d(x, y, &back, bits2);
+        ok &= back == d && !seen[y * 16 + x];
+        seen[y * 16 + x] = true;
+        if(d > 0)
+            ok &= (u64)(llabs((long long)x - (long long)px) + llabs((long long)y - (long long)py)) == 1;
+        px = x;
+        py = y;
+    }
+    REQUIRE(ok);
+
+    const u32 bits3 = 3;
+    std::vector<bool> seen3(1 << (bits3 * 3), false);
+    u64 pz = 0;
+    for(u64 d = 0; d < (1u << (bits3 * 3)); ++d)
+    {
+        u64 x, y, z, back;
+        hilbert_d2xyz(d, x, y, z, bits3);
+        hilbert_xyz3d(x, y, z, &back, bits3);
+        u64 cell = (z * 8 + y) * 8 + x;
+        ok &= back == d && !seen3[cell];
+        seen3[cell] = true;
+        if(d > 0)
+            ok &= (u64)(llabs((long long)x - (long long)px) + llabs((long long)y - (long long)py) +
+                        llabs((long long)z - (long long)pz)) == 1;
+        px = x;
+        py = y;
+        pz = z;
+    }
+    REQUIRE(ok);
+
+    // full precision round trips
+    for(u32 i = 0; i < 1000; ++i)
+    {
+        u64 x = rng.next() & 0x1fffff, y = rng.next() & 0x1fffff, z = rng.next() & 0x1fffff, d, dx, dy, dz;
+        hilbert_xyz3d(x, y, z, &d);
+        hilbert_d2xyz(d, dx, dy, dz);
+        ok &= d < (1ull << 63) && dx == x && dy == y && dz == z;
+
+        u64 x2 = rng.next(), y2 = rng.next(), d2;
+        hilbert_xy2d(x2, y2, &d2);
+        hilbert_d2xy(d2, dx, dy);
+        ok &= dx == x2 && dy == y2;
+    }
+    REQUIRE(ok);
+
+    // batch encoders quantise over the bounding box
+    std::vector<vec3f> points(1000);
+    for(auto& p : points)
+        p = vec3f(rng.next_f32() * 100.0f - 50.0f, rng.next_f32() * 10.0f, rng.next_f32() * -3.0f);
+    points[7] = vec3f(-50.0f, 0.0f, -3.0f);
+
+    vec3f bmin, bmax;
+    get_aabb(points.data(), points.size(), bmin, bmax);
+    for(auto& p : points)
+        REQUIRE(point_inside_aabb(bmin, bmax, p));
+
+    std::vector<u32> qx(points.size()), qy(points.size()), qz(points.size());
+    quantise_points(points.data(), points.size(), bmin, bmax, qx.data(), qy.data(), qz.data());
+    std::vector<u64> morton(points.size()), hilbert(points.size()), codes(points.size());
+    morton_encode(points.data(), points.size(), bmin, bmax, morton.data());
+    hilbert_encode(points.data(), points.size(), bmin, bmax, hilbert.data());
+    spatial_encode(e_space_filling_curve::hilbert, points.data(), points.size(), bmin, bmax, codes.data());
+    REQUIRE(codes == hilbert);
+
+    vec3f extent = bmax - bmin;
+    for(size_t i = 0; i < points.size(); ++i)
+    {
+        vec3f cell_size = extent / (f32)(1 << 21);
+        vec3f cell = vec3f((f32)qx[i], (f32)qy[i], (f32)qz[i]) * cell_size + bmin;
+        ok &= qx[i] < (1u << 21) && qy[i] < (1u << 21) && qz[i] < (1u << 21);
+        for(u32 j = 0; j < 3; ++j)
+            ok &= cell[j] <= points[i][j] + cell_size[j] * 0.5f && points[i][j] <= cell[j] + cell_size[j] * 1.5f;
+
+        u64 m, h;
+        morton_xyz3d(qx[i], qy[i], qz[i], &m);
+        hilbert_xyz3d(qx[i], qy[i], qz[i], &h);
+        ok &= morton[i] == m && hilbert[i] == h;
+    }
+    REQUIRE(ok);
+    REQUIRE(qx[7] == 0);
+    REQUIRE(qz[7] == 0);
+}
+
+TEST_CASE( "Radix Sort", "[util]")
+{
+    pcg32 rng(23);
+    const size_t n = 20000;
+
+    // unsigned keys with 8 and 11 bit digits
+    std::vector<u32> k32(n);
+    for(auto& k : k32)
+        k = rng.next();
+    for(u32 bits : {8u, 11u, 16u, 5u})
+    {
+        std::vector<u32> a = k32, b = k32;
+        radix_sort(a, bits);
+        std::sort(b.begin(), b.end());
+        REQUIRE(a == b);
+    }
+
+    std::vector<u64> k64(n);
+    for(auto& k : k64)
+        k = ((u64)rng.next() << 32) | rng.next();
+    std::vector<u64> s64 = k64;
+    radix_sort(k64, 11);
+    std::sort(s64.begin(), s64.end());
+    REQUIRE(k64 == s64);
+
+    // signed and float keys
+    std::vector<int32_t> ki(n);
+    for(auto& k : ki)
+        k = (int32_t)rng.next();
+    std::vector<int32_t> si = ki;
+    radix_sort(ki);
+    std::sort(si.begin(), si.end());
+    REQUIRE(ki == si);
+
+    std::vector<f32> kf(n);
+    for(auto& k : kf)
+        k = (rng.next_f32() - 0.5f) * powf(10.0f, (f32)(rng.next_bounded(20)) - 10.0f);
+    kf[0] = -0.0f;
+    kf[1] = 0.0f;
+    kf[2] = FLT_MAX;
+    kf[3] = -FLT_MAX;
+    kf[4] = -INFINITY;
+    std::vector<f32> sf = kf;
+    radix_sort(kf);
+    std::sort(sf.begin(), sf.end());
+    REQUIRE(kf == sf);
+    REQUIRE(kf[0] == -INFINITY);
+
+    std::vector<f64> kd(n);
+    for(auto& k : kd)
+        k = ((f64)rng.next_f32() - 0.5) * 1e6;
+    std::vector<f64> sd = kd;
+    radix_sort(kd);
+    std::sort(sd.begin(), sd.end());
+    REQUIRE(kd == sd);
+
+    // sortable transforms round trip and keep ordering
+    REQUIRE(float_to_sortable(-1.0f) < float_to_sortable(-0.5f));
+    REQUIRE(float_to_sortable(-0.0f) < float_to_sortable(0.0f));
+    REQUIRE(float_to_sortable(0.5f) < float_to_sortable(1.0f));
+    REQUIRE(sortable_to_float(float_to_sortable(-3.25f)) == -3.25f);
+    REQUIRE(sortable_to_float(float_to_sortable(1e-3)) == 1e-3);
+
+    // key value sort is stable, small keys skip the passes over their zero high digits
+    std::vector<u32> keys(n), values(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        keys[i] = rng.next_bounded(100);
+        values[i] = (u32)i;
+    }
+    std::vector<u32> kv_keys = keys, kv_values = values;
+    radix_sort(kv_keys, kv_values);
+    bool ok = true;
+    for(size_t i = 1; i < n; ++i)
+    {
+        ok &= kv_keys[i - 1] <= kv_keys[i];
+        ok &= kv_keys[i - 1] < kv_keys[i] || kv_values[i - 1] < kv_values[i];
+        ok &= keys[kv_values[i]] == kv_keys[i];
+    }
+    REQUIRE(ok);
+
+    // parallel sort gives identical results
+    thread_pool pool(4);
+    for(u32 bits : {8u, 11u})
+    {
+        std::vector<u32> pk = keys, pv = values, tk(n), tv(n);
+        radix_sort(pool, pk.data(), pv.data(), n, tk.data(), tv.data(), bits, 1000);
+        REQUIRE(pk == kv_keys);
+        REQUIRE(pv == kv_values);
+
+        std::vector<f32> pf = sf, tf(n);
+        std::shuffle(pf.begin(), pf.end(), std::mt19937(1));
+        radix_sort(pool, pf.data(), n, tf.data(), bits, 777);
+        REQUIRE(pf == sf);
+    }
+
+    std::vector<u32> empty;
+    radix_sort(empty);
+    REQUIRE(empty.empty());
+}
+
+TEST_CASE( "Spatial Reorder", "[spatial]")
+{
+    pcg32 rng(31);
+    const size_t n = 5000;
+    std::vector<vec3f> points(n);
+    std::vector<u32> ids(n);
+    std::vector<vec4f> colours(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        points[i] = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 20.0f;
+        ids[i] = (u32)i;
+        colours[i] = vec4f((f32)i, 0.0f, 0.0f, 1.0f);
+    }
+
+    // sum of distances between consecutive points, sorting along either curve makes it much shorter
+    auto path_length = [](const std::vector<vec3f>& p) {
+        f64 len = 0.0;
+        for(size_t i = 1; i < p.size(); ++i)
+            len += dist(p[i], p[i - 1]);
+        return len;
+    };
+    f64 random_len = path_length(points);
+
+    for(auto curve : {e_space_filling_curve::morton, e_space_filling_curve::hilbert})
+    {
+        std::vector<vec3f> sorted = points;
+        std::vector<u32> sorted_ids = ids;
+        std::vector<vec4f> sorted_colours = colours;
+        std::vector<u32> perm;
+        spatial_reorder(curve, sorted, perm, sorted_ids, sorted_colours);
+        REQUIRE(perm.size() == n);
+        REQUIRE(path_length(sorted) < random_len * 0.25);
+
+        // the permutation and attributes move together and codes are in order
+        vec3f bmin, bmax;
+        get_aabb(points.data(), n, bmin, bmax);
+        std::vector<u64> codes(n);
+        spatial_encode(curve, sorted.data(), n, bmin, bmax, codes.data());
+
+        bool ok = true;
+        std::vector<bool> seen(n, false);
+        for(size_t i = 0; i < n; ++i)
+        {
+            ok &= !seen[perm[i]];
+            seen[perm[i]] = true;
+            ok &= sorted[i] == points[perm[i]];
+            ok &= sorted_ids[i] == perm[i];
+            ok &= sorted_colours[i].x == (f32)perm[i];
+            if(i > 0)
+                ok &= codes[i - 1] <= codes[i];
+        }
+        REQUIRE(ok);
+    }
+
+    // hilbert order has no long jumps so it beats morton
+    std::vector<vec3f> morton_sorted = points, hilbert_sorted = points;
+    std::vector<u32> perm;
+    spatial_reorder(e_space_filling_curve::morton, morton_sorted, perm);
+    spatial_reorder(e_space_filling_curve::hilbert, hilbert_sorted, perm);
+    REQUIRE(path_length(hilbert_sorted) < path_length(morton_sorted));
+
+    // remapping an index buffer keeps triangles referring to the same positions
+    std::vector<u32> indices(300);
+    for(auto& i : indices)
+        i = rng.next_bounded((u32)n);
+    std::vector<u32> remapped = indices;
+    remap_indices(perm, remapped.data(), remapped.size());
+    for(size_t i = 0; i < indices.size(); ++i)
+        REQUIRE(hilbert_sorted[remapped[i]] == points[indices[i]]);
+
+    std::vector<u32> inverse(n);
+    invert_permutation(perm.data(), n, inverse.data());
+    std::vector<vec3f> restored(n);
+    apply_permutation(inverse.data(), n, hilbert_sorted.data(), restored.data());
+    REQUIRE(restored == points);
+}
+
+TEST_CASE( "KD Tree", "[kdtree]")
+{
+    pcg32 rng(37);
+    const size_t n = 3000;
+    std::vector<vec3f> points(n);
+    for(auto& p : points)
+        p = vec3f(rng.next_f32() * 10.0f, rng.next_f32() * 10.0f, rng.next_f32());
+
+    kdtree3f tree;
+    tree.build(points.data(), n);
+    REQUIRE(tree.size() == n);
+
+    std::vector<vec3f> queries(200);
+    for(auto& q : queries)
+        q = vec3f(rng.next_f32() * 12.0f - 1.0f, rng.next_f32() * 12.0f - 1.0f, rng.next_f32() * 2.0f - 0.5f);
+
+    // nearest and k nearest against brute force
+    const size_t k = 12;
+    std::vector<u32> knn_indices(queries.size() * k);
+    std::vector<f32> knn_d2(queries.size() * k);
+    tree.knn(queries.data(), queries.size(), k, knn_indices.data(), knn_d2.data());
+
+    std::vector<u32> nn(queries.size());
+    tree.nearest(queries.data(), queries.size(), nn.data());
+
+    bool ok = true;
+    for(size_t qi = 0; qi < queries.size(); ++qi)
+    {
+        const vec3f& q = queries[qi];
+        std::vector<std::pair<f32, u32>> brute(n);
+        for(u32 i = 0; i < n; ++i)
+            brute[i] = std::make_pair(dist2(points[i], q), i);
+        std::sort(brute.begin(), brute.end());
+
+        ok &= dist2(points[nn[qi]], q) == brute[0].first;
+        for(size_t j = 0; j < k; ++j)
+        {
+            ok &= knn_d2[qi * k + j] == brute[j].first;
+            ok &= dist2(points[knn_indices[qi * k + j]], q) == brute[j].first;
+        }
+
+        // radius
+        f32 r = 0.6f;
+        std::vector<u32> in_radius;
+        tree.radius(q, r, in_radius);
+        std::sort(in_radius.begin(), in_radius.end());
+        std::vector<u32> expected;
+        for(u32 i = 0; i < n; ++i)
+            if(dist2(points[i], q) <= r * r)
+                expected.push_back(i);
+        ok &= in_radius == expected;
+
+        // box
+        vec3f bmin = q - vec3f(1.0f, 0.5f, 0.25f), bmax = q + vec3f(0.5f, 1.0f, 0.25f);
+        std::vector<u32> in_box;
+        tree.aabb(bmin, bmax, in_box);
+        std::sort(in_box.begin(), in_box.end());
+        expected.clear();
+        for(u32 i = 0; i < n; ++i)
+            if(point_inside_aabb(bmin, bmax, points[i]))
+                expected.push_back(i);
+        ok &= in_box == expected;
+    }
+    REQUIRE(ok);
+
+    // batch radius offsets
+    std::vector<u32> ri, ro;
+    tree.radius(queries.data(), queries.size(), 0.5f, ri, ro);
+    REQUIRE(ro.size() == queries.size() + 1);
+    REQUIRE(ro.back() == ri.size());
+    for(size_t qi = 0; qi < queries.size(); ++qi)
+        for(u32 j = ro[qi]; j < ro[qi + 1]; ++j)
+            REQUIRE(dist(points[ri[j]], queries[qi]) <= 0.5f);
+
+    // duplicate coordinates on a 2d grid and a small tree padded with invalid results
+    std::vector<vec2f> grid;
+    for(u32 y = 0; y < 20; ++y)
+        for(u32 x = 0; x < 20; ++x)
+            for(u32 d = 0; d < 2; ++d)
+                grid.push_back(vec2f((f32)x, (f32)y));
+    kdtree2f gtree;
+    gtree.build(grid.data(), grid.size(), 4);
+    u32 g[5];
+    f32 gd2[5];
+    REQUIRE(gtree.knn(vec2f(3.2f, 7.1f), 5, g, gd2) == 5);
+    REQUIRE(grid[g[0]] == vec2f(3.0f, 7.0f));
+    REQUIRE(grid[g[1]] == vec2f(3.0f, 7.0f));
+    REQUIRE(g[0] != g[1]);
+    REQUIRE(gd2[3] == Approx(dist2(vec2f(3.2f, 7.1f), vec2f(4.0f, 7.0f))));
+    REQUIRE(gd2[4] == Approx(dist2(vec2f(3.2f, 7.1f), vec2f(3.0f, 8.0f))));
+
+    std::vector<u32> line;
+    gtree.aabb(vec2f(5.0f, 0.0f), vec2f(5.0f, 19.0f), line);
+    REQUIRE(line.size() == 40);
+
+    kdtree2f small;
+    vec2f few[] = { vec2f(0.0f, 0.0f), vec2f(1.0f, 1.0f) };
+    small.build(few, 2);
+    u32 pad[3];
+    f32 pad_d2[3];
+    vec2f q(0.9f, 0.9f);
+    small.knn(&q, 1, 3, pad, pad_d2);
+    REQUIRE(pad[0] == 1);
+    REQUIRE(pad[1] == 0);
+    REQUIRE(pad[2] == k_kdtree_invalid);
+
+    kdtree2f empty;
+    empty.build(nullptr, 0);
+    REQUIRE(empty.nearest(q) == k_kdtree_invalid);
+}
+
+TEST_CASE( "Loose Octree", "[octree]")
+{
+    pcg32 rng(41);
+    const u32 n = 3000;
+
+    loose_octree tree;
+    tree.init(vec3f::zero(), 256.0f, 7);
+
+    // a mix of sizes, including objects bigger than the root cell and outside it
+    std::vector<vec3f> mins(n), maxs(n);
+    std::vector<u32> handles(n);
+    auto random_box = [&](vec3f& bmin, vec3f& bmax) {
+        vec3f c = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 600.0f - vec3f(300.0f);
+        f32 s = rng.next_f32();
+        vec3f e = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * (s < 0.9f ? 2.0f : s < 0.99f ? 40.0f : 400.0f);
+        bmin = c - e;
+        bmax = c + e;
+    };
+    for(u32 i = 0; i < n; ++i)
+    {
+        random_box(mins[i], maxs[i]);
+        handles[i] = tree.insert(mins[i], maxs[i]);
+    }
+    REQUIRE(tree.size() == n);
+
+    mat4 view = mat::create_translation(vec3f(0.0f, 0.0f, -50.0f));
+    mat4 proj = mat::create_perspective_projection(-0.5f, 0.5f, -0.5f, 0.5f, 0.1f, 300.0f);
+    vec4f planes[6];
+    get_frustum_planes_from_matrix(proj * view, &planes[0]);
+
+    // every query matches brute force over all objects
+    auto check = [&]() {
+        bool ok = true;
+        for(u32 q = 0; q < 20; ++q)
+        {
+            vec3f qmin, qmax;
+            random_box(qmin, qmax);
+            qmax += vec3f(30.0f);
+            vec3f r1 = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 400.0f - vec3f(200.0f);
+            vec3f rv = normalised(vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) - vec3f(0.5f));
+
+            std::vector<u32> frustum, box, ray, frustum_expected, box_expected, ray_expected;
+            tree.query_frustum(planes, frustum);
+            tree.query_aabb(qmin, qmax, box);
+            tree.query_ray(r1, rv, ray);
+
+            for(u32 i = 0; i < n; ++i)
+            {
+                u32 h = handles[i];
+                if(h == k_octree_invalid)
+                    continue;
+                vec3f ip;
+                if(aabb_vs_frustum((mins[i] + maxs[i]) * 0.5f, (maxs[i] - mins[i]) * 0.5f, planes))
+                    frustum_expected.push_back(h);
+                if(aabb_vs_aabb(mins[i], maxs[i], qmin, qmax))
+                    box_expected.push_back(h);
+                if(ray_vs_aabb(mins[i], maxs[i], r1, rv, ip))
+                    ray_expected.push_back(h);
+            }
+
+            std::sort(frustum.begin(), frustum.end());
+            std::sort(box.begin(), box.end());
+            std::sort(ray.begin(), ray.end());
+            std::sort(frustum_expected.begin(), frustum_expected.end());
+            std::sort(box_expected.begin(), box_expected.end());
+            std::sort(ray_expected.begin(), ray_expected.end());
+            ok &= frustum == frustum_expected;
+            ok &= box == box_expected;
+            ok &= ray == ray_expected;
+        }
+        return ok;
+    };
+    REQUIRE(check());
+
+    // move everything a little for several frames, and some objects a long way
+    for(u32 frame = 0; frame < 10; ++frame)
+    {
+        for(u32 i = 0; i < n; ++i)
+        {
+            if(i % 50 == 0)
+            {
+                random_box(mins[i], maxs[i]);
+            }
+            else
+            {
+                vec3f v = (vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) - vec3f(0.5f)) * 4.0f;
+                mins[i] += v;
+                maxs[i] += v;
+            }
+            tree.update(handles[i], mins[i], maxs[i]);
+        }
+    }
+    REQUIRE(tree.size() == n);
+    REQUIRE(check());
+
+    vec3f gmin, gmax;
+    tree.get_aabb(handles[10], gmin, gmax);
+    REQUIRE(gmin == mins[10]);
+    REQUIRE(gmax == maxs[10]);
+
+    // removing objects recycles handles and nodes
+    for(u32 i = 0; i < n; i += 2)
+    {
+        tree.remove(handles[i]);
+        handles[i] = k_octree_invalid;
+    }
+    REQUIRE(tree.size() == n / 2);
+    REQUIRE(check());
+
+    u32 reused = tree.insert(vec3f(-1.0f), vec3f(1.0f));
+    REQUIRE(reused < n);
+    tree.remove(reused);
+
+    size_t nodes = tree.node_count();
+    for(u32 i = 1; i < n; i += 2)
+        tree.remove(handles[i]);
+    REQUIRE(tree.size() == 0);
+    REQUIRE(tree.node_count() == 1);
+    REQUIRE(nodes > 1);
+
+    // a box containing the whole tree accepts every subtree without per object tests
+    for(u32 i = 0; i < 100; ++i)
+        tree.insert(vec3f((f32)i), vec3f((f32)i + 0.5f));
+    std::vector<u32> all_in;
+    tree.query_aabb(vec3f(-1000.0f), vec3f(1000.0f), all_in);
+    REQUIRE(all_in.size() == 100);
+}
+
+TEST_CASE( "RTree Polygon Index", "[rtree]")
+{
+    // star shaped (concave) regions, some overlapping
+    pcg32 rng(43);
+    const u32 np = 800;
+    std::vector<std::vector<vec2f>> polys(np);
+    for(auto& poly : polys)
+    {
+        vec2f c = vec2f(rng.next_f32(), rng.next_f32()) * 1000.0f;
+        f32 r = 2.0f + rng.next_f32() * 15.0f;
+        u32 sides = 5 + rng.next_bounded(8);
+        for(u32 i = 0; i < sides; ++i)
+        {
+            f32 a = (f32)i / (f32)sides * 2.0f * F_PI;
+            f32 ri = i % 2 ? r * 0.5f : r;
+            poly.push_back(c + vec2f(cos(a), sin(a)) * ri);
+        }
+    }
+
+    polygon_index index;
+    index.build(polys);
+    REQUIRE(index.size() == np);
+
+    // point queries against brute force
+    const u32 nq = 5000;
+    std::vector<vec2f> points(nq);
+    for(auto& p : points)
+        p = vec2f(rng.next_f32(), rng.next_f32()) * 1000.0f;
+    for(u32 i = 0; i < 200; ++i)
+        points[i] = polys[i][0] * 0.5f + polys[i][3] * 0.5f;
+
+    std::vector<u32> found(nq);
+    index.find_polygon(points.data(), nq, found.data());
+
+    bool ok = true;
+    u32 hits = 0;
+    for(u32 i = 0; i < nq; ++i)
+    {
+        u32 expected = k_rtree_invalid;
+        std::vector<u32> all_expected;
+        for(u32 j = 0; j < np; ++j)
+        {
+            if(point_inside_poly(points[i], polys[j]))
+            {
+                if(expected == k_rtree_invalid)
+                    expected = j;
+                all_expected.push_back(j);
+            }
+        }
+        hits += expected != k_rtree_invalid ? 1 : 0;
+        ok &= found[i] == expected;
+        ok &= index.find_polygon(points[i]) == expected;
+
+        std::vector<u32> all;
+        index.find_polygons(points[i], all);
+        std::sort(all.begin(), all.end());
+        ok &= all == all_expected;
+    }
+    REQUIRE(ok);
+    REQUIRE(hits >= 200);
+
+    // segment queries
+    for(u32 i = 0; i < 300; ++i)
+    {
+        vec2f a = vec2f(rng.next_f32(), rng.next_f32()) * 1000.0f;
+        vec2f b = a + (vec2f(rng.next_f32(), rng.next_f32()) - vec2f(0.5f)) * (i % 3 ? 60.0f : 0.0f);
+        if(i % 7 == 0)
+            b = vec2f(a.x, a.y + 50.0f);
+
+        std::vector<u32> crossed, expected;
+        index.find_polygons(a, b, crossed);
+        std::sort(crossed.begin(), crossed.end());
+        std::vector<vec2f> ips;
+        for(u32 j = 0; j < np; ++j)
+            if(line_vs_poly(a, b, polys[j], ips) || point_inside_poly(a, polys[j]))
+                expected.push_back(j);
+        ok &= crossed == expected;
+    }
+    REQUIRE(ok);
+
+    // box queries and segment vs aabb
+    const rtree& tree = index.tree();
+    for(u32 i = 0; i < 100; ++i)
+    {
+        vec2f qmin = vec2f(rng.next_f32(), rng.next_f32()) * 1000.0f;
+        vec2f qmax = qmin + vec2f(rng.next_f32(), rng.next_f32()) * 100.0f;
+        std::vector<u32> in_box, expected;
+        tree.query_aabb(qmin, qmax, in_box);
+        std::sort(in_box.begin(), in_box.end());
+        for(u32 j = 0; j < np; ++j)
+        {
+            vec2f bmin(FLT_MAX), bmax(-FLT_MAX);
+            for(auto& v : polys[j])
+            {
+                bmin = min_union(bmin, v);
+                bmax = max_union(bmax, v);
+            }
+            if(bmin.x <= qmax.x && bmax.x >= qmin.x && bmin.y <= qmax.y && bmax.y >= qmin.y)
+                expected.push_back(j);
+        }
+        ok &= in_box == expected;
+    }
+    REQUIRE(ok);
+
+    REQUIRE(segment_vs_aabb(vec2f(-1.0f, 0.5f), vec2f(2.0f, 0.5f), vec2f(0.0f), vec2f(1.0f)));
+    REQUIRE(segment_vs_aabb(vec2f(0.5f, 0.5f), vec2f(0.6f, 0.6f), vec2f(0.0f), vec2f(1.0f)));
+    REQUIRE(!segment_vs_aabb(vec2f(-1.0f, 0.5f), vec2f(0.5f, 3.0f), vec2f(0.0f), vec2f(1.0f)));
+    REQUIRE(!segment_vs_aabb(vec2f(2.0f, 0.0f), vec2f(3.0f, 1.0f), vec2f(0.0f), vec2f(1.0f)));
+
+    polygon_index empty;
+    empty.build({});
+    u32 none;
+    empty.find_polygon(points.data(), 1, &none);
+    REQUIRE(none == k_rtree_invalid);
+}
+
+TEST_CASE( "Grid Ray Traversal", "[voxel]")
+{
+    uniform_grid3 grid;
+    grid.origin = vec3f(-8.0f, -4.0f, -6.0f);
+    grid.cell_size = vec3f(1.0f, 0.5f, 2.0f);
+    grid.dims = vec3i(16, 16, 6);
+    vec3f grid_max = grid.origin + grid.cell_size * vec3f(16.0f, 16.0f, 6.0f);
+
+    auto cell_of = [&](const vec3f& p) {
+        vec3f c = (p - grid.origin) / grid.cell_size;
+        return vec3i((int)floor(c.x), (int)floor(c.y), (int)floor(c.z));
+    };
+
+    // every cell a dense march lands in must be visited in the same order, and each step moves to a face neighbour
+    pcg32 rng(7);
+    bool ok = true;
+    u32 inside = 0;
+    for (u32 r = 0; r < 500; ++r)
+    {
+        vec3f r1 = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 30.0f - vec3f(15.0f);
+        vec3f rv = vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 2.0f - vec3f(1.0f);
+        if (r % 10 == 0)
+            rv = vec3f(rv.x, 0.0f, 0.0f);
+        f32 max_t = r % 3 ? 100.0f : 10.0f;
+
+        std::vector<vec3i> cells;
+        std::vector<vec2f> ts;
+        grid_raycast(grid, r1, rv, max_t, [&](const vec3i& c, f32 t0, f32 t1) {
+            cells.push_back(c);
+            ts.push_back(vec2f(t0, t1));
+            return true;
+        });
+
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            ok &= ts[i].x <= ts[i].y && ts[i].x >= 0.0f && ts[i].y <= max_t;
+            if (i > 0)
+            {
+                vec3i d = cells[i] - cells[i - 1];
+                ok &= abs(d.x) + abs(d.y) + abs(d.z) == 1;
+                ok &= ts[i].x == Approx(ts[i - 1].y);
+            }
+
+            // the middle of each interval is inside the cell
+            vec3f mid = r1 + rv * ((ts[i].x + ts[i].y) * 0.5f);
+            vec3i mc = cell_of(mid);
+            if (ts[i].y - ts[i].x > 1e-3f)
+                ok &= mc == cells[i];
+        }
+
+        size_t next = 0;
+        for (u32 s = 0; s <= 20000; ++s)
+        {
+            f32 t = max_t * (f32)s / 20000.0f;
+            vec3f p = r1 + rv * t;
+            if (p.x <= grid.origin.x || p.y <= grid.origin.y || p.z <= grid.origin.z)
+                continue;
+            if (p.x >= grid_max.x || p.y >= grid_max.y || p.z >= grid_max.z)
+                continue;
+
+            vec3i c = cell_of(p);
+            while (next < cells.size() && !(cells[next] == c))
+                ++next;
+            ok &= next < cells.size();
+            inside++;
+        }
+    }
+    REQUIRE(ok);
+    REQUIRE(inside > 0);
+
+    // origin inside the grid starts in its own cell at t 0
+    grid_ray3 it(grid, vec3f(0.25f, 0.1f, 0.5f), vec3f(1.0f, 0.0f, 0.0f));
+    REQUIRE(it.valid());
+    REQUIRE(it.cell() == vec3i(8, 8, 3));
+    REQUIRE(it.t_entry() == 0.0f);
+    REQUIRE(it.t_exit() == Approx(0.75f));
+    u32 count = 0;
+    for (; it.valid(); it.next())
+        count++;
+    REQUIRE(count == 8);
+
+    // misses, behind and degenerate rays
+    REQUIRE(!grid_ray3(grid, vec3f(-20.0f, 0.0f, 0.0f), vec3f(-1.0f, 0.0f, 0.0f)).valid());
+    REQUIRE(!grid_ray3(grid, vec3f(-20.0f, 50.0f, 0.0f), vec3f(1.0f, 0.0f, 0.0f)).valid());
+    REQUIRE(!grid_ray3(grid, vec3f(-20.0f, 0.0f, 0.0f), vec3f(1.0f, 0.0f, 0.0f), 5.0f).valid());
+    REQUIRE(!grid_ray3(grid, vec3f(0.0f), vec3f(0.0f)).valid());
+
+    // 2d
+    uniform_grid2 grid2;
+    grid2.origin = vec2f(0.0f);
+    grid2.cell_size = vec2f(1.0f);
+    grid2.dims = vec2i(8, 8);
+
+    std::vector<vec2i> cells2;
+    grid_ray_cells(grid2, vec2f(-1.0f, 0.5f), vec2f(1.0f, 1.0f), FLT_MAX, cells2);
+    REQUIRE(cells2.size() == 13);
+    REQUIRE(cells2[0] == vec2i(0, 1));
+    REQUIRE(cells2.back() == vec2i(6, 7));
+    for (size_t i = 1; i < cells2.size(); ++i)
+    {
+        vec2i d = cells2[i] - cells2[i - 1];
+        REQUIRE(abs(d.x) + abs(d.y) == 1);
+    }
+
+    // line of sight through a wall at x = 4
+    auto wall = [](const vec2i& c) { return c.x == 4 && c.y < 6; };
+    REQUIRE(!grid_line_of_sight(grid2, vec2f(0.5f, 0.5f), vec2f(7.5f, 0.5f), wall));
+    REQUIRE(grid_line_of_sight(grid2, vec2f(0.5f, 7.5f), vec2f(7.5f, 7.5f), wall));
+    REQUIRE(grid_line_of_sight(grid2, vec2f(0.5f, 0.5f), vec2f(3.5f, 5.5f), wall));
+}
+
+TEST_CASE( "Sparse Voxel Grid", "[voxel]")
+{
+    // vec hash is usable as an unordered_map key and spreads diagonal coordinates
+    REQUIRE(hash(vec3i(1, 1, 0)) != hash(vec3i(2, 2, 0)));
+    REQUIRE(hash(vec3i(1, 2, 3)) == hash(vec3i(1, 2, 3)));
+    REQUIRE(hash(vec3i(-1, 0, 0)) != hash(vec3i(1, 0, 0)));
+    REQUIRE(hash(vec3i(0, -1, 0)) != hash(vec3i(0, 0, -1)));
+
+    REQUIRE(voxel_block(vec3i(-1, 8, 15)) == vec3i(-1, 1, 1));
+    REQUIRE(voxel_block_offset(vec3i(-1, 8, 15)) == 7 + 0 + 7 * 64);
+    REQUIRE(voxel_from_block(vec3i(-1, 1, 1), 7 + 7 * 64) == vec3i(-1, 8, 15));
+
+    sparse_gridf grid;
+    grid.init(vec3f(0.0f), 0.5f, 3.0f);
+    REQUIRE(grid.get(vec3i(100, -100, 5)) == 3.0f);
+    REQUIRE(grid.block_count() == 0);
+
+    grid.set(vec3i(-3, 4, 9), 1.0f);
+    grid.set(vec3i(8, 4, 9), 2.0f);
+    REQUIRE(grid.block_count() == 2);
+    REQUIRE(grid.get(vec3i(-3, 4, 9)) == 1.0f);
+    REQUIRE(grid.get(vec3i(8, 4, 9)) == 2.0f);
+    REQUIRE(grid.get(vec3i(-1, 4, 9)) == 3.0f);
+
+    // iterator covers every voxel of the allocated blocks
+    size_t n = 0;
+    f32 sum = 0.0f;
+    for (auto it = grid.begin(); it != grid.end(); ++it)
+    {
+        REQUIRE(grid.get(it.voxel()) == *it);
+        sum += *it;
+        ++n;
+    }
+    REQUIRE(n == 2 * k_voxel_block_voxels);
+    REQUIRE(sum == Approx(3.0f * (f32)(n - 2) + 3.0f));
+
+    // sampling a linear field is exact, inside blocks and across block boundaries
+    sparse_gridf ramp;
+    ramp.init(vec3f(-4.0f), 0.25f, 0.0f);
+    auto field = [](const vec3f& p) { return p.x * 2.0f - p.y + p.z * 0.5f; };
+    for (int z = 0; z < 32; ++z)
+        for (int y = 0; y < 32; ++y)
+            for (int x = 0; x < 32; ++x)
+                ramp.set(vec3i(x, y, z), field(ramp.voxel_to_world(vec3i(x, y, z))));
+    REQUIRE(ramp.block_count() == 64);
+
+    pcg32 rng(3);
+    bool ok = true;
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        vec3f p = vec3f(-4.0f) + vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) * 7.7f;
+        ok &= fabs(ramp.sample(p) - field(p)) < 1e-4f;
+    }
+    REQUIRE(ok);
+
+    // narrow band sphere
+    sparse_gridf sdf;
+    sdf.init(vec3f(0.0f), 1.0f / 64.0f, 0.0f);
+    const f32 band = 3.0f / 64.0f;
+    auto sphere = [](const vec3f& p) { return mag(p - vec3f(0.5f)) - 0.3f; };
+    sdf.fill_narrow_band(sphere, vec3f(0.0f), vec3f(1.0f), band);
+
+    // dense would be 9^3 blocks, the band only needs those near the surface
+    REQUIRE(sdf.block_count() > 0);
+    REQUIRE(sdf.block_count() < 9 * 9 * 9 / 2);
+    REQUIRE(sdf.get(vec3i(100, 100, 100)) == band);
+    REQUIRE(sdf.get(vec3i(32, 32, 32)) == -band);
+    REQUIRE(sdf.sample(vec3f(0.5f)) == -band);
+    REQUIRE(sdf.sample(vec3f(0.05f)) == band);
+
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        vec3f d = normalised(vec3f(rng.next_f32(), rng.next_f32(), rng.next_f32()) - vec3f(0.5f));
+        vec3f p = vec3f(0.5f) + d * (0.3f + (rng.next_f32() - 0.5f) * 0.06f);
+        ok &= fabs(sdf.sample(p) - sphere(p)) < 1e-3f;
+    }
+    REQUIRE(ok);
+
+    // occupancy bits
+    sparse_bit_grid bits;
+    REQUIRE(!bits.get(vec3i(0)));
+    bits.set(vec3i(0), false);
+    REQUIRE(bits.block_count() == 0);
+    std::vector<vec3i> set_voxels = {vec3i(0, 0, 0), vec3i(7, 7, 7), vec3i(-1, 0, 0), vec3i(63, 1, 2), vec3i(1, 63, 2)};
+    for (auto& v : set_voxels)
+        bits.set(v);
+    REQUIRE(bits.count() == set_voxels.size());
+    REQUIRE(bits.block_count() == 4);
+    for (auto& v : set_voxels)
+        REQUIRE(bits.get(v));
+    REQUIRE(!bits.get(vec3i(6, 7, 7)));
+    bits.set(vec3i(7, 7, 7), false);
+    REQUIRE(!bits.get(vec3i(7, 7, 7)));
+
+    std::vector<vec3i> visited;
+    bits.for_each([&](const vec3i& v) { visited.push_back(v); });
+    REQUIRE(visited.size() == 4);
+    for (auto& v : visited)
+        REQUIRE(bits.get(v));
+}
+
+namespace
+{
+    // true if every edge is shared by exactly two triangles with opposite winding, volume_out is the signed volume
+    bool closed_mesh(const iso_mesh& mesh, f32& volume_out)
+    {
+        std::map<std::pair<u32, u32>, u32> edges;
+        volume_out = 0.0f;
+        for(size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            const u32* t = &mesh.indices[i];
+            volume_out += dot(mesh.positions[t[0]], cross(mesh.positions[t[1]], mesh.positions[t[2]])) / 6.0f;
+            for(u32 e = 0; e < 3; ++e)
+                edges[std::make_pair(t[e], t[(e + 1) % 3])]++;
+        }
+
+        for(auto& e : edges)
+        {
+            if(e.second != 1)
+                return false;
+            auto it = edges.find(std::make_pair(e.first.second, e.first.first));
+            if(it == edges.end() || it->second != 1)
+                return false;
+        }
+        return !mesh.indices.empty();
+    }
+}
+
+TEST_CASE( "Isosurface", "[isosurface]")
+{
+    mat3 m;
+    f32 mv[9] = {4.0f, 1.0f, 0.5f, 1.0f, 3.0f, 0.25f, 0.5f, 0.25f, 2.0f};
+    for(u32 i = 0; i < 9; ++i)
+        m.m[i] = mv[i];
+    mat3 mi = m * mat::inverse3x3(m);
+    for(u32 r = 0; r < 3; ++r)
+        for(u32 c = 0; c < 3; ++c)
+            REQUIRE(mi.at(r, c) == Approx(r == c ? 1.0f : 0.0f).margin(1e-5f));
+
+    // every case of the table closes up when the cube is surrounded by outside voxels
+    bool ok = true;
+    for(u32 cube = 1; cube < 255; ++cube)
+    {
+        std::vector<f32> values(4 * 4 * 4, 1.0f);
+        for(u32 i = 0; i < 8; ++i)
+        {
+            vec3i c = vec3i(1) + iso_cube_corner(i);
+            values[(c.z * 4 + c.y) * 4 + c.x] = cube & (1 << i) ? -1.0f : 1.0f;
+        }
+
+        serial_executor serial;
+        iso_mesh mesh;
+        marching_cubes(serial, values.data(), vec3i(4), vec3f(0.0f), 1.0f, 0.0f, mesh);
+        f32 volume;
+        ok &= closed_mesh(mesh, volume) && volume > 0.0f;
+    }
+    REQUIRE(ok);
+
+    // dense sphere
+    const int n = 40;
+    const f32 h = 1.0f / (f32)(n - 1);
+    const vec3f centre = vec3f(0.5f);
+    const f32 radius = 0.35f;
+    std::vector<f32> values(n * n * n);
+    for(int z = 0; z < n; ++z)
+        for(int y = 0; y < n; ++y)
+            for(int x = 0; x < n; ++x)
+                values[(z * n + y) * n + x] = mag(vec3f((f32)x, (f32)y, (f32)z) * h - centre) - radius;
+
+    thread_pool pool(4);
+    serial_executor serial;
+    iso_mesh mc, mc_serial;
+    marching_cubes(pool, values.data(), vec3i(n), vec3f(0.0f), h, 0.0f, mc);
+    marching_cubes(serial, values.data(), vec3i(n), vec3f(0.0f), h, 0.0f, mc_serial);
+    REQUIRE(mc.indices == mc_serial.indices);
+    REQUIRE(mc.positions.size() == mc_serial.positions.size());
+
+    f32 volume;
+    f32 sphere_volume = 4.0f / 3.0f * F_PI * radius * radius * radius;
+    REQUIRE(closed_mesh(mc, volume));
+    REQUIRE(volume == Approx(sphere_volume).epsilon(0.01f));
+    for(size_t i = 0; i < mc.positions.size(); ++i)
+    {
+        ok &= fabs(dist(mc.positions[i], centre) - radius) < h * 0.05f;
+        ok &= dot(mc.normals[i], normalised(mc.positions[i] - centre)) > 0.99f;
+    }
+    REQUIRE(ok);
+
+    // sparse narrow band sphere matches the dense one
+    sparse_gridf sdf;
+    sdf.init(vec3f(0.0f), h, 0.0f);
+    sdf.fill_narrow_band([&](const vec3f& p) { return mag(p - centre) - radius; }, vec3f(0.0f), vec3f(1.0f), h * 3.0f);
+
+    iso_mesh sparse_mc;
+    marching_cubes(pool, sdf, 0.0f, sparse_mc);
+    REQUIRE(closed_mesh(sparse_mc, volume));
+    REQUIRE(volume == Approx(sphere_volume).epsilon(0.01f));
+    REQUIRE(sparse_mc.positions.size() == mc.positions.size());
+    REQUIRE(sparse_mc.indices.size() == mc.indices.size());
+
+    // dual contouring a box keeps its corners
+    const vec3f half = vec3f(0.3f, 0.2f, 0.25f);
+    auto box = [&](const vec3f& p) {
+        vec3f d = vec3f(fabs(p.x - 0.5f), fabs(p.y - 0.5f), fabs(p.z - 0.5f)) - half;
+        return mag(max_union(d, vec3f(0.0f))) + min(max(d.x, max(d.y, d.z)), 0.0f);
+    };
+    for(int z = 0; z < n; ++z)
+        for(int y = 0; y < n; ++y)
+            for(int x = 0; x < n; ++x)
+                values[(z * n + y) * n + x] = box(vec3f((f32)x, (f32)y, (f32)z) * h + vec3f(0.013f));
+
+    iso_mesh dc, dc_serial;
+    dual_contouring(pool, values.data(), vec3i(n), vec3f(0.013f), h, 0.0f, dc);
+    dual_contouring(serial, values.data(), vec3i(n), vec3f(0.013f), h, 0.0f, dc_serial);
+    REQUIRE(dc.indices == dc_serial.indices);
+    REQUIRE(closed_mesh(dc, volume));
+    REQUIRE(volume == Approx(8.0f * half.x * half.y * half.z).epsilon(0.01f));
+
+    for(auto& p : dc.positions)
+        ok &= fabs(box(p)) < h * 0.25f;
+    REQUIRE(ok);
+
+    // normals come from central differences so corners are not exact, but much closer than marching cubes
+    iso_mesh box_mc;
+    marching_cubes(pool, values.data(), vec3i(n), vec3f(0.013f), h, 0.0f, box_mc);
+    f32 dc_corner = FLT_MAX, mc_corner = FLT_MAX;
+    for(auto& p : dc.positions)
+        dc_corner = min(dc_corner, dist(p, vec3f(0.5f) + half));
+    for(auto& p : box_mc.positions)
+        mc_corner = min(mc_corner, dist(p, vec3f(0.5f) + half));
+    REQUIRE(dc_corner < h * 0.5f);
+    REQUIRE(dc_corner < mc_corner * 0.5f);
+
+    // dual contouring the sparse sphere
+    iso_mesh sparse_dc;
+    dual_contouring(pool, sdf, 0.0f, sparse_dc);
+    REQUIRE(closed_mesh(sparse_dc, volume));
+    REQUIRE(volume == Approx(sphere_volume).epsilon(0.01f));
+}
@@ -0,0 +1,665 @@
+// binary.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "mat.h"
+#include "quat.h"
+#include "vec.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#undef min
+#undef max
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// versioned binary container for arrays of Vec, Mat, Quat and scalars.
+// file layout:
+//  binary_header
+//  section data, each section (and each soa component array) is aligned to k_binary_alignment
+//  binary_section table (written last so sections can be streamed without knowing their sizes up front)
+// data is stored in native byte order, the header contains an endian marker and files written on a machine with different
+// endianness are rejected on open.
+
+namespace maths
+{
+    constexpr u32    k_binary_magic     = 0x5348544d; // "MTHS"
+    constexpr u32    k_binary_version   = 1;
+    constexpr u32    k_binary_endian    = 0x01020304;
+    constexpr size_t k_binary_alignment = 64;
+    constexpr size_t k_binary_name_len  = 48;
+
+    enum e_binary_layout
+    {
+        AOS = 0, // array of structures, elements are stored contiguously: xyzxyzxyz
+        SOA = 1  // structure of arrays, each component is stored in its own array: xxx yyy zzz
+    };
+
+    enum e_binary_kind
+    {
+        BINARY_SCALAR = 0,
+        BINARY_VEC    = 1,
+        BINARY_MAT    = 2,
+        BINARY_QUAT   = 3
+    };
+
+    enum e_binary_scalar
+    {
+        BINARY_U8  = 0,
+        BINARY_S8  = 1,
+        BINARY_U16 = 2,
+        BINARY_S16 = 3,
+        BINARY_U32 = 4,
+        BINARY_S32 = 5,
+        BINARY_U64 = 6,
+        BINARY_S64 = 7,
+        BINARY_F32 = 8,
+        BINARY_F64 = 9
+    };
+
+    struct binary_header
+    {
+        u32 magic;
+        u32 version;
+        u32 endian;
+        u32 section_count;
+        u64 table_offset;
+        u64 file_size;
+    };
+
+    struct binary_section
+    {
+        char name[k_binary_name_len];
+        u32  kind;         // e_binary_kind
+        u32  scalar;       // e_binary_scalar
+        u32  rows;         // Vec<N> = N, Mat<R, C> = R, Quat = 4
+        u32  cols;         // Vec = 1, Mat<R, C> = C, Quat = 1
+        u32  layout;       // e_binary_layout
+        u32  element_size; // aos only: sizeof(T) including any padding, vec3f may be 16 bytes
+        u64  count;        // number of elements
+        u64  offset;       // byte offset of the section data from the start of the file
+        u64  size;         // size in bytes of the section data
+        u64  stride;       // soa only: byte offset between component arrays
+    };
+
+    // non owning typed view of contiguous data, points directly into the mapped file
+    template <typename T>
+    struct typed_span
+    {
+        T*     data = nullptr;
+        size_t count = 0;
+
+        T&       operator[](size_t i) { return data[i]; }
+        const T& operator[](size_t i) const { return data[i]; }
+        T*       begin() const { return data; }
+        T*       end() const { return data + count; }
+        size_t   size() const { return count; }
+        bool     empty() const { return count == 0; }
+    };
+
+    // type traits mapping element types to the description stored in a binary_section
+
+    template <typename T>
+    struct binary_scalar_traits;
+
+    #define BINARY_SCALAR_TRAITS(TYPE, ID)              \
+    template <>                                         \
+    struct binary_scalar_traits<TYPE>                   \
+    {                                                   \
+        static const u32 id = ID;                       \
+    }
+
+    BINARY_SCALAR_TRAITS(uint8_t, BINARY_U8);
+    BINARY_SCALAR_TRAITS(int8_t, BINARY_S8);
+    BINARY_SCALAR_TRAITS(uint16_t, BINARY_U16);
+    BINARY_SCALAR_TRAITS(int16_t, BINARY_S16);
+    BINARY_SCALAR_TRAITS(uint32_t, BINARY_U32);
+    BINARY_SCALAR_TRAITS(int32_t, BINARY_S32);
+    BINARY_SCALAR_TRAITS(uint64_t, BINARY_U64);
+    BINARY_SCALAR_TRAITS(int64_t, BINARY_S64);
+    BINARY_SCALAR_TRAITS(float, BINARY_F32);
+    BINARY_SCALAR_TRAITS(double, BINARY_F64);
+
+    #undef BINARY_SCALAR_TRAITS
+
+    template <typename T>
+    struct binary_type_traits
+    {
+        typedef T scalar;
+        static const u32 kind = BINARY_SCALAR;
+        static const u32 rows = 1;
+        static const u32 cols = 1;
+    };
+
+    template <size_t N, typename T>
+    struct binary_type_traits<Vec<N, T>>
+    {
+        typedef T scalar;
+        static const u32 kind = BINARY_VEC;
+        static const u32 rows = (u32)N;
+        static const u32 cols = 1;
+    };
+
+    template <size_t R, size_t C, typename T>
+    struct binary_type_traits<Mat<R, C, T>>
+    {
+        typedef T scalar;
+        static const u32 kind = BINARY_MAT;
+        static const u32 rows = (u32)R;
+        static const u32 cols = (u32)C;
+    };
+
+    template <typename T>
+    struct binary_type_traits<Quat<T>>
+    {
+        typedef T scalar;
+        static const u32 kind = BINARY_QUAT;
+        static const u32 rows = 4;
+        static const u32 cols = 1;
+    };
+
+    // size in bytes of an e_binary_scalar, 0 for unknown ids
+    maths_inline u32 binary_scalar_size(u32 scalar)
+    {
+        static const u32 k_sizes[] = {1, 1, 2, 2, 4, 4, 8, 8, 4, 8};
+        return scalar < sizeof(k_sizes) / sizeof(k_sizes[0]) ? k_sizes[scalar] : 0;
+    }
+
+    maths_inline u64 binary_align(u64 v)
+    {
+        return (v + (k_binary_alignment - 1)) & ~((u64)k_binary_alignment - 1);
+    }
+
+    // returns true if the section stores elements of type T
+    template <typename T>
+    inline bool binary_section_is(const binary_section& s)
+    {
+        typedef binary_type_traits<T> traits;
+        if (s.layout == AOS && s.element_size != sizeof(T))
+            return false;
+
+        return s.kind == traits::kind && s.rows == traits::rows && s.cols == traits::cols &&
+               s.scalar == binary_scalar_traits<typename traits::scalar>::id;
+    }
+
+    // streaming writer, sections can be written in one go or appended to in chunks.
+    // aos sections can be appended indefinitely, soa sections need the final element count (capacity) up front
+    // so each component array can be placed, appends are then scattered into the component arrays.
+    class binary_writer
+    {
+    public:
+        binary_writer() = default;
+        binary_writer(const binary_writer&) = delete;
+        binary_writer& operator=(const binary_writer&) = delete;
+
+        ~binary_writer()
+        {
+            close();
+        }
+
+        bool open(const char* filename)
+        {
+            close();
+            _file = fopen(filename, "wb");
+            if (!_file)
+                return false;
+
+            binary_header header = {};
+            _ok = fwrite(&header, sizeof(header), 1, _file) == 1;
+            _pos = sizeof(header);
+            _sections.clear();
+            _active = false;
+            return _ok;
+        }
+
+        // writes the section table and header, returns false if any write failed
+        bool close()
+        {
+            if (!_file)
+                return false;
+
+            if (_active)
+                end_section();
+
+            u64 table_offset = pad_to_alignment();
+            for (auto& s : _sections)
+                write(&s, sizeof(binary_section));
+
+            binary_header header;
+            header.magic = k_binary_magic;
+            header.version = k_binary_version;
+            header.endian = k_binary_endian;
+            header.section_count = (u32)_sections.size();
+            header.table_offset = table_offset;
+            header.file_size = _pos;
+
+            seek(0);
+            write(&header, sizeof(header));
+
+            if (fclose(_file) != 0)
+                _ok = false;
+            _file = nullptr;
+
+            bool ok = _ok;
+            _ok = false;
+            return ok;
+        }
+
+        // begin a section of elements of type T, capacity is required for soa layout
+        template <typename T>
+        bool begin_section(const char* name, e_binary_layout layout = AOS, size_t capacity = 0)
+        {
+            typedef binary_type_traits<T> traits;
+
+            if (!_file || _active)
+                return false;
+
+            if (layout == SOA && capacity == 0)
+                return false;
+
+            binary_section s = {};
+            strncpy(s.name, name, k_binary_name_len - 1);
+            s.kind = traits::kind;
+            s.scalar = binary_scalar_traits<typename traits::scalar>::id;
+            s.rows = traits::rows;
+            s.cols = traits::cols;
+            s.layout = (u32)layout;
+            s.element_size = layout == AOS ? (u32)sizeof(T) : 0;
+            s.offset = pad_to_alignment();
+
+            if (layout == SOA)
+            {
+                s.stride = binary_align(capacity * sizeof(typename traits::scalar));
+                s.size = s.stride * (traits::rows * traits::cols);
+            }
+
+            _capacity = capacity;
+            _current = s;
+            _active = true;
+            return true;
+        }
+
+        // append count elements to the active section
+        template <typename T>
+        bool append(const T* data, size_t count)
+        {
+            typedef binary_type_traits<T> traits;
+            typedef typename traits::scalar scalar;
+
+            if (!_active || !binary_section_is<T>(_current))
+                return false;
+
+            if (_current.layout == AOS)
+            {
+                write(data, sizeof(T) * count);
+                _current.count += count;
+                _current.size += sizeof(T) * count;
+                return _ok;
+            }
+
+            if (_current.count + count > _capacity)
+                return false;
+
+            // scatter components into their arrays
+            const u32           nc = traits::rows * traits::cols;
+            std::vector<scalar> scratch(count);
+            for (u32 c = 0; c < nc; ++c)
+            {
+                for (size_t i = 0; i < count; ++i)
+                    scratch[i] = ((const scalar*)&data[i])[c];
+
+                u64 dst = _current.offset + _current.stride * c + _current.count * sizeof(scalar);
+                seek(dst);
+                write(scratch.data(), sizeof(scalar) * count);
+            }
+            _current.count += count;
+            return _ok;
+        }
+
+        // finish the active section and add it to the table
+        bool end_section()
+        {
+            if (!_active)
+                return false;
+
+            if (_current.layout == SOA)
+            {
+                // extend the file over the whole reserved region, unwritten tail elements read back as zero
+                static const uint8_t zero = 0;
+                seek(_current.offset + _current.size - 1);
+                write(&zero, 1);
+            }
+
+            _sections.push_back(_current);
+            _active = false;
+            return _ok;
+        }
+
+        // write a complete section in one call
+        template <typename T>
+        bool write_section(const char* name, const T* data, size_t count, e_binary_layout layout = AOS)
+        {
+            if (!begin_section<T>(name, layout, layout == SOA ? max<size_t>(count, 1) : 0))
+                return false;
+
+            append(data, count);
+            return end_section();
+        }
+
+        template <typename T>
+        bool write_section(const char* name, const std::vector<T>& data, e_binary_layout layout = AOS)
+        {
+            return write_section(name, data.data(), data.size(), layout);
+        }
+
+    private:
+        void write(const void* data, size_t size)
+        {
+            if (size == 0)
+                return;
+            if (fwrite(data, 1, size, _file) != size)
+                _ok = false;
+            _pos += size;
+        }
+
+        void seek(u64 pos)
+        {
+#ifdef _WIN32
+            int err = _fseeki64(_file, (__int64)pos, SEEK_SET);
+#else
+            int err = fseeko(_file, (off_t)pos, SEEK_SET);
+#endif
+            if (err != 0)
+                _ok = false;
+            _pos = pos;
+        }
+
+        u64 pad_to_alignment()
+        {
+            static const uint8_t zeros[k_binary_alignment] = {};
+            u64 aligned = binary_align(_pos);
+            seek(_pos);
+            write(zeros, (size_t)(aligned - _pos));
+            return _pos;
+        }
+
+        FILE*                       _file = nullptr;
+        bool                        _ok = false;
+        bool                        _active = false;
+        u64                         _pos = 0;
+        size_t                      _capacity = 0;
+        binary_section              _current = {};
+        std::vector<binary_section> _sections;
+    };
+
+    // read only memory mapped view of a binary file, spans returned point directly into the mapping
+    // and are valid until the file is closed
+    class binary_file
+    {
+    public:
+        binary_file() = default;
+        binary_file(const binary_file&) = delete;
+        binary_file& operator=(const binary_file&) = delete;
+
+        ~binary_file()
+        {
+            close();
+        }
+
+        bool open(const char* filename)
+        {
+            close();
+            if (!map(filename))
+                return false;
+
+            if (!validate())
+            {
+                close();
+                return false;
+            }
+
+            return true;
+        }
+
+        void close()
+        {
+            unmap();
+            _header = nullptr;
+            _sections = nullptr;
+        }
+
+        bool is_open() const
+        {
+            return _header != nullptr;
+        }
+
+        size_t section_count() const
+        {
+            return _header ? _header->section_count : 0;
+        }
+
+        const binary_section& section(size_t index) const
+        {
+            return _sections[index];
+        }
+
+        // returns the section with name, or nullptr if it does not exist
+        const binary_section* find(const char* name) const
+        {
+            for (size_t i = 0; i < section_count(); ++i)
+                if (strncmp(_sections[i].name, name, k_binary_name_len) == 0)
+                    return &_sections[i];
+            return nullptr;
+        }
+
+        // returns a span over an aos section of type T, or an empty span if the name or type does not match
+        template <typename T>
+        typed_span<const T> get(const char* name) const
+        {
+            typed_span<const T> span;
+            const binary_section* s = find(name);
+            if (!s || s->layout != AOS || !binary_section_is<T>(*s))
+                return span;
+
+            span.data = (const T*)(_base + s->offset);
+            span.count = (size_t)s->count;
+            return span;
+        }
+
+        // returns a span over a single component array of an soa section of type T
+        // for Mat<R, C> components are indexed row major (r * C + c)
+        template <typename T>
+        typed_span<const typename binary_type_traits<T>::scalar> get_component(const char* name, size_t component) const
+        {
+            typedef typename binary_type_traits<T>::scalar scalar;
+            typed_span<const scalar> span;
+            const binary_section* s = find(name);
+            if (!s || s->layout != SOA || !binary_section_is<T>(*s) || component >= (size_t)(s->rows * s->cols))
+                return span;
+
+            span.data = (const scalar*)(_base + s->offset + s->stride * component);
+            span.count = (size_t)s->count;
+            return span;
+        }
+
+        const uint8_t* data() const
+        {
+            return _base;
+        }
+
+        size_t size() const
+        {
+            return _size;
+        }
+
+    private:
+        bool validate()
+        {
+            if (_size < sizeof(binary_header))
+                return false;
+
+            _header = (const binary_header*)_base;
+            if (_header->magic != k_binary_magic || _header->endian != k_binary_endian)
+                return false;
+
+            if (_header->version == 0 || _header->version > k_binary_version)
+                return false;
+
+            // a truncated or extended file no longer matches the size it was written with
+            if (_header->file_size != _size)
+                return false;
+
+            u64 table_size = (u64)_header->section_count * sizeof(binary_section);
+            if (!in_range(_header->table_offset, table_size) || _header->table_offset % alignof(binary_section) != 0)
+                return false;
+
+            _sections = (const binary_section*)(_base + _header->table_offset);
+            for (size_t i = 0; i < _header->section_count; ++i)
+                if (!validate_section(_sections[i]))
+                    return false;
+
+            return true;
+        }
+
+        // offset + size within the mapping, written so the sum cannot wrap
+        bool in_range(u64 offset, u64 size) const
+        {
+            return offset <= _size && size <= _size - offset;
+        }
+
+        // a * b without overflow
+        static bool checked_mul(u64 a, u64 b, u64& out)
+        {
+            if (a != 0 && b > UINT64_MAX / a)
+                return false;
+            out = a * b;
+            return true;
+        }
+
+        // the element count must fit in the section data, spans are cast to typed pointers so data must be aligned
+        bool validate_section(const binary_section& s) const
+        {
+            if (!in_range(s.offset, s.size) || s.offset % k_binary_alignment != 0)
+                return false;
+
+            u64 scalar_size = binary_scalar_size(s.scalar);
+            u64 components = (u64)s.rows * s.cols;
+            if (scalar_size == 0 || components == 0)
+                return false;
+
+            u64 bytes;
+            if (s.layout == AOS)
+                return s.element_size >= components * scalar_size && checked_mul(s.count, s.element_size, bytes) &&
+                       bytes <= s.size;
+
+            if (s.layout == SOA)
+                return s.stride % k_binary_alignment == 0 && checked_mul(s.stride, components, bytes) &&
+                       bytes <= s.size && checked_mul(s.count, scalar_size, bytes) && bytes <= s.stride;
+
+            return false;
+        }
+
+#ifdef _WIN32
+        bool map(const char* filename)
+        {
+            _file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (_file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+            {
+                unmap();
+                return false;
+            }
+
+            _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!_mapping)
+            {
+                unmap();
+                return false;
+            }
+
+            _base = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+            _size = (size_t)size.QuadPart;
+            if (!_base)
+            {
+                unmap();
+                return false;
+            }
+
+            return true;
+        }
+
+        void unmap()
+        {
+            if (_base)
+                UnmapViewOfFile(_base);
+            if (_mapping)
+                CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE)
+                CloseHandle(_file);
+
+            _base = nullptr;
+            _mapping = NULL;
+            _file = INVALID_HANDLE_VALUE;
+            _size = 0;
+        }
+
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = NULL;
+#else
+        bool map(const char* filename)
+        {
+            int fd = ::open(filename, O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                ::close(fd);
+                return false;
+            }
+
+            void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+
+            if (ptr == MAP_FAILED)
+                return false;
+
+            _base = (const uint8_t*)ptr;
+            _size = (size_t)st.st_size;
+            return true;
+        }
+
+        void unmap()
+        {
+            if (_base)
+                munmap((void*)_base, _size);
+
+            _base = nullptr;
+            _size = 0;
+        }
+#endif
+
+        const uint8_t*             _base = nullptr;
+        size_t                _size = 0;
+        const binary_header*  _header = nullptr;
+        const binary_section* _sections = nullptr;
+    };
+} // namespace maths
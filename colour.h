@@ -0,0 +1,286 @@
+// colour.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <functional>
+#include <vector>
+
+// 3d colour lookup tables for grading.
+// a lut maps rgb in 0-1 to rgb, it is stored as size^3 interleaved rgb f32 entries with red varying fastest then green
+// then blue (the same order as .cube files). inputs outside 0-1 are clamped to the edge of the table.
+
+namespace maths
+{
+    constexpr u32    k_colour_lut_default_size = 33;
+    constexpr size_t k_colour_lut_block = 64; // pixels located per pass by the soa apply
+
+    enum class e_lut_interpolation
+    {
+        trilinear,   // 8 entries blended with trilerp
+        tetrahedral  // 4 entries of the tetrahedron containing the colour, smoother along the neutral axis
+    };
+
+    class colour_lut3d
+    {
+    public:
+        typedef std::function<vec3f(const vec3f&)> colour_func;
+
+        // initialises an identity lut with size entries per axis, size must be at least 2
+        void init(u32 size = k_colour_lut_default_size)
+        {
+            bake(size, [](const vec3f& rgb) { return rgb; });
+        }
+
+        // bakes func into a lut with size entries per axis, func is evaluated once per entry
+        void bake(u32 size, const colour_func& func)
+        {
+            _size = max<u32>(size, 2);
+            _data.resize((size_t)_size * _size * _size * 3);
+
+            f32 scale = 1.0f / (f32)(_size - 1);
+            f32* d = _data.data();
+            for (u32 b = 0; b < _size; ++b)
+                for (u32 g = 0; g < _size; ++g)
+                    for (u32 r = 0; r < _size; ++r)
+                    {
+                        vec3f c = func(vec3f((f32)r * scale, (f32)g * scale, (f32)b * scale));
+                        d[0] = c.r;
+                        d[1] = c.g;
+                        d[2] = c.b;
+                        d += 3;
+                    }
+        }
+
+        // bakes a chain of functions applied in order, ie. chain[1](chain[0](rgb))
+        void bake(u32 size, const std::vector<colour_func>& chain)
+        {
+            bake(size, [&chain](const vec3f& rgb) {
+                vec3f c = rgb;
+                for (auto& f : chain)
+                    c = f(c);
+                return c;
+            });
+        }
+
+        u32 size() const
+        {
+            return _size;
+        }
+
+        const f32* data() const
+        {
+            return _data.data();
+        }
+
+        vec3f get(u32 r, u32 g, u32 b) const
+        {
+            const f32* e = entry(r, g, b);
+            return vec3f(e[0], e[1], e[2]);
+        }
+
+        void set(u32 r, u32 g, u32 b, const vec3f& rgb)
+        {
+            f32* e = &_data[(((size_t)b * _size + g) * _size + r) * 3];
+            e[0] = rgb.r;
+            e[1] = rgb.g;
+            e[2] = rgb.b;
+        }
+
+        vec3f sample(const vec3f& rgb, e_lut_interpolation interpolation = e_lut_interpolation::trilinear) const
+        {
+            vec3f out;
+            if (interpolation == e_lut_interpolation::tetrahedral)
+                sample_tetrahedral(rgb.r, rgb.g, rgb.b, out.r, out.g, out.b);
+            else
+                sample_trilinear(rgb.r, rgb.g, rgb.b, out.r, out.g, out.b);
+            return out;
+        }
+
+        // applies the lut to count interleaved pixels stride floats apart (3 for rgb, 4 for rgba).
+        // only the first 3 channels of each output pixel are written, out may be the same buffer as rgb.
+        void apply(const f32* rgb, size_t count, size_t stride, f32* out,
+                   e_lut_interpolation interpolation = e_lut_interpolation::trilinear) const
+        {
+            if (interpolation == e_lut_interpolation::tetrahedral)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const f32* p = rgb + i * stride;
+                    f32*       o = out + i * stride;
+                    sample_tetrahedral(p[0], p[1], p[2], o[0], o[1], o[2]);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const f32* p = rgb + i * stride;
+                    f32*       o = out + i * stride;
+                    sample_trilinear(p[0], p[1], p[2], o[0], o[1], o[2]);
+                }
+            }
+        }
+
+        // applies the lut to count pixels in soa channel arrays, outputs may alias the inputs.
+        // pixels are processed k_colour_lut_block at a time: cell indices and fractions for the whole block are
+        // computed from the channel arrays first, then the table entries are fetched and blended.
+        void apply(const f32* r, const f32* g, const f32* b, size_t count, f32* r_out, f32* g_out, f32* b_out,
+                   e_lut_interpolation interpolation = e_lut_interpolation::trilinear) const
+        {
+            u32 cell[k_colour_lut_block];
+            f32 fr[k_colour_lut_block];
+            f32 fg[k_colour_lut_block];
+            f32 fb[k_colour_lut_block];
+
+            for (size_t base = 0; base < count; base += k_colour_lut_block)
+            {
+                size_t n = min(k_colour_lut_block, count - base);
+                locate(r + base, g + base, b + base, n, cell, fr, fg, fb);
+
+                if (interpolation == e_lut_interpolation::tetrahedral)
+                {
+                    for (size_t i = 0; i < n; ++i)
+                        blend_tetrahedral(_data.data() + (size_t)cell[i] * 3, fr[i], fg[i], fb[i], r_out[base + i],
+                                          g_out[base + i], b_out[base + i]);
+                }
+                else
+                {
+                    for (size_t i = 0; i < n; ++i)
+                        blend_trilinear(_data.data() + (size_t)cell[i] * 3, fr[i], fg[i], fb[i], r_out[base + i],
+                                        g_out[base + i], b_out[base + i]);
+                }
+            }
+        }
+
+    private:
+        const f32* entry(u32 r, u32 g, u32 b) const
+        {
+            return &_data[(((size_t)b * _size + g) * _size + r) * 3];
+        }
+
+        // finds the cells containing count colours, writes the entry index of each cell's 000 corner and the
+        // fractional position within it. indices are 32 bit to avoid 64 bit vector multiplies, which limits tables
+        // to 1625 entries per axis (size^3 < 2^32)
+        void locate(const f32* r, const f32* g, const f32* b, size_t count, u32* cell, f32* fr, f32* fg,
+                    f32* fb) const
+        {
+            f32 max_cell = (f32)(_size - 1);
+            int top = (int)_size - 2;
+            u32 dg = _size;
+            u32 db = _size * _size;
+            for (size_t i = 0; i < count; ++i)
+            {
+                f32 x = saturate(r[i]) * max_cell;
+                f32 y = saturate(g[i]) * max_cell;
+                f32 z = saturate(b[i]) * max_cell;
+
+                // the top cell is size - 2 so x = 1 lands on its far corner. x is never negative here, so a signed
+                // conversion gives the same cell without the branch an unsigned one needs
+                int ix = min((int)x, top);
+                int iy = min((int)y, top);
+                int iz = min((int)z, top);
+
+                fr[i] = x - (f32)ix;
+                fg[i] = y - (f32)iy;
+                fb[i] = z - (f32)iz;
+                cell[i] = (u32)ix + (u32)iy * dg + (u32)iz * db;
+            }
+        }
+
+        void sample_trilinear(f32 r, f32 g, f32 b, f32& r_out, f32& g_out, f32& b_out) const
+        {
+            u32 cell;
+            f32 fr, fg, fb;
+            locate(&r, &g, &b, 1, &cell, &fr, &fg, &fb);
+            blend_trilinear(_data.data() + (size_t)cell * 3, fr, fg, fb, r_out, g_out, b_out);
+        }
+
+        void sample_tetrahedral(f32 r, f32 g, f32 b, f32& r_out, f32& g_out, f32& b_out) const
+        {
+            u32 cell;
+            f32 fr, fg, fb;
+            locate(&r, &g, &b, 1, &cell, &fr, &fg, &fb);
+            blend_tetrahedral(_data.data() + (size_t)cell * 3, fr, fg, fb, r_out, g_out, b_out);
+        }
+
+        // blends the 8 corners of the cell whose 000 corner is c
+        void blend_trilinear(const f32* c, f32 fr, f32 fg, f32 fb, f32& r_out, f32& g_out, f32& b_out) const
+        {
+            size_t dr = 3;
+            size_t dg = (size_t)_size * 3;
+            size_t db = (size_t)_size * _size * 3;
+
+            f32 out[3];
+            for (u32 k = 0; k < 3; ++k)
+                out[k] = trilerp(c[k], c[dr + k], c[dg + k], c[dr + dg + k], c[db + k], c[dr + db + k], c[dg + db + k],
+                                 c[dr + dg + db + k], fr, fg, fb);
+
+            r_out = out[0];
+            g_out = out[1];
+            b_out = out[2];
+        }
+
+        // splits the cell whose 000 corner is c into 6 tetrahedra sharing the 000-111 diagonal and blends the 4
+        // corners of the one containing the colour
+        void blend_tetrahedral(const f32* c, f32 fr, f32 fg, f32 fb, f32& r_out, f32& g_out, f32& b_out) const
+        {
+            size_t dr = 3;
+            size_t dg = (size_t)_size * 3;
+            size_t db = (size_t)_size * _size * 3;
+
+            // corners walked from 000 to 111 and their weights
+            size_t o1, o2;
+            f32    w0, w1, w2, w3;
+            if (fr > fg)
+            {
+                if (fg > fb)
+                {
+                    o1 = dr; o2 = dr + dg;
+                    w0 = 1.0f - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+                }
+                else if (fr > fb)
+                {
+                    o1 = dr; o2 = dr + db;
+                    w0 = 1.0f - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+                }
+                else
+                {
+                    o1 = db; o2 = dr + db;
+                    w0 = 1.0f - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+                }
+            }
+            else
+            {
+                if (fb > fg)
+                {
+                    o1 = db; o2 = dg + db;
+                    w0 = 1.0f - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+                }
+                else if (fb > fr)
+                {
+                    o1 = dg; o2 = dg + db;
+                    w0 = 1.0f - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+                }
+                else
+                {
+                    o1 = dg; o2 = dr + dg;
+                    w0 = 1.0f - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+                }
+            }
+
+            const f32* c1 = c + o1;
+            const f32* c2 = c + o2;
+            const f32* c3 = c + dr + dg + db;
+            r_out = w0 * c[0] + w1 * c1[0] + w2 * c2[0] + w3 * c3[0];
+            g_out = w0 * c[1] + w1 * c1[1] + w2 * c2[1] + w3 * c3[1];
+            b_out = w0 * c[2] + w1 * c1[2] + w2 * c2[2] + w3 * c3[2];
+        }
+
+        u32              _size = 0;
+        std::vector<f32> _data;
+    };
+} // namespace maths
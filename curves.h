@@ -0,0 +1,790 @@
+// curves.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <functional>
+#include <vector>
+
+// curve objects which do their expensive setup once so they can be evaluated many times per frame.
+// spline: catmull-rom through a list of control points, with per segment cubic coefficients and an arc length table.
+// bezier / bspline: evaluation, de casteljau splitting and tolerance based flattening into polylines, the 2d output can
+// be passed straight to line_vs_poly and point_inside_poly.
+// curve_table: any 1d shaping function (smooth_start, pcurve, exp_step..) baked into a table for cheap lookups.
+
+namespace maths
+{
+    constexpr u32 k_spline_arc_samples = 16;     // arc length table entries per segment
+    constexpr u32 k_spline_closest_samples = 8;  // coarse samples per segment before newton refinement
+    constexpr u32 k_spline_closest_iterations = 4;
+    constexpr u32 k_bezier_max_depth = 16;        // subdivision limit when flattening, 2^16 segments per curve
+    constexpr u32 k_bezier_max_segments = 1 << k_bezier_max_depth; // uniform segment limit for wang's formula
+    constexpr f32 k_bezier_min_tolerance = 1e-6f; // smaller, zero or nan tolerances are clamped to this
+    constexpr u32 k_curve_table_default_size = 256;
+
+    enum class e_curve_interpolation
+    {
+        linear, // lerp between the 2 nearest entries
+        cubic   // cubic_interp through the 4 nearest entries, smoother and more accurate for the same size
+    };
+
+    // catmull-rom spline through count control points, parameterised by t in 0-1 over the whole spline.
+    // alpha selects the knot spacing, 0 = uniform, 0.5 = centripetal (no cusps or self intersections), 1 = chordal.
+    // open splines extrapolate a phantom point at each end so the curve starts and ends on the first and last points.
+    template <size_t N, class T>
+    class spline
+    {
+    public:
+        typedef Vec<N, T> vec_t;
+
+        void init(const vec_t* points, size_t count, T alpha = T(0.5), bool loop = false,
+                  u32 arc_samples = k_spline_arc_samples)
+        {
+            _points.assign(points, points + count);
+            _loop = loop && count > 2;
+            _arc_samples = max<u32>(arc_samples, 1);
+
+            // an empty spline has no segments, positions and lengths evaluate to zero
+            if (count == 0)
+            {
+                _num_segments = 0;
+                _coeff.clear();
+                _aabb_min.clear();
+                _aabb_max.clear();
+                _arc.clear();
+                return;
+            }
+
+            _num_segments = count < 2 ? 1 : (u32)(_loop ? count : count - 1);
+
+            _coeff.resize(_num_segments * 4);
+            _aabb_min.resize(_num_segments);
+            _aabb_max.resize(_num_segments);
+            for (u32 i = 0; i < _num_segments; ++i)
+                build_segment(i, alpha);
+
+            build_arc_table();
+        }
+
+        size_t num_segments() const
+        {
+            return _num_segments;
+        }
+
+        bool loop() const
+        {
+            return _loop;
+        }
+
+        T length() const
+        {
+            return _arc.empty() ? T(0) : _arc.back();
+        }
+
+        vec_t position(T t) const
+        {
+            if (_num_segments == 0)
+                return vec_t(T(0));
+
+            T u;
+            const vec_t* c = segment(t, u);
+            return ((c[0] * u + c[1]) * u + c[2]) * u + c[3];
+        }
+
+        // derivative of position with respect to t
+        vec_t tangent(T t) const
+        {
+            if (_num_segments == 0)
+                return vec_t(T(0));
+
+            T u;
+            const vec_t* c = segment(t, u);
+            return ((T(3) * c[0] * u + T(2) * c[1]) * u + c[2]) * (T)_num_segments;
+        }
+
+        void position(const T* t, size_t count, vec_t* out) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = position(t[i]);
+        }
+
+        void tangent(const T* t, size_t count, vec_t* out) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = tangent(t[i]);
+        }
+
+        // arc length from the start of the spline to t
+        T distance_at_param(T t) const
+        {
+            if (_arc.empty())
+                return T(0);
+
+            T   f = saturate(t) * (T)(_num_segments * _arc_samples);
+            u32 k = min<u32>((u32)f, (u32)_arc.size() - 2);
+            return _arc[k] + arc_length(k, f - (T)k);
+        }
+
+        // inverse of distance_at_param, the table lookup is refined with a newton step on the true arc length
+        T param_at_distance(T s) const
+        {
+            if (_arc.empty())
+                return T(0);
+
+            return param_at_distance(s, find_arc(s, 0));
+        }
+
+        void param_at_distance(const T* s, size_t count, T* t_out) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                t_out[i] = param_at_distance(s[i]);
+        }
+
+        vec_t position_at_distance(T s) const
+        {
+            return position(param_at_distance(s));
+        }
+
+        // count points spaced at equal arc length from the start to the end of the spline, for constant speed motion.
+        // the distances are increasing so the table is walked forward instead of searched for each point.
+        void sample_uniform(size_t count, vec_t* out, vec_t* tangent_out = nullptr) const
+        {
+            if (_arc.empty())
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    out[i] = vec_t(T(0));
+                    if (tangent_out)
+                        tangent_out[i] = vec_t(T(0));
+                }
+                return;
+            }
+
+            T   step = count > 1 ? length() / (T)(count - 1) : T(0);
+            u32 k = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                T s = step * (T)i;
+                k = find_arc(s, k);
+                T t = param_at_distance(s, k);
+                out[i] = position(t);
+                if (tangent_out)
+                    tangent_out[i] = tangent(t);
+            }
+        }
+
+        // closest point on the spline to p, segments whose bounds are further than the best point found so far are
+        // skipped, starting from the segment with the nearest bounds
+        vec_t closest_point(const vec_t& p, T* t_out = nullptr) const
+        {
+            if (_num_segments == 0)
+            {
+                if (t_out)
+                    *t_out = T(0);
+                return vec_t(T(0));
+            }
+
+            u32 nearest = 0;
+            T   nearest_d2 = aabb_dist2(p, 0);
+            for (u32 i = 1; i < _num_segments; ++i)
+            {
+                T d2 = aabb_dist2(p, i);
+                if (d2 < nearest_d2)
+                {
+                    nearest_d2 = d2;
+                    nearest = i;
+                }
+            }
+
+            T     best_u;
+            vec_t best = closest_point_on_segment(nearest, p, best_u);
+            T     best_d2 = dist2(best, p);
+            u32   best_seg = nearest;
+
+            for (u32 i = 0; i < _num_segments; ++i)
+            {
+                if (i == nearest || aabb_dist2(p, i) >= best_d2)
+                    continue;
+
+                T     u;
+                vec_t cp = closest_point_on_segment(i, p, u);
+                T     d2 = dist2(cp, p);
+                if (d2 < best_d2)
+                {
+                    best_d2 = d2;
+                    best = cp;
+                    best_u = u;
+                    best_seg = i;
+                }
+            }
+
+            if (t_out)
+                *t_out = ((T)best_seg + best_u) / (T)_num_segments;
+
+            return best;
+        }
+
+        void closest_point(const vec_t* p, size_t count, vec_t* out, T* t_out = nullptr) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = closest_point(p[i], t_out ? &t_out[i] : nullptr);
+        }
+
+        // cubic coefficients of segment i, position = ((c[0] * u + c[1]) * u + c[2]) * u + c[3] for u in 0-1
+        const vec_t* coefficients(size_t i) const
+        {
+            return &_coeff[i * 4];
+        }
+
+        void segment_aabb(size_t i, vec_t& aabb_min, vec_t& aabb_max) const
+        {
+            aabb_min = _aabb_min[i];
+            aabb_max = _aabb_max[i];
+        }
+
+    private:
+        vec_t control_point(int64_t i) const
+        {
+            int64_t n = (int64_t)_points.size();
+            if (n == 1)
+                return _points[0];
+
+            if (_loop)
+                return _points[(size_t)(((i % n) + n) % n)];
+
+            if (i < 0)
+                return T(2) * _points[0] - _points[1];
+
+            if (i >= n)
+                return T(2) * _points[n - 1] - _points[n - 2];
+
+            return _points[(size_t)i];
+        }
+
+        // hermite form of the non uniform catmull-rom segment between control points i and i + 1
+        void build_segment(u32 i, T alpha)
+        {
+            vec_t p0 = control_point((int64_t)i - 1);
+            vec_t p1 = control_point(i);
+            vec_t p2 = control_point(i + 1);
+            vec_t p3 = control_point(i + 2);
+
+            const T eps = T(1e-6);
+            T dt0 = pow(dist2(p0, p1), alpha * T(0.5));
+            T dt1 = pow(dist2(p1, p2), alpha * T(0.5));
+            T dt2 = pow(dist2(p2, p3), alpha * T(0.5));
+
+            // coincident points would divide by zero, borrow the neighbouring spacing
+            if (dt1 < eps)
+                dt1 = T(1);
+            if (dt0 < eps)
+                dt0 = dt1;
+            if (dt2 < eps)
+                dt2 = dt1;
+
+            vec_t m1 = ((p1 - p0) / dt0 - (p2 - p0) / (dt0 + dt1) + (p2 - p1) / dt1) * dt1;
+            vec_t m2 = ((p2 - p1) / dt1 - (p3 - p1) / (dt1 + dt2) + (p3 - p2) / dt2) * dt1;
+
+            vec_t* c = &_coeff[i * 4];
+            c[0] = T(2) * p1 - T(2) * p2 + m1 + m2;
+            c[1] = T(-3) * p1 + T(3) * p2 - T(2) * m1 - m2;
+            c[2] = m1;
+            c[3] = p1;
+
+            // the curve lies inside the hull of its bezier control points
+            vec_t b0 = c[3];
+            vec_t b1 = c[3] + c[2] / T(3);
+            vec_t b2 = c[3] + (T(2) * c[2] + c[1]) / T(3);
+            vec_t b3 = c[0] + c[1] + c[2] + c[3];
+            _aabb_min[i] = min_union(min_union(b0, b1), min_union(b2, b3));
+            _aabb_max[i] = max_union(max_union(b0, b1), max_union(b2, b3));
+        }
+
+        void build_arc_table()
+        {
+            u32 n = _num_segments * _arc_samples;
+            _arc.resize(n + 1);
+            _arc[0] = T(0);
+            for (u32 k = 0; k < n; ++k)
+                _arc[k + 1] = _arc[k] + arc_length(k, T(1));
+        }
+
+        const vec_t* segment(T t, T& u) const
+        {
+            T   f = saturate(t) * (T)_num_segments;
+            u32 i = min<u32>((u32)f, _num_segments - 1);
+            u = f - (T)i;
+            return &_coeff[i * 4];
+        }
+
+        T speed(u32 seg, T u) const
+        {
+            const vec_t* c = &_coeff[seg * 4];
+            return mag((T(3) * c[0] * u + T(2) * c[1]) * u + c[2]);
+        }
+
+        // arc length over the first frac of table interval k, 3 point gauss-legendre quadrature of the speed
+        T arc_length(u32 k, T frac) const
+        {
+            static const T node = T(0.7745966692414834);
+            u32 seg = k / _arc_samples;
+            T   du = T(1) / (T)_arc_samples;
+            T   u0 = (T)(k % _arc_samples) * du;
+            T   h = frac * du * T(0.5);
+            T   mid = u0 + h;
+            T   s = T(5) * speed(seg, mid - h * node) + T(8) * speed(seg, mid) + T(5) * speed(seg, mid + h * node);
+            return s * h / T(9);
+        }
+
+        // index of the table interval containing s, searching forward from start
+        u32 find_arc(T s, u32 start) const
+        {
+            u32 last = (u32)_arc.size() - 2;
+            if (start >= last || s >= _arc[start + 1])
+            {
+                u32 lo = start, hi = last;
+                while (lo < hi)
+                {
+                    u32 mid = (lo + hi + 1) / 2;
+                    if (_arc[mid] <= s)
+                        lo = mid;
+                    else
+                        hi = mid - 1;
+                }
+                return lo;
+            }
+            return start;
+        }
+
+        T param_at_distance(T s, u32 k) const
+        {
+            s = max(min(s, length()), T(0));
+            T interval = _arc[k + 1] - _arc[k];
+            T frac = interval > T(0) ? (s - _arc[k]) / interval : T(0);
+
+            // one newton step, d(arc) / du is the speed
+            u32 seg = k / _arc_samples;
+            T   du = T(1) / (T)_arc_samples;
+            T   v = speed(seg, ((T)(k % _arc_samples) + frac) * du);
+            if (v > T(0))
+            {
+                T err = _arc[k] + arc_length(k, frac) - s;
+                frac = saturate(frac - err / (v * du));
+            }
+
+            return ((T)k + frac) / (T)(_num_segments * _arc_samples);
+        }
+
+        T aabb_dist2(const vec_t& p, u32 i) const
+        {
+            vec_t cp = closest_point_on_aabb(p, _aabb_min[i], _aabb_max[i]);
+            return dist2(cp, p);
+        }
+
+        // coarse samples find the nearest span, newton iterations on (P(u) - p) . P'(u) = 0 refine it
+        vec_t closest_point_on_segment(u32 seg, const vec_t& p, T& u_out) const
+        {
+            const vec_t* c = &_coeff[seg * 4];
+
+            T u = T(0);
+            T best = dist2(c[3], p);
+            for (u32 i = 1; i <= k_spline_closest_samples; ++i)
+            {
+                T     s = (T)i / (T)k_spline_closest_samples;
+                vec_t pos = ((c[0] * s + c[1]) * s + c[2]) * s + c[3];
+                T     d2 = dist2(pos, p);
+                if (d2 < best)
+                {
+                    best = d2;
+                    u = s;
+                }
+            }
+
+            for (u32 i = 0; i < k_spline_closest_iterations; ++i)
+            {
+                vec_t pos = ((c[0] * u + c[1]) * u + c[2]) * u + c[3];
+                vec_t d1 = (T(3) * c[0] * u + T(2) * c[1]) * u + c[2];
+                vec_t d2 = T(6) * c[0] * u + T(2) * c[1];
+                vec_t v = pos - p;
+                T     f = dot(v, d1);
+                T     df = dot(d1, d1) + dot(v, d2);
+                if (df <= T(0))
+                    break;
+                u = saturate(u - f / df);
+            }
+
+            u_out = u;
+            return ((c[0] * u + c[1]) * u + c[2]) * u + c[3];
+        }
+
+        std::vector<vec_t> _points;
+        std::vector<vec_t> _coeff;
+        std::vector<vec_t> _aabb_min;
+        std::vector<vec_t> _aabb_max;
+        std::vector<T>     _arc;
+        u32                _num_segments = 0;
+        u32                _arc_samples = k_spline_arc_samples;
+        bool               _loop = false;
+    };
+
+    typedef spline<2, f32> spline2f;
+    typedef spline<3, f32> spline3f;
+
+    template <class T>
+    inline T quadratic_bezier(f32 t, const T& p0, const T& p1, const T& p2)
+    {
+        f32 it = 1.0f - t;
+        return (it * it) * p0 + (2.0f * it * t) * p1 + (t * t) * p2;
+    }
+
+    template <class T>
+    inline T quadratic_bezier_tangent(f32 t, const T& p0, const T& p1, const T& p2)
+    {
+        return (2.0f * (1.0f - t)) * (p1 - p0) + (2.0f * t) * (p2 - p1);
+    }
+
+    template <class T>
+    inline T cubic_bezier(f32 t, const T& p0, const T& p1, const T& p2, const T& p3)
+    {
+        f32 it = 1.0f - t;
+        return (it * it * it) * p0 + (3.0f * it * it * t) * p1 + (3.0f * it * t * t) * p2 + (t * t * t) * p3;
+    }
+
+    template <class T>
+    inline T cubic_bezier_tangent(f32 t, const T& p0, const T& p1, const T& p2, const T& p3)
+    {
+        f32 it = 1.0f - t;
+        return (3.0f * it * it) * (p1 - p0) + (6.0f * it * t) * (p2 - p1) + (3.0f * t * t) * (p3 - p2);
+    }
+
+    // uniform cubic b-spline segment influenced by p0-p3, it runs near p1 to near p2 without passing through them
+    template <class T>
+    inline T bspline(f32 t, const T& p0, const T& p1, const T& p2, const T& p3)
+    {
+        f32 t2 = t * t;
+        f32 t3 = t2 * t;
+        f32 it = 1.0f - t;
+        return (1.0f / 6.0f) * ((it * it * it) * p0 + (3.0f * t3 - 6.0f * t2 + 4.0f) * p1 +
+                                (-3.0f * t3 + 3.0f * t2 + 3.0f * t + 1.0f) * p2 + t3 * p3);
+    }
+
+    template <class T>
+    inline T bspline_tangent(f32 t, const T& p0, const T& p1, const T& p2, const T& p3)
+    {
+        f32 it = 1.0f - t;
+        return 0.5f * ((-it * it) * p0 + (3.0f * t * t - 4.0f * t) * p1 + (-3.0f * t * t + 2.0f * t + 1.0f) * p2 +
+                       (t * t) * p3);
+    }
+
+    // the cubic bezier b0-b3 tracing the same curve as the b-spline segment p0-p3
+    template <class T>
+    inline void bspline_to_bezier(const T& p0, const T& p1, const T& p2, const T& p3, T& b0, T& b1, T& b2, T& b3)
+    {
+        b0 = (1.0f / 6.0f) * (p0 + 4.0f * p1 + p2);
+        b1 = (1.0f / 3.0f) * (2.0f * p1 + p2);
+        b2 = (1.0f / 3.0f) * (p1 + 2.0f * p2);
+        b3 = (1.0f / 6.0f) * (p1 + 4.0f * p2 + p3);
+    }
+
+    // de casteljau split at t, left covers 0-t and right t-1, both have 3 control points
+    template <class T>
+    inline void split_quadratic_bezier(f32 t, const T& p0, const T& p1, const T& p2, T* left, T* right)
+    {
+        T a = lerp(p0, p1, t);
+        T b = lerp(p1, p2, t);
+        T m = lerp(a, b, t);
+        left[0] = p0;
+        left[1] = a;
+        left[2] = m;
+        right[0] = m;
+        right[1] = b;
+        right[2] = p2;
+    }
+
+    // de casteljau split at t, left covers 0-t and right t-1, both have 4 control points
+    template <class T>
+    inline void split_cubic_bezier(f32 t, const T& p0, const T& p1, const T& p2, const T& p3, T* left, T* right)
+    {
+        T a = lerp(p0, p1, t);
+        T b = lerp(p1, p2, t);
+        T c = lerp(p2, p3, t);
+        T ab = lerp(a, b, t);
+        T bc = lerp(b, c, t);
+        T m = lerp(ab, bc, t);
+        left[0] = p0;
+        left[1] = a;
+        left[2] = ab;
+        left[3] = m;
+        right[0] = m;
+        right[1] = bc;
+        right[2] = c;
+        right[3] = p3;
+    }
+
+    // true if the chord p0-p3 is within tolerance of the curve (roger willcocks' bound, no square roots)
+    template <size_t N, class T>
+    inline bool cubic_bezier_flat(const Vec<N, T>& p0, const Vec<N, T>& p1, const Vec<N, T>& p2, const Vec<N, T>& p3,
+                                  T tolerance)
+    {
+        Vec<N, T> u = T(3) * p1 - T(2) * p0 - p3;
+        Vec<N, T> v = T(3) * p2 - p0 - T(2) * p3;
+        T         e = T(0);
+        for (size_t i = 0; i < N; ++i)
+            e += max(u[i] * u[i], v[i] * v[i]);
+        return e <= T(16) * tolerance * tolerance;
+    }
+
+    // number of uniform segments keeping a cubic within tolerance of its polyline (wang's formula), in the range
+    // [1, k_bezier_max_segments]
+    template <size_t N, class T>
+    inline u32 cubic_bezier_segments(const Vec<N, T>& p0, const Vec<N, T>& p1, const Vec<N, T>& p2,
+                                     const Vec<N, T>& p3, T tolerance)
+    {
+        if (!(tolerance > T(k_bezier_min_tolerance)))
+            tolerance = T(k_bezier_min_tolerance);
+
+        T m2 = max(mag2(p0 - T(2) * p1 + p2), mag2(p1 - T(2) * p2 + p3));
+        T n = sqrt(sqrt(m2) * T(0.75) / tolerance);
+        if (!(n < T(k_bezier_max_segments)))
+            return k_bezier_max_segments;
+
+        return max<u32>((u32)n + 1, 1);
+    }
+
+    // appends a polyline within tolerance of the curve to out. the curve is split in half with de casteljau until each
+    // piece is flat, so nearly straight spans emit few points. p0 is skipped if it is already the last point in out,
+    // which lets consecutive curves of a path share their end points.
+    template <size_t N, class T>
+    inline void flatten_cubic_bezier(const Vec<N, T>& p0, const Vec<N, T>& p1, const Vec<N, T>& p2,
+                                     const Vec<N, T>& p3, T tolerance, std::vector<Vec<N, T>>& out)
+    {
+        if (out.empty() || !(out.back() == p0))
+            out.push_back(p0);
+
+        struct piece
+        {
+            Vec<N, T> p[4];
+            u32       depth;
+        };
+
+        // depth first, right halves are pushed first so points come out in order
+        piece stack[k_bezier_max_depth + 1];
+        u32   sp = 1;
+        stack[0] = {{p0, p1, p2, p3}, 0};
+        while (sp > 0)
+        {
+            piece cur = stack[--sp];
+            if (cur.depth >= k_bezier_max_depth || cubic_bezier_flat(cur.p[0], cur.p[1], cur.p[2], cur.p[3], tolerance))
+            {
+                out.push_back(cur.p[3]);
+                continue;
+            }
+
+            piece& r = stack[sp++];
+            piece& l = stack[sp++];
+            split_cubic_bezier(0.5f, cur.p[0], cur.p[1], cur.p[2], cur.p[3], l.p, r.p);
+            l.depth = r.depth = cur.depth + 1;
+        }
+    }
+
+    // quadratics are degree elevated to cubics and flattened the same way
+    template <size_t N, class T>
+    inline void flatten_quadratic_bezier(const Vec<N, T>& p0, const Vec<N, T>& p1, const Vec<N, T>& p2, T tolerance,
+                                         std::vector<Vec<N, T>>& out)
+    {
+        Vec<N, T> c1 = p0 + (T(2) / T(3)) * (p1 - p0);
+        Vec<N, T> c2 = p2 + (T(2) / T(3)) * (p1 - p2);
+        flatten_cubic_bezier(p0, c1, c2, p2, tolerance, out);
+    }
+
+    // flattens a uniform cubic b-spline with count control points, open splines have count - 3 segments.
+    // looped splines wrap the control points and do not repeat the first point at the end, so out is a closed polygon.
+    template <size_t N, class T>
+    inline void flatten_bspline(const Vec<N, T>* points, size_t count, T tolerance, std::vector<Vec<N, T>>& out,
+                                bool loop = false)
+    {
+        if (count < 4 && !(loop && count >= 3))
+            return;
+
+        size_t first = out.size();
+        size_t segments = loop ? count : count - 3;
+        for (size_t i = 0; i < segments; ++i)
+        {
+            Vec<N, T> b0, b1, b2, b3;
+            bspline_to_bezier(points[i % count], points[(i + 1) % count], points[(i + 2) % count],
+                              points[(i + 3) % count], b0, b1, b2, b3);
+            flatten_cubic_bezier(b0, b1, b2, b3, tolerance, out);
+        }
+
+        if (loop && out.size() > first + 1)
+            out.pop_back();
+    }
+
+    // evaluates count cubic beziers at the same t, control_points holds 4 consecutive points per curve
+    template <size_t N, class T>
+    inline void cubic_bezier(const Vec<N, T>* control_points, size_t count, f32 t, Vec<N, T>* out)
+    {
+        // bernstein weights are shared by every curve
+        f32 it = 1.0f - t;
+        T   w0 = (T)(it * it * it);
+        T   w1 = (T)(3.0f * it * it * t);
+        T   w2 = (T)(3.0f * it * t * t);
+        T   w3 = (T)(t * t * t);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vec<N, T>* p = control_points + i * 4;
+            for (size_t j = 0; j < N; ++j)
+                out[i][j] = w0 * p[0][j] + w1 * p[1][j] + w2 * p[2][j] + w3 * p[3][j];
+        }
+    }
+
+    // flattens count cubic beziers (4 control points each) for tessellating many curves at once. segment counts for
+    // every curve are computed up front with wang's formula, then curve i writes offsets[i + 1] - offsets[i] points
+    // starting at points[offsets[i]] including both end points. offsets has count + 1 entries.
+    template <size_t N, class T>
+    inline void flatten_cubic_beziers(const Vec<N, T>* control_points, size_t count, T tolerance,
+                                      std::vector<Vec<N, T>>& points, std::vector<u32>& offsets)
+    {
+        offsets.resize(count + 1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vec<N, T>* p = control_points + i * 4;
+            offsets[i + 1] = offsets[i] + cubic_bezier_segments(p[0], p[1], p[2], p[3], tolerance) + 1;
+        }
+
+        points.resize(offsets[count]);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vec<N, T>* p = control_points + i * 4;
+            Vec<N, T>*       o = points.data() + offsets[i];
+            u32              n = offsets[i + 1] - offsets[i] - 1;
+            T                step = T(1) / (T)n;
+            for (u32 j = 0; j <= n; ++j)
+                o[j] = cubic_bezier((f32)(step * (T)j), p[0], p[1], p[2], p[3]);
+        }
+    }
+
+    // a 1d function f(x) sampled at size evenly spaced points over x_min-x_max. lookups outside the range clamp to
+    // the end values. guard entries beyond each end mean cubic lookups never have to clamp their neighbours.
+    class curve_table
+    {
+    public:
+        typedef std::function<f32(f32)> curve_func;
+
+        // bakes func, evaluated once per entry, size must be at least 2. an empty range (x_min == x_max) bakes the
+        // single value func(x_min), which every lookup returns
+        void bake(const curve_func& func, u32 size = k_curve_table_default_size, f32 x_min = 0.0f, f32 x_max = 1.0f)
+        {
+            _size = max<u32>(size, 2);
+            _x_min = x_min;
+            _x_scale = x_max != x_min ? (f32)(_size - 1) / (x_max - x_min) : 0.0f;
+            _data.resize(_size + 3);
+
+            f32 step = (x_max - x_min) / (f32)(_size - 1);
+            for (u32 i = 0; i < _size; ++i)
+                _data[i + 1] = func(x_min + step * (f32)i);
+
+            // the guard entries continue the quadratic through the 3 end values, so cubic lookups near the ends stay
+            // accurate, clamping to the end value would flatten the slope there
+            f32* d = _data.data();
+            u32  n = _size;
+            if (n >= 3)
+            {
+                d[0] = 3.0f * d[1] - 3.0f * d[2] + d[3];
+                d[n + 1] = 3.0f * d[n] - 3.0f * d[n - 1] + d[n - 2];
+            }
+            else
+            {
+                d[0] = 2.0f * d[1] - d[2];
+                d[n + 1] = 2.0f * d[n] - d[n - 1];
+            }
+            d[n + 2] = d[n + 1];
+        }
+
+        // bakes a chain of functions applied in order, ie. chain[1](chain[0](x))
+        void bake(const std::vector<curve_func>& chain, u32 size = k_curve_table_default_size, f32 x_min = 0.0f,
+                  f32 x_max = 1.0f)
+        {
+            bake(
+                [&chain](f32 x) {
+                    for (auto& f : chain)
+                        x = f(x);
+                    return x;
+                },
+                size, x_min, x_max);
+        }
+
+        u32 size() const
+        {
+            return _size;
+        }
+
+        // the baked values, size entries
+        const f32* data() const
+        {
+            return _data.data() + 1;
+        }
+
+        f32 evaluate(f32 x, e_curve_interpolation interpolation = e_curve_interpolation::linear) const
+        {
+            f32 frac;
+            const f32* e = locate(x, frac);
+            if (interpolation == e_curve_interpolation::cubic)
+                return cubic_interp(e[-1], e[0], e[1], e[2], frac);
+            return e[0] + (e[1] - e[0]) * frac;
+        }
+
+        f32 operator()(f32 x) const
+        {
+            return evaluate(x);
+        }
+
+        // evaluates count values, out may be the same array as x
+        void evaluate(const f32* x, size_t count, f32* out,
+                      e_curve_interpolation interpolation = e_curve_interpolation::linear) const
+        {
+            if (interpolation == e_curve_interpolation::cubic)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    f32 frac;
+                    const f32* e = locate(x[i], frac);
+                    out[i] = cubic_interp(e[-1], e[0], e[1], e[2], frac);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    f32 frac;
+                    const f32* e = locate(x[i], frac);
+                    out[i] = e[0] + (e[1] - e[0]) * frac;
+                }
+            }
+        }
+
+    private:
+        // entry at or below x and the fraction towards the next one
+        const f32* locate(f32 x, f32& frac) const
+        {
+            f32 max_f = (f32)(_size - 1);
+            f32 f = (x - _x_min) * _x_scale;
+            f = f > 0.0f ? f : 0.0f; // also catches nan, ie. infinite x with an empty range
+            f = f > max_f ? max_f : f;
+
+            // f = size - 1 gives the last value with zero weight on the guard entries past the end
+            u32 i = (u32)f;
+            frac = f - (f32)i;
+            return _data.data() + 1 + i;
+        }
+
+        u32              _size = 0;
+        f32              _x_min = 0.0f;
+        f32              _x_scale = 1.0f;
+        std::vector<f32> _data;
+    };
+} // namespace maths
@@ -0,0 +1,771 @@
+// isosurface.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+#include "parallel.h"
+#include "voxel.h"
+
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <vector>
+
+// surface extraction from dense or sparse (voxel.h) grids of values, where values below iso are inside the surface.
+// marching cubes places vertices on the cube edges the surface crosses and connects them with a 256 case table, each
+// edge vertex is shared by every cube that touches the edge. dual contouring places one vertex inside each crossed cube
+// at the point which best fits the planes through its edge crossings (the qef), then joins the 4 cubes around each
+// crossed edge with a quad, which keeps sharp edges and corners. normals are central differences of the grid values so
+// corners come out slightly rounded, but far closer than marching cubes which cuts them off at every cube.
+// both work on 8x8x8 blocks of cubes in parallel, each block writes its own vertices which are merged afterwards.
+// output triangles wind counter clockwise seen from outside, normals point outward (along the value gradient).
+
+namespace maths
+{
+    constexpr f32 k_dual_contouring_regularisation = 0.05f; // pull toward the mass point, keeps flat regions stable
+
+    struct iso_mesh
+    {
+        std::vector<vec3f> positions;
+        std::vector<vec3f> normals;
+        std::vector<u32>   indices;
+    };
+
+    // bitmask of the cube edges crossed for each case, bit i of the case is set when corner i is inside
+    inline u32 marching_cubes_edge_mask(u32 cube)
+    {
+        static const uint16_t k_edge_mask[256] = {
+                0x000, 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
+                0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
+                0x190, 0x099, 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
+                0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
+                0x230, 0x339, 0x033, 0x13a, 0x636, 0x73f, 0x435, 0x53c,
+                0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
+                0x3a0, 0x2a9, 0x1a3, 0x0aa, 0x7a6, 0x6af, 0x5a5, 0x4ac,
+                0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
+                0x460, 0x569, 0x663, 0x76a, 0x066, 0x16f, 0x265, 0x36c,
+                0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
+                0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0x0ff, 0x3f5, 0x2fc,
+                0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
+                0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x055, 0x15c,
+                0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
+                0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0x0cc,
+                0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
+                0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
+                0x0cc, 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
+                0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
+                0x15c, 0x055, 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
+                0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
+                0x2fc, 0x3f5, 0x0ff, 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
+                0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
+                0x36c, 0x265, 0x16f, 0x066, 0x76a, 0x663, 0x569, 0x460,
+                0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
+                0x4ac, 0x5a5, 0x6af, 0x7a6, 0x0aa, 0x1a3, 0x2a9, 0x3a0,
+                0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
+                0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x033, 0x339, 0x230,
+                0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
+                0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x099, 0x190,
+                0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
+                0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x000
+        };
+        return k_edge_mask[cube];
+    }
+
+    // up to 5 triangles of edge indices for each case, terminated with -1. faces with two diagonal inside corners
+    // keep the inside corners separate so neighbouring cubes always agree.
+    // corners: 0 (0,0,0), 1 (1,0,0), 2 (1,1,0), 3 (0,1,0), 4 (0,0,1), 5 (1,0,1), 6 (1,1,1), 7 (0,1,1)
+    // edges: 0 0-1, 1 1-2, 2 2-3, 3 3-0, 4 4-5, 5 5-6, 6 6-7, 7 7-4, 8 0-4, 9 1-5, 10 2-6, 11 3-7
+    inline const int8_t* marching_cubes_triangles(u32 cube)
+    {
+        static const int8_t k_triangles[256][16] = {
+                {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 9, 2, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+                {2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 8, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 11, 1, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 11, 0, 11, 8, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 11, 0, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+                {8, 9, 10, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 7, 1, 7, 4, 1, 4, 9, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 4, 1, 10, 2, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 2, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 7, 2, 7, 4, 2, 4, 9, 2, 9, 10, -1, -1, -1, -1},
+                {2, 11, 3, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 7, 0, 7, 4, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 11, 3, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 7, 1, 7, 4, 1, 4, 9, -1, -1, -1, -1},
+                {1, 10, 11, 1, 11, 3, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 11, 0, 11, 7, 0, 7, 4, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 11, 0, 11, 3, 4, 8, 7, -1, -1, -1, -1},
+                {4, 9, 10, 4, 10, 11, 4, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+                {4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 4, 1, 4, 5, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 10, 2, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 10, 0, 10, 2, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 4, 2, 4, 5, 2, 5, 10, -1, -1, -1, -1},
+                {2, 11, 3, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 8, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 1, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 8, 1, 8, 4, 1, 4, 5, -1, -1, -1, -1},
+                {1, 10, 11, 1, 11, 3, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 11, 0, 11, 8, 4, 5, 9, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 10, 0, 10, 11, 0, 11, 3, -1, -1, -1, -1},
+                {4, 5, 10, 4, 10, 11, 4, 11, 8, -1, -1, -1, -1, -1, -1, -1},
+                {5, 9, 8, 5, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 5, 0, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 7, 0, 7, 5, 0, 5, 1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, 5, 9, 8, 5, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 5, 0, 5, 9, 1, 10, 2, -1, -1, -1, -1},
+                {0, 8, 7, 0, 7, 5, 0, 5, 10, 0, 10, 2, -1, -1, -1, -1},
+                {2, 3, 7, 2, 7, 5, 2, 5, 10, -1, -1, -1, -1, -1, -1, -1},
+                {2, 11, 3, 5, 9, 8, 5, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 7, 0, 7, 5, 0, 5, 9, -1, -1, -1, -1},
+                {0, 8, 7, 0, 7, 5, 0, 5, 1, 2, 11, 3, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 11, 1, 11, 3, 5, 9, 8, 5, 8, 7, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 11, 0, 11, 7, 0, 7, 5, 0, 5, 9, -1},
+                {0, 8, 7, 0, 7, 5, 0, 5, 10, 0, 10, 11, 0, 11, 3, -1},
+                {5, 10, 11, 5, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 9, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {1, 5, 6, 1, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 5, 6, 1, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 6, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 9, 2, 9, 5, 2, 5, 6, -1, -1, -1, -1},
+                {2, 11, 3, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 11, 3, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 8, 1, 8, 9, 5, 6, 10, -1, -1, -1, -1},
+                {1, 5, 6, 1, 6, 11, 1, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 5, 0, 5, 6, 0, 6, 11, 0, 11, 8, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 6, 0, 6, 11, 0, 11, 3, -1, -1, -1, -1},
+                {5, 6, 11, 5, 11, 8, 5, 8, 9, -1, -1, -1, -1, -1, -1, -1},
+                {4, 8, 7, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 4, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 4, 8, 7, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 7, 1, 7, 4, 1, 4, 9, 5, 6, 10, -1, -1, -1, -1},
+                {1, 5, 6, 1, 6, 2, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 6, 0, 6, 2, 4, 8, 7, -1, -1, -1, -1},
+                {2, 3, 7, 2, 7, 4, 2, 4, 9, 2, 9, 5, 2, 5, 6, -1},
+                {2, 11, 3, 4, 8, 7, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 7, 0, 7, 4, 5, 6, 10, -1, -1, -1, -1},
+                {0, 9, 1, 2, 11, 3, 4, 8, 7, 5, 6, 10, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 7, 1, 7, 4, 1, 4, 9, 5, 6, 10, -1},
+                {1, 5, 6, 1, 6, 11, 1, 11, 3, 4, 8, 7, -1, -1, -1, -1},
+                {0, 1, 5, 0, 5, 6, 0, 6, 11, 0, 11, 7, 0, 7, 4, -1},
+                {0, 9, 5, 0, 5, 6, 0, 6, 11, 0, 11, 3, 4, 8, 7, -1},
+                {4, 9, 5, 4, 5, 6, 4, 6, 11, 4, 11, 7, -1, -1, -1, -1},
+                {4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 4, 6, 0, 6, 10, 0, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 4, 1, 4, 6, 1, 6, 10, -1, -1, -1, -1},
+                {1, 9, 4, 1, 4, 6, 1, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 9, 4, 1, 4, 6, 1, 6, 2, -1, -1, -1, -1},
+                {0, 4, 6, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 4, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+                {2, 11, 3, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 8, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1},
+                {0, 4, 6, 0, 6, 10, 0, 10, 1, 2, 11, 3, -1, -1, -1, -1},
+                {1, 2, 11, 1, 11, 8, 1, 8, 4, 1, 4, 6, 1, 6, 10, -1},
+                {1, 9, 4, 1, 4, 6, 1, 6, 11, 1, 11, 3, -1, -1, -1, -1},
+                {0, 1, 9, 0, 9, 4, 0, 4, 6, 0, 6, 11, 0, 11, 8, -1},
+                {0, 4, 6, 0, 6, 11, 0, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+                {4, 6, 11, 4, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {6, 10, 9, 6, 9, 8, 6, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 6, 0, 6, 10, 0, 10, 9, -1, -1, -1, -1},
+                {0, 8, 7, 0, 7, 6, 0, 6, 10, 0, 10, 1, -1, -1, -1, -1},
+                {1, 3, 7, 1, 7, 6, 1, 6, 10, -1, -1, -1, -1, -1, -1, -1},
+                {1, 9, 8, 1, 8, 7, 1, 7, 6, 1, 6, 2, -1, -1, -1, -1},
+                {0, 3, 7, 0, 7, 6, 0, 6, 2, 0, 2, 1, 0, 1, 9, -1},
+                {0, 8, 7, 0, 7, 6, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 7, 2, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 11, 3, 6, 10, 9, 6, 9, 8, 6, 8, 7, -1, -1, -1, -1},
+                {0, 2, 11, 0, 11, 7, 0, 7, 6, 0, 6, 10, 0, 10, 9, -1},
+                {0, 8, 7, 0, 7, 6, 0, 6, 10, 0, 10, 1, 2, 11, 3, -1},
+                {1, 2, 11, 1, 11, 7, 1, 7, 6, 1, 6, 10, -1, -1, -1, -1},
+                {1, 9, 8, 1, 8, 7, 1, 7, 6, 1, 6, 11, 1, 11, 3, -1},
+                {0, 1, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 7, 0, 7, 6, 0, 6, 11, 0, 11, 3, -1, -1, -1, -1},
+                {6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 10, 2, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 2, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 9, 2, 9, 10, 6, 7, 11, -1, -1, -1, -1},
+                {2, 6, 7, 2, 7, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 6, 0, 6, 7, 0, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 6, 7, 2, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+                {1, 2, 6, 1, 6, 7, 1, 7, 8, 1, 8, 9, -1, -1, -1, -1},
+                {1, 10, 6, 1, 6, 7, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 6, 0, 6, 7, 0, 7, 8, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 6, 0, 6, 7, 0, 7, 3, -1, -1, -1, -1},
+                {6, 7, 8, 6, 8, 9, 6, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+                {4, 8, 11, 4, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 4, 8, 11, 4, 11, 6, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 11, 1, 11, 6, 1, 6, 4, 1, 4, 9, -1, -1, -1, -1},
+                {1, 10, 2, 4, 8, 11, 4, 11, 6, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 6, 0, 6, 4, 1, 10, 2, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 2, 4, 8, 11, 4, 11, 6, -1, -1, -1, -1},
+                {2, 3, 11, 2, 11, 6, 2, 6, 4, 2, 4, 9, 2, 9, 10, -1},
+                {2, 6, 4, 2, 4, 8, 2, 8, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 6, 4, 2, 4, 8, 2, 8, 3, -1, -1, -1, -1},
+                {1, 2, 6, 1, 6, 4, 1, 4, 9, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 6, 1, 6, 4, 1, 4, 8, 1, 8, 3, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 10, 0, 10, 6, 0, 6, 4, 0, 4, 8, 0, 8, 3, -1},
+                {4, 9, 10, 4, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 1, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 4, 1, 4, 5, 6, 7, 11, -1, -1, -1, -1},
+                {1, 10, 2, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 10, 2, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 10, 0, 10, 2, 6, 7, 11, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 4, 2, 4, 5, 2, 5, 10, 6, 7, 11, -1},
+                {2, 6, 7, 2, 7, 3, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 6, 0, 6, 7, 0, 7, 8, 4, 5, 9, -1, -1, -1, -1},
+                {0, 4, 5, 0, 5, 1, 2, 6, 7, 2, 7, 3, -1, -1, -1, -1},
+                {1, 2, 6, 1, 6, 7, 1, 7, 8, 1, 8, 4, 1, 4, 5, -1},
+                {1, 10, 6, 1, 6, 7, 1, 7, 3, 4, 5, 9, -1, -1, -1, -1},
+                {0, 1, 10, 0, 10, 6, 0, 6, 7, 0, 7, 8, 4, 5, 9, -1},
+                {0, 4, 5, 0, 5, 10, 0, 10, 6, 0, 6, 7, 0, 7, 3, -1},
+                {4, 5, 10, 4, 10, 6, 4, 6, 7, 4, 7, 8, -1, -1, -1, -1},
+                {5, 9, 8, 5, 8, 11, 5, 11, 6, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
+                {0, 8, 11, 0, 11, 6, 0, 6, 5, 0, 5, 1, -1, -1, -1, -1},
+                {1, 3, 11, 1, 11, 6, 1, 6, 5, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 2, 5, 9, 8, 5, 8, 11, 5, 11, 6, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 6, 0, 6, 5, 0, 5, 9, 1, 10, 2, -1},
+                {0, 8, 11, 0, 11, 6, 0, 6, 5, 0, 5, 10, 0, 10, 2, -1},
+                {2, 3, 11, 2, 11, 6, 2, 6, 5, 2, 5, 10, -1, -1, -1, -1},
+                {2, 6, 5, 2, 5, 9, 2, 9, 8, 2, 8, 3, -1, -1, -1, -1},
+                {0, 2, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 3, 0, 3, 2, 0, 2, 6, 0, 6, 5, 0, 5, 1, -1},
+                {1, 2, 6, 1, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 10, 6, 1, 6, 5, 1, 5, 9, 1, 9, 8, 1, 8, 3, -1},
+                {0, 1, 10, 0, 10, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
+                {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 9, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1},
+                {1, 5, 7, 1, 7, 11, 1, 11, 2, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 1, 5, 7, 1, 7, 11, 1, 11, 2, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 7, 0, 7, 11, 0, 11, 2, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 9, 2, 9, 5, 2, 5, 7, 2, 7, 11, -1},
+                {2, 10, 5, 2, 5, 7, 2, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 10, 0, 10, 5, 0, 5, 7, 0, 7, 8, -1, -1, -1, -1},
+                {0, 9, 1, 2, 10, 5, 2, 5, 7, 2, 7, 3, -1, -1, -1, -1},
+                {1, 2, 10, 1, 10, 5, 1, 5, 7, 1, 7, 8, 1, 8, 9, -1},
+                {1, 5, 7, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 5, 0, 5, 7, 0, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 7, 0, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+                {5, 7, 8, 5, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {4, 8, 11, 4, 11, 10, 4, 10, 5, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 10, 0, 10, 5, 0, 5, 4, -1, -1, -1, -1},
+                {0, 9, 1, 4, 8, 11, 4, 11, 10, 4, 10, 5, -1, -1, -1, -1},
+                {1, 3, 11, 1, 11, 10, 1, 10, 5, 1, 5, 4, 1, 4, 9, -1},
+                {1, 5, 4, 1, 4, 8, 1, 8, 11, 1, 11, 2, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 2, 0, 2, 1, 0, 1, 5, 0, 5, 4, -1},
+                {0, 9, 5, 0, 5, 4, 0, 4, 8, 0, 8, 11, 0, 11, 2, -1},
+                {2, 3, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 10, 5, 2, 5, 4, 2, 4, 8, 2, 8, 3, -1, -1, -1, -1},
+                {0, 2, 10, 0, 10, 5, 0, 5, 4, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 1, 2, 10, 5, 2, 5, 4, 2, 4, 8, 2, 8, 3, -1},
+                {1, 2, 10, 1, 10, 5, 1, 5, 4, 1, 4, 9, -1, -1, -1, -1},
+                {1, 5, 4, 1, 4, 8, 1, 8, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 5, 0, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 9, 5, 0, 5, 4, 0, 4, 8, 0, 8, 3, -1, -1, -1, -1},
+                {4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {4, 7, 11, 4, 11, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 8, 4, 7, 11, 4, 11, 10, 4, 10, 9, -1, -1, -1, -1},
+                {0, 4, 7, 0, 7, 11, 0, 11, 10, 0, 10, 1, -1, -1, -1, -1},
+                {1, 3, 8, 1, 8, 4, 1, 4, 7, 1, 7, 11, 1, 11, 10, -1},
+                {1, 9, 4, 1, 4, 7, 1, 7, 11, 1, 11, 2, -1, -1, -1, -1},
+                {0, 3, 8, 1, 9, 4, 1, 4, 7, 1, 7, 11, 1, 11, 2, -1},
+                {0, 4, 7, 0, 7, 11, 0, 11, 2, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 8, 2, 8, 4, 2, 4, 7, 2, 7, 11, -1, -1, -1, -1},
+                {2, 10, 9, 2, 9, 4, 2, 4, 7, 2, 7, 3, -1, -1, -1, -1},
+                {0, 2, 10, 0, 10, 9, 0, 9, 4, 0, 4, 7, 0, 7, 8, -1},
+                {0, 4, 7, 0, 7, 3, 0, 3, 2, 0, 2, 10, 0, 10, 1, -1},
+                {1, 2, 10, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 9, 4, 1, 4, 7, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 9, 0, 9, 4, 0, 4, 7, 0, 7, 8, -1, -1, -1, -1},
+                {0, 4, 7, 0, 7, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {8, 11, 10, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 10, 0, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 11, 0, 11, 10, 0, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 3, 11, 1, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 9, 8, 1, 8, 11, 1, 11, 2, -1, -1, -1, -1, -1, -1, -1},
+                {0, 3, 11, 0, 11, 2, 0, 2, 1, 0, 1, 9, -1, -1, -1, -1},
+                {0, 8, 11, 0, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {2, 10, 9, 2, 9, 8, 2, 8, 3, -1, -1, -1, -1, -1, -1, -1},
+                {0, 2, 10, 0, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 3, 0, 3, 2, 0, 2, 10, 0, 10, 1, -1, -1, -1, -1},
+                {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {1, 9, 8, 1, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+        };
+        return k_triangles[cube];
+    }
+
+    // values of a block of cubes and the lattice around it, with central difference gradients
+    class iso_block_samples
+    {
+    public:
+        static constexpr int k_border = 1;
+        static constexpr int k_size = k_voxel_block_size + 1 + k_border * 2;
+
+        template <class Sampler>
+        void sample(Sampler sampler, const vec3i& block)
+        {
+            _base = block * k_voxel_block_size - vec3i(k_border);
+            for (int z = 0; z < k_size; ++z)
+                for (int y = 0; y < k_size; ++y)
+                    for (int x = 0; x < k_size; ++x)
+                        _values[(z * k_size + y) * k_size + x] = sampler(_base + vec3i(x, y, z));
+        }
+
+        // voxel must be within the block or its one voxel border
+        f32 value(const vec3i& voxel) const
+        {
+            vec3i l = voxel - _base;
+            return _values[(l.z * k_size + l.y) * k_size + l.x];
+        }
+
+        vec3f gradient(const vec3i& voxel) const
+        {
+            vec3i l = voxel - _base;
+            vec3f g;
+            for (u32 i = 0; i < 3; ++i)
+            {
+                vec3i lo = l, hi = l;
+                lo[i] = max(lo[i] - 1, 0);
+                hi[i] = min(hi[i] + 1, k_size - 1);
+                f32 a = _values[(lo.z * k_size + lo.y) * k_size + lo.x];
+                f32 b = _values[(hi.z * k_size + hi.y) * k_size + hi.x];
+                g[i] = (b - a) / (f32)(hi[i] - lo[i]);
+            }
+            return g;
+        }
+
+    private:
+        vec3i _base;
+        f32   _values[k_size * k_size * k_size];
+    };
+
+    // vertices and triangles of one block, indices are local to the block until merged
+    struct iso_block_mesh
+    {
+        std::vector<vec4i> keys;
+        std::vector<vec3f> positions;
+        std::vector<vec3f> normals;
+        std::vector<u32>   indices;
+    };
+
+    // cube corners and the corners of each edge, in the order used by the marching cubes tables
+    inline const vec3i& iso_cube_corner(u32 corner)
+    {
+        static const vec3i k_corners[8] = {vec3i(0, 0, 0), vec3i(1, 0, 0), vec3i(1, 1, 0), vec3i(0, 1, 0),
+                                           vec3i(0, 0, 1), vec3i(1, 0, 1), vec3i(1, 1, 1), vec3i(0, 1, 1)};
+        return k_corners[corner];
+    }
+
+    inline const u32* iso_cube_edge(u32 edge)
+    {
+        static const u32 k_edges[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6},
+                                           {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+        return k_edges[edge];
+    }
+
+    // sorted, unique blocks of cubes to polygonise: each block plus its neighbours at offsets of -1 and 0 per axis,
+    // since cubes at the low edge of an unallocated block can reach into an allocated one
+    inline void iso_expand_blocks(const std::vector<vec3i>& blocks, std::vector<vec3i>& blocks_out)
+    {
+        blocks_out.clear();
+        for (auto& b : blocks)
+            for (u32 i = 0; i < 8; ++i)
+                blocks_out.push_back(b - iso_cube_corner(i));
+
+        std::sort(blocks_out.begin(), blocks_out.end(), [](const vec3i& a, const vec3i& b) {
+            if (a.z != b.z)
+                return a.z < b.z;
+            if (a.y != b.y)
+                return a.y < b.y;
+            return a.x < b.x;
+        });
+        blocks_out.erase(std::unique(blocks_out.begin(), blocks_out.end(),
+                                     [](const vec3i& a, const vec3i& b) { return a == b; }),
+                         blocks_out.end());
+    }
+
+    // appends the block meshes to out, sharing vertices with equal keys
+    inline void iso_merge(const std::vector<iso_block_mesh>& block_meshes, iso_mesh& out)
+    {
+        std::unordered_map<vec4i, u32, vec_hash> lookup;
+        std::vector<u32>                         remap;
+        for (auto& bm : block_meshes)
+        {
+            remap.resize(bm.keys.size());
+            for (size_t i = 0; i < bm.keys.size(); ++i)
+            {
+                auto r = lookup.insert(std::make_pair(bm.keys[i], (u32)out.positions.size()));
+                if (r.second)
+                {
+                    out.positions.push_back(bm.positions[i]);
+                    out.normals.push_back(bm.normals[i]);
+                }
+                remap[i] = r.first->second;
+            }
+
+            for (u32 i : bm.indices)
+                out.indices.push_back(remap[i]);
+        }
+    }
+
+    // sampler(voxel) returns the value at an integer voxel, only cubes with their min corner inside
+    // cube_min-cube_max are polygonised. vertices are output at origin + voxel * voxel_size.
+    template <class Sampler>
+    inline void marching_cubes(executor& exec, Sampler sampler, const std::vector<vec3i>& blocks, const vec3i& cube_min,
+                               const vec3i& cube_max, const vec3f& origin, f32 voxel_size, f32 iso, iso_mesh& out)
+    {
+        std::vector<iso_block_mesh> block_meshes(blocks.size());
+        parallel_for(exec, blocks.size(), 1, [&](size_t begin, size_t end) {
+            iso_block_samples                         samples;
+            std::unordered_map<vec4i, u32, vec_hash> edge_vertex;
+            for (size_t b = begin; b < end; ++b)
+            {
+                iso_block_mesh& bm = block_meshes[b];
+                samples.sample(sampler, blocks[b]);
+                edge_vertex.clear();
+
+                vec3i base = blocks[b] * k_voxel_block_size;
+                for (int z = 0; z < k_voxel_block_size; ++z)
+                {
+                    for (int y = 0; y < k_voxel_block_size; ++y)
+                    {
+                        for (int x = 0; x < k_voxel_block_size; ++x)
+                        {
+                            vec3i v = base + vec3i(x, y, z);
+                            if (v.x < cube_min.x || v.y < cube_min.y || v.z < cube_min.z || v.x > cube_max.x ||
+                                v.y > cube_max.y || v.z > cube_max.z)
+                                continue;
+
+                            f32 c[8];
+                            u32 cube = 0;
+                            for (u32 i = 0; i < 8; ++i)
+                            {
+                                c[i] = samples.value(v + iso_cube_corner(i));
+                                cube |= c[i] < iso ? 1 << i : 0;
+                            }
+
+                            u32 mask = marching_cubes_edge_mask(cube);
+                            if (mask == 0)
+                                continue;
+
+                            // shared vertex for each crossed edge, keyed by the edge min corner and axis
+                            u32 vertex[12];
+                            for (u32 e = 0; e < 12; ++e)
+                            {
+                                if (!(mask & (1 << e)))
+                                    continue;
+
+                                const u32* ec = iso_cube_edge(e);
+                                vec3i      a = v + iso_cube_corner(ec[0]);
+                                vec3i      b1 = v + iso_cube_corner(ec[1]);
+                                vec3i      lo = min_union(a, b1);
+                                u32        axis = a.x != b1.x ? 0 : (a.y != b1.y ? 1 : 2);
+                                vec4i      key = vec4i(lo.x, lo.y, lo.z, (int)axis);
+
+                                auto r = edge_vertex.insert(std::make_pair(key, (u32)bm.keys.size()));
+                                vertex[e] = r.first->second;
+                                if (!r.second)
+                                    continue;
+
+                                f32   va = c[ec[0]], vb = c[ec[1]];
+                                f32   t = (iso - va) / (vb - va);
+                                vec3f pa = vec3f((f32)a.x, (f32)a.y, (f32)a.z);
+                                vec3f pb = vec3f((f32)b1.x, (f32)b1.y, (f32)b1.z);
+                                vec3f n = lerp(samples.gradient(a), samples.gradient(b1), t);
+                                f32   nl = mag(n);
+
+                                bm.keys.push_back(key);
+                                bm.positions.push_back(origin + lerp(pa, pb, t) * voxel_size);
+                                bm.normals.push_back(nl > 0.0f ? n / nl : vec3f(0.0f));
+                            }
+
+                            const int8_t* tris = marching_cubes_triangles(cube);
+                            for (u32 i = 0; tris[i] != -1; ++i)
+                                bm.indices.push_back(vertex[tris[i]]);
+                        }
+                    }
+                }
+            }
+        });
+
+        iso_merge(block_meshes, out);
+    }
+
+    // sampler(voxel) returns the value at an integer voxel, only cubes with their min corner inside
+    // cube_min-cube_max get a vertex. vertices are output at origin + voxel * voxel_size.
+    template <class Sampler>
+    inline void dual_contouring(executor& exec, Sampler sampler, const std::vector<vec3i>& blocks,
+                                const vec3i& cube_min, const vec3i& cube_max, const vec3f& origin, f32 voxel_size,
+                                f32 iso, iso_mesh& out)
+    {
+        // quads for the edges of blocks need the vertices of cubes in the blocks at -1
+        std::vector<vec3i> vertex_blocks;
+        iso_expand_blocks(blocks, vertex_blocks);
+
+        // one vertex per crossed cube, placed by minimising the qef of the edge crossing planes
+        std::vector<iso_block_mesh> block_meshes(vertex_blocks.size());
+        parallel_for(exec, vertex_blocks.size(), 1, [&](size_t begin, size_t end) {
+            iso_block_samples samples;
+            for (size_t b = begin; b < end; ++b)
+            {
+                iso_block_mesh& bm = block_meshes[b];
+                samples.sample(sampler, vertex_blocks[b]);
+
+                vec3i base = vertex_blocks[b] * k_voxel_block_size;
+                for (int z = 0; z < k_voxel_block_size; ++z)
+                {
+                    for (int y = 0; y < k_voxel_block_size; ++y)
+                    {
+                        for (int x = 0; x < k_voxel_block_size; ++x)
+                        {
+                            vec3i v = base + vec3i(x, y, z);
+                            if (v.x < cube_min.x || v.y < cube_min.y || v.z < cube_min.z || v.x > cube_max.x ||
+                                v.y > cube_max.y || v.z > cube_max.z)
+                                continue;
+
+                            f32 c[8];
+                            u32 cube = 0;
+                            for (u32 i = 0; i < 8; ++i)
+                            {
+                                c[i] = samples.value(v + iso_cube_corner(i));
+                                cube |= c[i] < iso ? 1 << i : 0;
+                            }
+
+                            u32 mask = marching_cubes_edge_mask(cube);
+                            if (mask == 0)
+                                continue;
+
+                            // crossing points and normals, in voxel units relative to the cube min corner
+                            vec3f p[12], n[12];
+                            u32   count = 0;
+                            vec3f mass = vec3f(0.0f);
+                            vec3f normal = vec3f(0.0f);
+                            for (u32 e = 0; e < 12; ++e)
+                            {
+                                if (!(mask & (1 << e)))
+                                    continue;
+
+                                const u32* ec = iso_cube_edge(e);
+                                vec3i      ca = iso_cube_corner(ec[0]);
+                                vec3i      cb = iso_cube_corner(ec[1]);
+                                vec3f      pa = vec3f((f32)ca.x, (f32)ca.y, (f32)ca.z);
+                                vec3f      pb = vec3f((f32)cb.x, (f32)cb.y, (f32)cb.z);
+                                f32        t = (iso - c[ec[0]]) / (c[ec[1]] - c[ec[0]]);
+                                vec3f      g = lerp(samples.gradient(v + ca), samples.gradient(v + cb), t);
+                                f32        gl = mag(g);
+
+                                p[count] = lerp(pa, pb, t);
+                                n[count] = gl > 0.0f ? g / gl : vec3f(0.0f);
+                                mass += p[count];
+                                normal += n[count];
+                                ++count;
+                            }
+                            mass /= (f32)count;
+
+                            // minimise sum (n.(x - p))^2 + r |x - mass|^2
+                            mat3  ata;
+                            vec3f atb = vec3f(0.0f);
+                            for (u32 r = 0; r < 3; ++r)
+                                for (u32 k = 0; k < 3; ++k)
+                                    ata.at(r, k) = r == k ? k_dual_contouring_regularisation : 0.0f;
+
+                            for (u32 i = 0; i < count; ++i)
+                            {
+                                for (u32 r = 0; r < 3; ++r)
+                                    for (u32 k = 0; k < 3; ++k)
+                                        ata.at(r, k) += n[i][r] * n[i][k];
+                                atb += n[i] * dot(n[i], p[i] - mass);
+                            }
+
+                            vec3f vp = mass + mat::inverse3x3(ata) * atb;
+                            vp = min_union(max_union(vp, vec3f(0.0f)), vec3f(1.0f));
+
+                            f32 nl = mag(normal);
+                            bm.keys.push_back(vec4i(v.x, v.y, v.z, 0));
+                            bm.positions.push_back(origin + (vec3f((f32)v.x, (f32)v.y, (f32)v.z) + vp) * voxel_size);
+                            bm.normals.push_back(nl > 0.0f ? normal / nl : vec3f(0.0f));
+                        }
+                    }
+                }
+            }
+        });
+
+        iso_mesh vertices;
+        iso_merge(block_meshes, vertices);
+
+        std::unordered_map<vec4i, u32, vec_hash> cell_vertex;
+        size_t                                   cell = 0;
+        for (auto& bm : block_meshes)
+            for (auto& k : bm.keys)
+                cell_vertex[k] = (u32)cell++;
+
+        // a quad around each crossed lattice edge, joining the 4 cubes which share it
+        std::vector<std::vector<u32>> block_indices(blocks.size());
+        parallel_for(exec, blocks.size(), 1, [&](size_t begin, size_t end) {
+            iso_block_samples samples;
+            for (size_t b = begin; b < end; ++b)
+            {
+                samples.sample(sampler, blocks[b]);
+                vec3i base = blocks[b] * k_voxel_block_size;
+                for (int z = 0; z < k_voxel_block_size; ++z)
+                {
+                    for (int y = 0; y < k_voxel_block_size; ++y)
+                    {
+                        for (int x = 0; x < k_voxel_block_size; ++x)
+                        {
+                            vec3i v = base + vec3i(x, y, z);
+                            bool  v_inside = samples.value(v) < iso;
+                            for (u32 axis = 0; axis < 3; ++axis)
+                            {
+                                vec3i ea = vec3i(0), eb = vec3i(0), ec = vec3i(0);
+                                ea[axis] = 1;
+                                eb[(axis + 1) % 3] = 1;
+                                ec[(axis + 2) % 3] = 1;
+                                if (v_inside == (samples.value(v + ea) < iso))
+                                    continue;
+
+                                // cubes ccw around +axis
+                                vec3i cubes[4] = {v, v - eb, v - eb - ec, v - ec};
+                                u32   q[4];
+                                u32   found = 0;
+                                for (; found < 4; ++found)
+                                {
+                                    const vec3i& cv = cubes[found];
+                                    auto         it = cell_vertex.find(vec4i(cv.x, cv.y, cv.z, 0));
+                                    if (it == cell_vertex.end())
+                                        break;
+                                    q[found] = it->second;
+                                }
+                                if (found < 4)
+                                    continue;
+
+                                if (!v_inside)
+                                    std::swap(q[1], q[3]);
+
+                                u32 tri[6] = {q[0], q[1], q[2], q[0], q[2], q[3]};
+                                block_indices[b].insert(block_indices[b].end(), tri, tri + 6);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        u32 first = (u32)out.positions.size();
+        out.positions.insert(out.positions.end(), vertices.positions.begin(), vertices.positions.end());
+        out.normals.insert(out.normals.end(), vertices.normals.begin(), vertices.normals.end());
+        for (auto& bi : block_indices)
+            for (u32 i : bi)
+                out.indices.push_back(first + i);
+    }
+
+    // dense grid of dims values, x varies fastest
+    inline void marching_cubes(executor& exec, const f32* values, const vec3i& dims, const vec3f& origin,
+                               f32 voxel_size, f32 iso, iso_mesh& out)
+    {
+        std::vector<vec3i> blocks;
+        vec3i              last = voxel_block(dims - vec3i(2));
+        for (int z = 0; z <= last.z; ++z)
+            for (int y = 0; y <= last.y; ++y)
+                for (int x = 0; x <= last.x; ++x)
+                    blocks.push_back(vec3i(x, y, z));
+
+        marching_cubes(
+            exec,
+            [&](const vec3i& v) {
+                vec3i c = min_union(max_union(v, vec3i(0)), dims - vec3i(1));
+                return values[((size_t)c.z * dims.y + c.y) * dims.x + c.x];
+            },
+            blocks, vec3i(0), dims - vec3i(2), origin, voxel_size, iso, out);
+    }
+
+    inline void marching_cubes(executor& exec, const sparse_gridf& grid, f32 iso, iso_mesh& out)
+    {
+        std::vector<vec3i> allocated(grid.block_count()), blocks;
+        for (size_t i = 0; i < grid.block_count(); ++i)
+            allocated[i] = grid.block_coord(i);
+        iso_expand_blocks(allocated, blocks);
+
+        marching_cubes(
+            exec, [&](const vec3i& v) { return grid.get(v); }, blocks, vec3i(INT_MIN), vec3i(INT_MAX), grid.origin(),
+            grid.voxel_size(), iso, out);
+    }
+
+    // dense grid of dims values, x varies fastest
+    inline void dual_contouring(executor& exec, const f32* values, const vec3i& dims, const vec3f& origin,
+                                f32 voxel_size, f32 iso, iso_mesh& out)
+    {
+        std::vector<vec3i> blocks;
+        vec3i              last = voxel_block(dims - vec3i(2));
+        for (int z = 0; z <= last.z; ++z)
+            for (int y = 0; y <= last.y; ++y)
+                for (int x = 0; x <= last.x; ++x)
+                    blocks.push_back(vec3i(x, y, z));
+
+        dual_contouring(
+            exec,
+            [&](const vec3i& v) {
+                vec3i c = min_union(max_union(v, vec3i(0)), dims - vec3i(1));
+                return values[((size_t)c.z * dims.y + c.y) * dims.x + c.x];
+            },
+            blocks, vec3i(0), dims - vec3i(2), origin, voxel_size, iso, out);
+    }
+
+    inline void dual_contouring(executor& exec, const sparse_gridf& grid, f32 iso, iso_mesh& out)
+    {
+        std::vector<vec3i> allocated(grid.block_count()), blocks;
+        for (size_t i = 0; i < grid.block_count(); ++i)
+            allocated[i] = grid.block_coord(i);
+        iso_expand_blocks(allocated, blocks);
+
+        dual_contouring(
+            exec, [&](const vec3i& v) { return grid.get(v); }, blocks, vec3i(INT_MIN), vec3i(INT_MAX), grid.origin(),
+            grid.voxel_size(), iso, out);
+    }
+} // namespace maths
@@ -0,0 +1,294 @@
+// kdtree.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// static k-d tree over points of any dimension for nearest neighbour, radius and box queries.
+// the tree is built once with median splits on the axis of greatest extent. nodes live in a flat array in depth first
+// order (the left child follows its parent) and the points are copied in leaf order so leaves scan contiguous memory.
+// queries prune subtrees by comparing squared distances, indices returned refer to the points passed to build.
+
+namespace maths
+{
+    constexpr u32 k_kdtree_leaf_size = 8;
+    constexpr u32 k_kdtree_invalid = 0xffffffff;
+    constexpr u32 k_kdtree_max_depth = 64;
+
+    template <size_t N, class T>
+    class kdtree
+    {
+    public:
+        typedef Vec<N, T> vec_t;
+
+        void build(const vec_t* points, size_t count, u32 leaf_size = k_kdtree_leaf_size)
+        {
+            _leaf_size = max<u32>(leaf_size, 1);
+            _indices.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                _indices[i] = (u32)i;
+
+            _nodes.clear();
+            _nodes.reserve(count / _leaf_size * 2 + 1);
+            build_node(points, 0, (u32)count, 0);
+
+            _points.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                _points[i] = points[_indices[i]];
+        }
+
+        size_t size() const
+        {
+            return _points.size();
+        }
+
+        // index of the closest point to p, or k_kdtree_invalid if the tree is empty
+        u32 nearest(const vec_t& p, T* dist2_out = nullptr) const
+        {
+            u32 index = k_kdtree_invalid;
+            T   d2 = std::numeric_limits<T>::max();
+            knn(p, 1, &index, &d2);
+            if (dist2_out)
+                *dist2_out = d2;
+            return index;
+        }
+
+        // finds the k closest points to p sorted nearest first, returns how many were found (less than k when the
+        // tree has fewer points). dist2_out is optional and receives the squared distances.
+        size_t knn(const vec_t& p, size_t k, u32* indices_out, T* dist2_out = nullptr) const
+        {
+            if (k == 0 || _points.empty())
+                return 0;
+
+            // sorted insertion into small fixed size results
+            T              local_d2[k_kdtree_leaf_size * 4];
+            std::vector<T> heap_d2;
+            T*             best_d2 = local_d2;
+            if (k > sizeof(local_d2) / sizeof(local_d2[0]))
+            {
+                heap_d2.resize(k);
+                best_d2 = heap_d2.data();
+            }
+
+            size_t found = 0;
+            T      worst = std::numeric_limits<T>::max();
+            traverse(p, worst, [&](u32 begin, u32 end) {
+                for (u32 i = begin; i < end; ++i)
+                {
+                    T d2 = dist2(_points[i], p);
+                    if (found == k && d2 >= worst)
+                        continue;
+
+                    size_t j = found < k ? found++ : k - 1;
+                    while (j > 0 && best_d2[j - 1] > d2)
+                    {
+                        best_d2[j] = best_d2[j - 1];
+                        indices_out[j] = indices_out[j - 1];
+                        --j;
+                    }
+                    best_d2[j] = d2;
+                    indices_out[j] = i;
+
+                    if (found == k)
+                        worst = best_d2[k - 1];
+                }
+            });
+
+            for (size_t i = 0; i < found; ++i)
+            {
+                indices_out[i] = _indices[indices_out[i]];
+                if (dist2_out)
+                    dist2_out[i] = best_d2[i];
+            }
+
+            return found;
+        }
+
+        // appends the indices of all points within radius of p in tree order
+        void radius(const vec_t& p, T radius, std::vector<u32>& indices_out) const
+        {
+            if (_points.empty())
+                return;
+
+            T r2 = radius * radius;
+            traverse(p, r2, [&](u32 begin, u32 end) {
+                for (u32 i = begin; i < end; ++i)
+                    if (dist2(_points[i], p) <= r2)
+                        indices_out.push_back(_indices[i]);
+            });
+        }
+
+        // appends the indices of all points inside the box aabb_min-aabb_max in tree order
+        void aabb(const vec_t& aabb_min, const vec_t& aabb_max, std::vector<u32>& indices_out) const
+        {
+            if (_points.empty())
+                return;
+
+            u32 stack[k_kdtree_max_depth + 1];
+            u32 sp = 0;
+            stack[sp++] = 0;
+            while (sp > 0)
+            {
+                const node& n = _nodes[stack[--sp]];
+                if (n.right == 0)
+                {
+                    for (u32 i = n.begin; i < n.end; ++i)
+                        if (point_inside_aabb(aabb_min, aabb_max, _points[i]))
+                            indices_out.push_back(_indices[i]);
+                    continue;
+                }
+
+                u32 left = (u32)(&n - _nodes.data()) + 1;
+                if (aabb_max[n.axis] >= n.split)
+                    stack[sp++] = n.right;
+                if (aabb_min[n.axis] <= n.split)
+                    stack[sp++] = left;
+            }
+        }
+
+        // nearest neighbour for count query points
+        void nearest(const vec_t* p, size_t count, u32* indices_out, T* dist2_out = nullptr) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                indices_out[i] = nearest(p[i], dist2_out ? &dist2_out[i] : nullptr);
+        }
+
+        // k nearest neighbours for count query points, query i writes k results from indices_out + i * k.
+        // unused results are k_kdtree_invalid with a squared distance of the largest T.
+        void knn(const vec_t* p, size_t count, size_t k, u32* indices_out, T* dist2_out = nullptr) const
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                u32*   io = indices_out + i * k;
+                T*     d2o = dist2_out ? dist2_out + i * k : nullptr;
+                size_t found = knn(p[i], k, io, d2o);
+                for (size_t j = found; j < k; ++j)
+                {
+                    io[j] = k_kdtree_invalid;
+                    if (d2o)
+                        d2o[j] = std::numeric_limits<T>::max();
+                }
+            }
+        }
+
+        // radius query for count points, the results for query i are indices_out[offsets_out[i]] up to
+        // offsets_out[i + 1], offsets_out has count + 1 entries
+        void radius(const vec_t* p, size_t count, T radius, std::vector<u32>& indices_out,
+                    std::vector<u32>& offsets_out) const
+        {
+            indices_out.clear();
+            offsets_out.resize(count + 1);
+            offsets_out[0] = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                this->radius(p[i], radius, indices_out);
+                offsets_out[i + 1] = (u32)indices_out.size();
+            }
+        }
+
+    private:
+        struct node
+        {
+            T   split;
+            u32 axis;
+            u32 right; // 0 for leaves, the left child is always the next node
+            u32 begin;
+            u32 end;
+        };
+
+        u32 build_node(const vec_t* points, u32 begin, u32 end, u32 depth)
+        {
+            u32 index = (u32)_nodes.size();
+            _nodes.push_back(node());
+            _nodes[index].begin = begin;
+            _nodes[index].end = end;
+            _nodes[index].right = 0;
+            _nodes[index].axis = 0;
+            _nodes[index].split = T(0);
+
+            if (end - begin <= _leaf_size || depth + 1 >= k_kdtree_max_depth)
+                return index;
+
+            // split the axis of greatest extent at the median
+            vec_t bmin = points[_indices[begin]];
+            vec_t bmax = bmin;
+            for (u32 i = begin + 1; i < end; ++i)
+            {
+                bmin = min_union(bmin, points[_indices[i]]);
+                bmax = max_union(bmax, points[_indices[i]]);
+            }
+
+            u32 axis = 0;
+            for (u32 a = 1; a < N; ++a)
+                if (bmax[a] - bmin[a] > bmax[axis] - bmin[axis])
+                    axis = a;
+
+            u32 mid = begin + (end - begin) / 2;
+            std::nth_element(_indices.begin() + begin, _indices.begin() + mid, _indices.begin() + end,
+                             [points, axis](u32 a, u32 b) { return points[a][axis] < points[b][axis]; });
+
+            T split = points[_indices[mid]][axis];
+            build_node(points, begin, mid, depth + 1);
+            u32 right = build_node(points, mid, end, depth + 1);
+
+            node& n = _nodes[index];
+            n.axis = axis;
+            n.split = split;
+            n.right = right;
+            return index;
+        }
+
+        // visits leaves nearest side first, skipping far subtrees whose split plane is further than limit2. limit2 is
+        // a reference so knn can shrink it as results are found.
+        template <class F>
+        void traverse(const vec_t& p, const T& limit2, F leaf) const
+        {
+            struct entry
+            {
+                u32 node;
+                T   d2;
+            };
+
+            entry stack[k_kdtree_max_depth];
+            u32   sp = 0;
+            stack[sp++] = {0, T(0)};
+            while (sp > 0)
+            {
+                entry e = stack[--sp];
+                if (e.d2 > limit2)
+                    continue;
+
+                const node* n = &_nodes[e.node];
+                while (n->right != 0)
+                {
+                    u32 left = (u32)(n - _nodes.data()) + 1;
+                    T   diff = p[n->axis] - n->split;
+                    u32 near = diff < T(0) ? left : n->right;
+                    u32 far = diff < T(0) ? n->right : left;
+
+                    T d2 = diff * diff;
+                    if (d2 <= limit2)
+                        stack[sp++] = {far, d2};
+
+                    n = &_nodes[near];
+                }
+
+                leaf(n->begin, n->end);
+            }
+        }
+
+        std::vector<node>  _nodes;
+        std::vector<vec_t> _points;
+        std::vector<u32>   _indices;
+        u32                _leaf_size = k_kdtree_leaf_size;
+    };
+
+    typedef kdtree<2, f32> kdtree2f;
+    typedef kdtree<3, f32> kdtree3f;
+} // namespace maths
@@ -435,6 +435,31 @@ namespace mat
         return inverse;
     }
 
+    template <typename T>
+    Mat<3, 3, T> inverse3x3(const Mat<3, 3, T>& mat)
+    {
+        const T* m = &mat.m[0];
+
+        // determinant
+        T one_over_det = (T)1 / compute_determinant(mat);
+
+        // find the adjoint matrix (transposed) and multiply by 1/det to get the inverse
+        Mat<3, 3, T> inverse;
+        inverse.m[0] = (m[4] * m[8] - m[5] * m[7]) * one_over_det;
+        inverse.m[1] = -(m[1] * m[8] - m[2] * m[7]) * one_over_det;
+        inverse.m[2] = (m[1] * m[5] - m[2] * m[4]) * one_over_det;
+
+        inverse.m[3] = -(m[3] * m[8] - m[5] * m[6]) * one_over_det;
+        inverse.m[4] = (m[0] * m[8] - m[2] * m[6]) * one_over_det;
+        inverse.m[5] = -(m[0] * m[5] - m[2] * m[3]) * one_over_det;
+
+        inverse.m[6] = (m[3] * m[7] - m[4] * m[6]) * one_over_det;
+        inverse.m[7] = -(m[0] * m[7] - m[1] * m[6]) * one_over_det;
+        inverse.m[8] = (m[0] * m[4] - m[1] * m[3]) * one_over_det;
+
+        return inverse;
+    }
+
     template <typename T>
     Mat<4, 4, T> inverse3x4(const Mat<4, 4, T>& mat)
     {
@@ -45,6 +45,7 @@ namespace maths
     void        get_frustum_planes_from_matrix(const mat4f& view_projection, vec4f* planes_out);
     void        get_frustum_corners_from_matrix(const mat4f& view_projection, vec3f* corners);
     transform   get_transform_from_matrix(const mat4& mat);
+    void        transform_points(const mat4& mat, const vec3f* points, size_t count, vec3f* points_out);
     
     template<typename T, size_t N>
     Vec<N, T>   barycentric(const Vec<N, T>& p, const Vec<N, T>& a, const Vec<N, T>& b, const Vec<N, T>& c);
@@ -58,8 +59,19 @@ namespace maths
     // Colours
     vec3f rgb_to_hsv(vec3f rgb);
     vec3f hsv_to_rgb(vec3f hsv);
+    void  rgb_to_hsv(const f32* r, const f32* g, const f32* b, size_t count, f32* h_out, f32* s_out, f32* v_out);
+    void  hsv_to_rgb(const f32* h, const f32* s, const f32* v, size_t count, f32* r_out, f32* g_out, f32* b_out);
+    void  rgb_to_hsv(const f32* rgb, size_t count, size_t stride, f32* hsv_out);
+    void  hsv_to_rgb(const f32* hsv, size_t count, size_t stride, f32* rgb_out);
     vec4f rgba8_to_vec4f(u32 rgba);
     u32   vec4f_to_rgba8(vec4f);
+    void  rgba8_to_vec4f(const u32* rgba, size_t count, vec4f* out);
+    void  vec4f_to_rgba8(const vec4f* v, size_t count, u32* rgba_out);
+    f32   srgb_to_linear(f32 srgb);
+    f32   linear_to_srgb(f32 linear);
+    u32   linear_to_srgb8(f32 linear);
+    void  srgb8_to_linear(const u32* rgba, size_t count, vec4f* out);
+    void  linear_to_srgb8(const vec4f* v, size_t count, u32* rgba_out);
     
     // Projection
     // ndc = normalised device coordinates (-1 to 1)
@@ -73,6 +85,23 @@ namespace maths
     vec3f unproject_sc(const vec3f& p, const mat4& view_projection, const vec2i& viewport);
     vec3f unproject_sc_vdown(const vec3f& p, const mat4& view_projection, const vec2i& viewport);
 
+    // Batch Projection
+    // the viewport mapping (and for unproject the inverse) is folded into a single matrix up front
+    // so each point costs one transform and one reciprocal for the homogeneous divide
+    mat4  get_project_to_sc_matrix(const mat4& view_projection, const vec2i& viewport);
+    mat4  get_project_to_sc_vdown_matrix(const mat4& view_projection, const vec2i& viewport);
+    mat4  get_unproject_sc_matrix(const mat4& view_projection, const vec2i& viewport);
+    mat4  get_unproject_sc_vdown_matrix(const mat4& view_projection, const vec2i& viewport);
+    void  project_points(const mat4& mat, const vec3f* points, size_t count, vec3f* points_out);
+    void  project_points(const mat4& mat, const void* points, size_t stride, size_t count, void* points_out, size_t stride_out);
+    void  project_points(const mat4& mat, const f32* x, const f32* y, const f32* z, size_t count, f32* x_out, f32* y_out, f32* z_out);
+    void  project_to_ndc(const vec3f* p, size_t count, const mat4& view_projection, vec3f* ndc_out);
+    void  project_to_sc(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* sc_out);
+    void  project_to_sc_vdown(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* sc_out);
+    void  unproject_ndc(const vec3f* p, size_t count, const mat4& view_projection, vec3f* out);
+    void  unproject_sc(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* out);
+    void  unproject_sc_vdown(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* out);
+
     // Overlaps
     u32  aabb_vs_plane(const vec3f& aabb_min, const vec3f& aabb_max, const vec3f& x0, const vec3f& xN);
     u32  sphere_vs_plane(const vec3f& s, f32 r, const vec3f& x0, const vec3f& xN);
@@ -81,6 +110,8 @@ namespace maths
     bool aabb_vs_aabb(const vec3f& min0, const vec3f& max0, const vec3f& min1, const vec3f& max1);
     bool aabb_vs_frustum(const vec3f& aabb_pos, const vec3f& aabb_extent, vec4f* planes);
     bool sphere_vs_frustum(const vec3f& pos, f32 radius, vec4f* planes);
+    void aabb_vs_frustum(const vec3f* aabb_pos, const vec3f* aabb_extent, size_t count, const vec4f* planes, bool* inside_out);
+    void sphere_vs_frustum(const vec3f* pos, const f32* radius, size_t count, const vec4f* planes, bool* inside_out);
     // todo: obb vs obb
 
     // Point Test
@@ -92,6 +123,7 @@ namespace maths
     bool point_inside_cone(const vec3f& p, const vec3f& cp, const vec3f& cv, f32 h, f32 r);
     bool point_inside_convex_hull(const vec2f& p, const std::vector<vec2f>& hull);
     bool point_inside_poly(const vec2f& p, const std::vector<vec2f>& poly);
+    void point_inside_poly(const vec2f* points, size_t count, const std::vector<vec2f>& poly, bool* inside_out);
     
     // Closest Point
     template<size_t N, typename T>
@@ -207,6 +239,153 @@ namespace maths
         return out_rgb;
     }
 
+    constexpr size_t k_colour_batch_block = 64;
+
+    // branch free rgb to hsv for a single pixel with the same results as rgb_to_hsv, the swaps are replaced by selects
+    // which compilers turn into blends so the batch loops below vectorise
+    maths_inline void rgb_to_hsv_branchless(f32 r, f32 g, f32 b, f32& h, f32& s, f32& v)
+    {
+        bool sgb = g < b;
+        f32  g1 = sgb ? b : g;
+        f32  b1 = sgb ? g : b;
+        f32  k = sgb ? -1.0f : 0.0f;
+
+        bool srg = r < g1;
+        f32  r2 = srg ? g1 : r;
+        f32  g2 = srg ? r : g1;
+        k = srg ? -2.0f / 6.0f - k : k;
+
+        f32 chroma = r2 - min(g2, b1);
+        h = fabsf(k + (g2 - b1) / (6.0f * chroma + 1e-20f));
+        s = chroma / (r2 + 1e-20f);
+        v = r2;
+    }
+
+    // branch free hsv to rgb for a single pixel, hue wraps to 0-1 and must be within int range.
+    // gcc only if-converts a few select patterns (and vectorises floorf only with -ffast-math), so the hue is wrapped by
+    // truncation and each channel evaluates both periods of its ramp (k in 0-6 and 6-12) with min / max instead of
+    // wrapping k. the ramps are kept in locals since min / max results used directly inside expressions also block it.
+    maths_inline void hsv_to_rgb_branchless(f32 h, f32 s, f32 v, f32& r, f32& g, f32& b)
+    {
+        f32 hf = h - (f32)(int)h;
+        hf += hf < 0.0f ? 1.0f : 0.0f;
+
+        f32 h6 = hf * 6.0f;
+        f32 kr = 5.0f + h6;
+        f32 kg = 3.0f + h6;
+        f32 kb = 1.0f + h6;
+
+        f32 xr = saturate(max(min(kr, 4.0f - kr), min(kr - 6.0f, 10.0f - kr)));
+        f32 xg = saturate(max(min(kg, 4.0f - kg), min(kg - 6.0f, 10.0f - kg)));
+        f32 xb = saturate(max(min(kb, 4.0f - kb), min(kb - 6.0f, 10.0f - kb)));
+
+        f32 vs = v * s;
+        r = v - vs * xr;
+        g = v - vs * xg;
+        b = v - vs * xb;
+    }
+
+    // batch colour conversions work on blocks of k_colour_batch_block pixels gathered into local soa arrays, the
+    // conversion loop over the locals vectorises regardless of the input layout or aliasing between inputs and outputs
+
+    // batch rgb to hsv over soa channel arrays, outputs may alias the inputs
+    inline void rgb_to_hsv(const f32* r, const f32* g, const f32* b, size_t count, f32* h_out, f32* s_out, f32* v_out)
+    {
+        f32 c0[k_colour_batch_block], c1[k_colour_batch_block], c2[k_colour_batch_block];
+        for (size_t base = 0; base < count; base += k_colour_batch_block)
+        {
+            size_t n = min(k_colour_batch_block, count - base);
+            memcpy(c0, r + base, n * sizeof(f32));
+            memcpy(c1, g + base, n * sizeof(f32));
+            memcpy(c2, b + base, n * sizeof(f32));
+
+            for (size_t i = 0; i < n; ++i)
+                rgb_to_hsv_branchless(c0[i], c1[i], c2[i], c0[i], c1[i], c2[i]);
+
+            memcpy(h_out + base, c0, n * sizeof(f32));
+            memcpy(s_out + base, c1, n * sizeof(f32));
+            memcpy(v_out + base, c2, n * sizeof(f32));
+        }
+    }
+
+    // batch hsv to rgb over soa channel arrays, outputs may alias the inputs
+    inline void hsv_to_rgb(const f32* h, const f32* s, const f32* v, size_t count, f32* r_out, f32* g_out, f32* b_out)
+    {
+        f32 c0[k_colour_batch_block], c1[k_colour_batch_block], c2[k_colour_batch_block];
+        for (size_t base = 0; base < count; base += k_colour_batch_block)
+        {
+            size_t n = min(k_colour_batch_block, count - base);
+            memcpy(c0, h + base, n * sizeof(f32));
+            memcpy(c1, s + base, n * sizeof(f32));
+            memcpy(c2, v + base, n * sizeof(f32));
+
+            for (size_t i = 0; i < n; ++i)
+                hsv_to_rgb_branchless(c0[i], c1[i], c2[i], c0[i], c1[i], c2[i]);
+
+            memcpy(r_out + base, c0, n * sizeof(f32));
+            memcpy(g_out + base, c1, n * sizeof(f32));
+            memcpy(b_out + base, c2, n * sizeof(f32));
+        }
+    }
+
+    // batch rgb to hsv over interleaved pixels stride floats apart (3 for rgb, 4 for rgba).
+    // only the first 3 channels of each output pixel are written, hsv_out may be the same buffer as rgb.
+    inline void rgb_to_hsv(const f32* rgb, size_t count, size_t stride, f32* hsv_out)
+    {
+        f32 c0[k_colour_batch_block], c1[k_colour_batch_block], c2[k_colour_batch_block];
+        for (size_t base = 0; base < count; base += k_colour_batch_block)
+        {
+            size_t n = min(k_colour_batch_block, count - base);
+            const f32* p = rgb + base * stride;
+            for (size_t i = 0; i < n; ++i)
+            {
+                c0[i] = p[i * stride + 0];
+                c1[i] = p[i * stride + 1];
+                c2[i] = p[i * stride + 2];
+            }
+
+            for (size_t i = 0; i < n; ++i)
+                rgb_to_hsv_branchless(c0[i], c1[i], c2[i], c0[i], c1[i], c2[i]);
+
+            f32* o = hsv_out + base * stride;
+            for (size_t i = 0; i < n; ++i)
+            {
+                o[i * stride + 0] = c0[i];
+                o[i * stride + 1] = c1[i];
+                o[i * stride + 2] = c2[i];
+            }
+        }
+    }
+
+    // batch hsv to rgb over interleaved pixels stride floats apart (3 for hsv, 4 for hsva).
+    // only the first 3 channels of each output pixel are written, rgb_out may be the same buffer as hsv.
+    inline void hsv_to_rgb(const f32* hsv, size_t count, size_t stride, f32* rgb_out)
+    {
+        f32 c0[k_colour_batch_block], c1[k_colour_batch_block], c2[k_colour_batch_block];
+        for (size_t base = 0; base < count; base += k_colour_batch_block)
+        {
+            size_t n = min(k_colour_batch_block, count - base);
+            const f32* p = hsv + base * stride;
+            for (size_t i = 0; i < n; ++i)
+            {
+                c0[i] = p[i * stride + 0];
+                c1[i] = p[i * stride + 1];
+                c2[i] = p[i * stride + 2];
+            }
+
+            for (size_t i = 0; i < n; ++i)
+                hsv_to_rgb_branchless(c0[i], c1[i], c2[i], c0[i], c1[i], c2[i]);
+
+            f32* o = rgb_out + base * stride;
+            for (size_t i = 0; i < n; ++i)
+            {
+                o[i * stride + 0] = c0[i];
+                o[i * stride + 1] = c1[i];
+                o[i * stride + 2] = c2[i];
+            }
+        }
+    }
+
     // convert rgb8 packed in u32 to vec4 (f32) rgba
     inline vec4f rgba8_to_vec4f(u32 rgba)
     {
@@ -229,6 +408,157 @@ namespace maths
         rgba |= ((u32)(v[3] * 255.0f)) << 24;
         return rgba;
     }
+
+    // batch version of rgba8_to_vec4f
+    inline void rgba8_to_vec4f(const u32* rgba, size_t count, vec4f* out)
+    {
+        constexpr f32 k_one_over_255 = 1.0f/255.0f;
+        f32* o = &out[0].v[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            u32 c = rgba[i];
+            o[i * 4 + 0] = (f32)((c >> 0) & 0xff) * k_one_over_255;
+            o[i * 4 + 1] = (f32)((c >> 8) & 0xff) * k_one_over_255;
+            o[i * 4 + 2] = (f32)((c >> 16) & 0xff) * k_one_over_255;
+            o[i * 4 + 3] = (f32)((c >> 24) & 0xff) * k_one_over_255;
+        }
+    }
+
+    // batch version of vec4f_to_rgba8, unlike the single colour version channels are clamped to 0-1 and rounded to
+    // the nearest value so 0.5 packs to 128 and out of range values do not bleed into neighbouring channels
+    inline void vec4f_to_rgba8(const vec4f* v, size_t count, u32* rgba_out)
+    {
+        const f32* p = &v[0].v[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            u32 rgba = 0;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                f32 x = saturate(p[i * 4 + c]);
+                rgba |= (u32)(x * 255.0f + 0.5f) << (c * 8);
+            }
+            rgba_out[i] = rgba;
+        }
+    }
+
+    // exact srgb transfer function, srgb in 0-1 to linear in 0-1
+    inline f32 srgb_to_linear(f32 srgb)
+    {
+        if (srgb <= 0.04045f)
+            return srgb / 12.92f;
+        return powf((srgb + 0.055f) / 1.055f, 2.4f);
+    }
+
+    // exact inverse srgb transfer function, linear in 0-1 to srgb in 0-1
+    inline f32 linear_to_srgb(f32 linear)
+    {
+        if (linear <= 0.0031308f)
+            return linear * 12.92f;
+        return 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // returns a 256 entry table of srgb8 values decoded to linear 0-1, built on first use
+    inline const f32* get_srgb8_decode_table()
+    {
+        struct table
+        {
+            f32 v[256];
+            table()
+            {
+                for (u32 i = 0; i < 256; ++i)
+                    v[i] = srgb_to_linear((f32)i / 255.0f);
+            }
+        };
+        static const table t;
+        return t.v;
+    }
+
+    // returns the table for linear_to_srgb8, built on first use.
+    // linear values in [2^-13, 1) are split into 104 buckets by the float exponent and top 3 mantissa bits, each bucket
+    // holds a least squares line fitted to the srgb curve across it, stored as 16.16 fixed point bias (including the
+    // rounding offset) in the low word and slope per step of the next 8 mantissa bits in the high word.
+    inline const u64* get_srgb8_encode_table()
+    {
+        struct table
+        {
+            u64 v[104];
+            table()
+            {
+                for (u32 b = 0; b < 104; ++b)
+                {
+                    // least squares fit of y = a + b * t for t in 0-255, y sampled at the centre of each step
+                    f64 st = 0.0, sy = 0.0, stt = 0.0, sty = 0.0;
+                    for (u32 t = 0; t < 256; ++t)
+                    {
+                        u32 bits = 0x39000000 + (b << 20) + (t << 12) + (1 << 11);
+                        f32 x;
+                        memcpy(&x, &bits, sizeof(f32));
+                        f64 y = (f64)linear_to_srgb(x) * 255.0;
+                        st += t;
+                        sy += y;
+                        stt += (f64)t * t;
+                        sty += t * y;
+                    }
+
+                    f64 slope = (256.0 * sty - st * sy) / (256.0 * stt - st * st);
+                    f64 bias = (sy - slope * st) / 256.0;
+                    u64 fixed_bias = (u64)((bias + 0.5) * 65536.0);
+                    u64 fixed_slope = (u64)(slope * 65536.0 + 0.5);
+                    v[b] = fixed_bias | (fixed_slope << 32);
+                }
+            }
+        };
+        static const table t;
+        return t.v;
+    }
+
+    // fast linear 0-1 to srgb8 0-255 using the bucketed table, within 1 of round(linear_to_srgb(linear) * 255)
+    // and exact for the linear values of all 256 srgb8 codes. out of range and nan inputs clamp to 0-255
+    inline u32 linear_to_srgb8(f32 linear)
+    {
+        constexpr u32 k_min_bits = 0x39000000; // 2^-13, below this all values encode to 0
+        constexpr u32 k_max_bits = 0x3f7fffff; // largest float below 1
+        const u64*    tab = get_srgb8_encode_table();
+
+        u32 bits;
+        memcpy(&bits, &linear, sizeof(u32));
+
+        // compare as ints, negative values and nan have the sign bit set or are above k_max_bits
+        bits = (int32_t)bits < (int32_t)k_min_bits ? k_min_bits : bits;
+        bits = bits > k_max_bits ? k_max_bits : bits;
+
+        u64 e = tab[(bits - k_min_bits) >> 20];
+        u32 t = (bits >> 12) & 0xff;
+        return (u32)(((e & 0xffffffff) + (e >> 32) * t) >> 16);
+    }
+
+    // batch decode of srgb8 colours to linear vec4f using the 256 entry table, alpha is stored linearly
+    inline void srgb8_to_linear(const u32* rgba, size_t count, vec4f* out)
+    {
+        constexpr f32 k_one_over_255 = 1.0f/255.0f;
+        const f32* tab = get_srgb8_decode_table();
+        f32*       o = &out[0].v[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            u32 c = rgba[i];
+            o[i * 4 + 0] = tab[(c >> 0) & 0xff];
+            o[i * 4 + 1] = tab[(c >> 8) & 0xff];
+            o[i * 4 + 2] = tab[(c >> 16) & 0xff];
+            o[i * 4 + 3] = (f32)((c >> 24) & 0xff) * k_one_over_255;
+        }
+    }
+
+    // batch encode of linear vec4f colours to srgb8 with linear_to_srgb8, alpha is clamped and rounded linearly
+    inline void linear_to_srgb8(const vec4f* v, size_t count, u32* rgba_out)
+    {
+        const f32* p = &v[0].v[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            f32 a = saturate(p[i * 4 + 3]);
+            rgba_out[i] = linear_to_srgb8(p[i * 4 + 0]) | (linear_to_srgb8(p[i * 4 + 1]) << 8) |
+                          (linear_to_srgb8(p[i * 4 + 2]) << 16) | ((u32)(a * 255.0f + 0.5f) << 24);
+        }
+    }
     
     // given the normalised vector n, constructs an orthonormal basis return in n, b1, b2
     inline void get_orthonormal_basis_hughes_moeller(const vec3f& n, vec3f& b1, vec3f& b2)
@@ -348,6 +678,243 @@ namespace maths
         return unproject_ndc(ndc, view_projection);
     }
     
+    // returns view_projection with the ndc to screen coordinate mapping of project_to_sc folded in
+    // use with project_points to perform project_to_sc on many points
+    inline mat4 get_project_to_sc_matrix(const mat4& view_projection, const vec2i& viewport)
+    {
+        f32 hw = (f32)viewport.x * 0.5f;
+        f32 hh = (f32)viewport.y * 0.5f;
+        mat4 sc = mat4(
+            hw,   0.0f, 0.0f, hw,
+            0.0f, hh,   0.0f, hh,
+            0.0f, 0.0f, 0.5f, 0.5f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        return sc * view_projection;
+    }
+
+    // returns view_projection with the ndc to screen coordinate mapping of project_to_sc_vdown folded in
+    inline mat4 get_project_to_sc_vdown_matrix(const mat4& view_projection, const vec2i& viewport)
+    {
+        f32 hw = (f32)viewport.x * 0.5f;
+        f32 hh = (f32)viewport.y * 0.5f;
+        mat4 sc = mat4(
+            hw,   0.0f, 0.0f, hw,
+            0.0f, -hh,  0.0f, hh,
+            0.0f, 0.0f, 0.5f, 0.5f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        return sc * view_projection;
+    }
+
+    // returns the inverse view_projection with the screen coordinate to ndc mapping of unproject_sc folded in
+    inline mat4 get_unproject_sc_matrix(const mat4& view_projection, const vec2i& viewport)
+    {
+        mat4 ndc = mat4(
+            2.0f / (f32)viewport.x, 0.0f, 0.0f, -1.0f,
+            0.0f, 2.0f / (f32)viewport.y, 0.0f, -1.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        return mat::inverse4x4(view_projection) * ndc;
+    }
+
+    // returns the inverse view_projection with the screen coordinate to ndc mapping of unproject_sc_vdown folded in
+    inline mat4 get_unproject_sc_vdown_matrix(const mat4& view_projection, const vec2i& viewport)
+    {
+        mat4 ndc = mat4(
+            2.0f / (f32)viewport.x, 0.0f, 0.0f, -1.0f,
+            0.0f, -2.0f / (f32)viewport.y, 0.0f, 1.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        return mat::inverse4x4(view_projection) * ndc;
+    }
+
+    // transforms count points (x, y, z, 1) by mat and performs the homogeneous divide, points are read from and written to
+    // arrays of 3 floats every stride / stride_out bytes, which allows positions to be read straight from interleaved
+    // vertex data. points and points_out may alias if the strides match.
+    inline void project_points(const mat4& mat, const void* points, size_t stride, size_t count, void* points_out, size_t stride_out)
+    {
+        const f32*  m = &mat.m[0];
+        const char* src = (const char*)points;
+        char*       dst = (char*)points_out;
+        for (size_t i = 0; i < count; ++i, src += stride, dst += stride_out)
+        {
+            const f32* p = (const f32*)src;
+            f32 x = m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3];
+            f32 y = m[4] * p[0] + m[5] * p[1] + m[6] * p[2] + m[7];
+            f32 z = m[8] * p[0] + m[9] * p[1] + m[10] * p[2] + m[11];
+            f32 w = m[12] * p[0] + m[13] * p[1] + m[14] * p[2] + m[15];
+            f32 rw = 1.0f / w;
+
+            f32* o = (f32*)dst;
+            o[0] = x * rw;
+            o[1] = y * rw;
+            o[2] = z * rw;
+        }
+    }
+
+    // aos version of project_points
+    inline void project_points(const mat4& mat, const vec3f* points, size_t count, vec3f* points_out)
+    {
+        project_points(mat, (const void*)points, sizeof(vec3f), count, (void*)points_out, sizeof(vec3f));
+    }
+
+    // soa version of project_points
+    inline void project_points(const mat4& mat, const f32* x, const f32* y, const f32* z, size_t count, f32* x_out, f32* y_out, f32* z_out)
+    {
+        const f32* m = &mat.m[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            f32 px = m[0] * x[i] + m[1] * y[i] + m[2] * z[i] + m[3];
+            f32 py = m[4] * x[i] + m[5] * y[i] + m[6] * z[i] + m[7];
+            f32 pz = m[8] * x[i] + m[9] * y[i] + m[10] * z[i] + m[11];
+            f32 pw = m[12] * x[i] + m[13] * y[i] + m[14] * z[i] + m[15];
+            f32 rw = 1.0f / pw;
+            x_out[i] = px * rw;
+            y_out[i] = py * rw;
+            z_out[i] = pz * rw;
+        }
+    }
+
+    // batch versions of the projection functions above, see the single point versions for details
+
+    inline void project_to_ndc(const vec3f* p, size_t count, const mat4& view_projection, vec3f* ndc_out)
+    {
+        project_points(view_projection, p, count, ndc_out);
+    }
+
+    inline void project_to_sc(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* sc_out)
+    {
+        project_points(get_project_to_sc_matrix(view_projection, viewport), p, count, sc_out);
+    }
+
+    inline void project_to_sc_vdown(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* sc_out)
+    {
+        project_points(get_project_to_sc_vdown_matrix(view_projection, viewport), p, count, sc_out);
+    }
+
+    inline void unproject_ndc(const vec3f* p, size_t count, const mat4& view_projection, vec3f* out)
+    {
+        project_points(mat::inverse4x4(view_projection), p, count, out);
+    }
+
+    inline void unproject_sc(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* out)
+    {
+        project_points(get_unproject_sc_matrix(view_projection, viewport), p, count, out);
+    }
+
+    inline void unproject_sc_vdown(const vec3f* p, size_t count, const mat4& view_projection, const vec2i& viewport, vec3f* out)
+    {
+        project_points(get_unproject_sc_vdown_matrix(view_projection, viewport), p, count, out);
+    }
+
+    constexpr u32 k_ray_packet_dim = 8;
+    constexpr u32 k_ray_packet_size = k_ray_packet_dim * k_ray_packet_dim;
+
+    // soa tile of 8x8 camera rays, lane i is pixel (x + i % 8, y + i / 8) and directions are normalised.
+    // lanes outside the viewport still contain valid rays, width and height are the number of columns and rows inside it
+    struct ray_packet
+    {
+        f32 ox[k_ray_packet_size];
+        f32 oy[k_ray_packet_size];
+        f32 oz[k_ray_packet_size];
+        f32 dx[k_ray_packet_size];
+        f32 dy[k_ray_packet_size];
+        f32 dz[k_ray_packet_size];
+        u32 x = 0;
+        u32 y = 0;
+        u32 width = 0;
+        u32 height = 0;
+    };
+
+    // generates primary rays for ray tracing and picking, matching unproject_sc (or unproject_sc_vdown when vdown is set).
+    // the inverse view projection is computed once in init, after that a ray is a linear function of the pixel position
+    // so generating it costs a few multiply adds and two homogeneous divides. rays start on the near plane (ndc_near)
+    // and point towards the far plane (ndc_far), use 0 for ndc_near with a 0-1 depth range projection.
+    class camera_ray_generator
+    {
+    public:
+        void init(const mat4& view_projection, const vec2i& viewport, bool vdown = false, f32 ndc_near = -1.0f, f32 ndc_far = 1.0f)
+        {
+            mat4 inv = vdown ? get_unproject_sc_vdown_matrix(view_projection, viewport)
+                             : get_unproject_sc_matrix(view_projection, viewport);
+
+            _dx = inv.get_column(0);
+            _dy = inv.get_column(1);
+            _near = inv.get_column(2) * ndc_near + inv.get_column(3);
+            _far = inv.get_column(2) * ndc_far + inv.get_column(3);
+            _viewport = viewport;
+        }
+
+        u32 num_tiles_x() const
+        {
+            return ((u32)_viewport.x + k_ray_packet_dim - 1) / k_ray_packet_dim;
+        }
+
+        u32 num_tiles_y() const
+        {
+            return ((u32)_viewport.y + k_ray_packet_dim - 1) / k_ray_packet_dim;
+        }
+
+        // ray through screen coordinate sc, pixel centres are at +0.5
+        void generate(const vec2f& sc, vec3f& origin, vec3f& direction) const
+        {
+            vec4f t = _dx * sc.x + _dy * sc.y;
+            vec4f n = _near + t;
+            vec4f f = _far + t;
+            origin = n.xyz / n.w;
+            direction = normalised(f.xyz / f.w - origin);
+        }
+
+        // fills packet with the rays of tile (tile_x, tile_y), jitter is either nullptr to sample pixel centres or
+        // k_ray_packet_size sub pixel offsets in the range 0-1 indexed by lane
+        void generate(u32 tile_x, u32 tile_y, ray_packet& packet, const vec2f* jitter = nullptr) const
+        {
+            packet.x = tile_x * k_ray_packet_dim;
+            packet.y = tile_y * k_ray_packet_dim;
+            packet.width = min<u32>(k_ray_packet_dim, (u32)_viewport.x - min<u32>(packet.x, (u32)_viewport.x));
+            packet.height = min<u32>(k_ray_packet_dim, (u32)_viewport.y - min<u32>(packet.y, (u32)_viewport.y));
+
+            for (u32 i = 0; i < k_ray_packet_size; ++i)
+            {
+                f32 sx = (f32)(packet.x + i % k_ray_packet_dim) + (jitter ? jitter[i].x : 0.5f);
+                f32 sy = (f32)(packet.y + i / k_ray_packet_dim) + (jitter ? jitter[i].y : 0.5f);
+
+                f32 tx = _dx.x * sx + _dy.x * sy;
+                f32 ty = _dx.y * sx + _dy.y * sy;
+                f32 tz = _dx.z * sx + _dy.z * sy;
+                f32 tw = _dx.w * sx + _dy.w * sy;
+
+                f32 rn = 1.0f / (_near.w + tw);
+                f32 rf = 1.0f / (_far.w + tw);
+
+                f32 ox = (_near.x + tx) * rn;
+                f32 oy = (_near.y + ty) * rn;
+                f32 oz = (_near.z + tz) * rn;
+                f32 dx = (_far.x + tx) * rf - ox;
+                f32 dy = (_far.y + ty) * rf - oy;
+                f32 dz = (_far.z + tz) * rf - oz;
+                f32 rl = 1.0f / sqrt(dx * dx + dy * dy + dz * dz);
+
+                packet.ox[i] = ox;
+                packet.oy[i] = oy;
+                packet.oz[i] = oz;
+                packet.dx[i] = dx * rl;
+                packet.dy[i] = dy * rl;
+                packet.dz[i] = dz * rl;
+            }
+        }
+
+    private:
+        vec4f _dx = vec4f::zero();
+        vec4f _dy = vec4f::zero();
+        vec4f _near = vec4f::zero();
+        vec4f _far = vec4f::zero();
+        vec2i _viewport = vec2i::zero();
+    };
+    
     // convert azimuth / altitude to vec3f xyz
     inline vec3f azimuth_altitude_to_xyz(f32 azimuth, f32 altitude)
     {
@@ -556,6 +1123,46 @@ namespace maths
         return true;
     }
 
+    // batch version of aabb_vs_frustum, writes the result for each of the count aabbs into inside_out
+    // the plane normal signs are resolved once up front instead of per aabb
+    inline void aabb_vs_frustum(const vec3f* aabb_pos, const vec3f* aabb_extent, size_t count, const vec4f* planes, bool* inside_out)
+    {
+        vec3f n[6], an[6];
+        f32   pd[6];
+        for (size_t p = 0; p < 6; ++p)
+        {
+            n[p] = planes[p].xyz;
+            an[p] = fabs(n[p]);
+            pd[p] = planes[p].w;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            bool inside = true;
+            for (size_t p = 0; p < 6; ++p)
+            {
+                f32 d2 = dot(aabb_pos[i], n[p]) - dot(aabb_extent[i], an[p]);
+                inside &= !(d2 > -pd[p]);
+            }
+            inside_out[i] = inside;
+        }
+    }
+
+    // batch version of sphere_vs_frustum, writes the result for each of the count spheres into inside_out
+    inline void sphere_vs_frustum(const vec3f* pos, const f32* radius, size_t count, const vec4f* planes, bool* inside_out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            bool inside = true;
+            for (size_t p = 0; p < 6; ++p)
+            {
+                f32 d = dot(pos[i], (vec3f)planes[p].xyz) + planes[p].w;
+                inside &= !(d > radius[i]);
+            }
+            inside_out[i] = inside;
+        }
+    }
+
     // returns true if sphere with centre s0 and radius r0 contains point p0
     inline bool point_inside_sphere(const vec3f& s0, f32 r0, const vec3f& p0)
     {
@@ -620,6 +1227,13 @@ namespace maths
         return c;
     }
     
+    // batch version of point_inside_poly, classifies count points against the same polygon
+    inline void point_inside_poly(const vec2f* points, size_t count, const std::vector<vec2f>& poly, bool* inside_out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            inside_out[i] = point_inside_poly(points[i], poly);
+    }
+    
     // returns the closest point from p0 on sphere s0 with radius r0
     inline vec3f closest_point_on_sphere(const vec3f& s0, f32 r0, const vec3f& p0)
     {
@@ -930,6 +1544,21 @@ namespace maths
         return t;
     }
 
+    // transforms count points by mat (with w = 1 and no homogeneous divide) writing them into points_out
+    // points and points_out may be the same array
+    inline void transform_points(const mat4& mat, const vec3f* points, size_t count, vec3f* points_out)
+    {
+        const f32* m = &mat.m[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            const vec3f& p = points[i];
+            f32 x = m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3];
+            f32 y = m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7];
+            f32 z = m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11];
+            points_out[i] = vec3f(x, y, z);
+        }
+    }
+
     // returns true if ray with origin r1 and direction rv intersects the aabb defined by emin and emax
     // Intersection point is stored in ip
     inline bool ray_vs_aabb(const vec3f& emin, const vec3f& emax, const vec3f& r1, const vec3f& rv, vec3f& ip)
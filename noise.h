@@ -0,0 +1,647 @@
+// noise.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+// seeded procedural noise in 2, 3 and 4 dimensions.
+// lattice values, gradients and feature points come from an integer hash of the cell coordinates and seed instead of a
+// permutation table, so results are deterministic across platforms, any seed gives an independent field and there
+// are no table lookups in the inner loops. functions take a Vec<N, f32> or a pointer to N floats, batch versions take
+// N soa coordinate arrays and evaluate k_noise_lanes points per kernel call.
+//
+// ranges:
+// value, perlin and simplex are in -1 to 1
+// worley returns the distance to the nearest (and second nearest) feature point, roughly 0 to 1.2
+// fbm is in the range of the underlying noise, ridged is in 0 to 1
+
+namespace maths
+{
+    enum class e_noise
+    {
+        value,
+        perlin,
+        simplex,
+        worley
+    };
+
+    // number of points evaluated together by the batch functions
+    constexpr size_t k_noise_lanes = 8;
+
+    // 32 bit integer finaliser with good avalanche (lowbias32)
+    maths_inline u32 noise_hash(u32 h)
+    {
+        h ^= h >> 16;
+        h *= 0x7feb352d;
+        h ^= h >> 15;
+        h *= 0x846ca68b;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // per axis multipliers combined with the cell coordinates before the final hash
+    maths_inline u32 noise_prime(size_t axis)
+    {
+        return axis == 0 ? 0x8da6b343 : axis == 1 ? 0xd8163841 : axis == 2 ? 0xcb1ab31f : 0x165667b1;
+    }
+
+    // floor to int without floorf which blocks vectorisation without -ffast-math
+    maths_inline int noise_floor(f32 x)
+    {
+        int i = (int)x;
+        i -= x < (f32)i ? 1 : 0;
+        return i;
+    }
+
+    // quintic fade 6t^5 - 15t^4 + 10t^3, c2 continuous across cells
+    maths_inline f32 noise_fade(f32 t)
+    {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    // the noise kernels below evaluate W points at once from p[axis][lane]. loops over corners and axes are outside
+    // and loops over lanes inside so the lane loops vectorise, the single point functions use W = 1 so batch and
+    // single point results are identical.
+
+    //
+    // value noise
+    //
+
+    // random values at lattice points blended with the quintic fade
+    template <size_t N, size_t W>
+    inline void value_noise_lanes(const f32 (&p)[N][W], u32 seed, f32 (&out)[W])
+    {
+        int i0[N][W];
+        f32 u[N][W];
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+            {
+                i0[k][l] = noise_floor(p[k][l]);
+                u[k][l] = noise_fade(p[k][l] - (f32)i0[k][l]);
+            }
+
+        u32 base = noise_hash(seed + 0x9e3779b9);
+        for (size_t l = 0; l < W; ++l)
+            out[l] = 0.0f;
+
+        for (u32 c = 0; c < (1u << N); ++c)
+        {
+            u32 h[W];
+            f32 w[W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = base;
+                w[l] = 1.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+            {
+                u32 bit = (c >> k) & 1;
+                u32 prime = noise_prime(k);
+                for (size_t l = 0; l < W; ++l)
+                {
+                    h[l] += (u32)(i0[k][l] + (int)bit) * prime;
+                    w[l] *= bit ? u[k][l] : 1.0f - u[k][l];
+                }
+            }
+
+            for (size_t l = 0; l < W; ++l)
+            {
+                u32 hl = noise_hash(h[l]);
+                out[l] += w[l] * ((f32)(hl & 0xffffff) * (2.0f / 16777215.0f) - 1.0f);
+            }
+        }
+    }
+
+    //
+    // perlin (gradient) noise
+    //
+
+    // gradient noise with unit length gradients at lattice points blended with the quintic fade
+    template <size_t N, size_t W>
+    inline void perlin_noise_lanes(const f32 (&p)[N][W], u32 seed, f32 (&out)[W])
+    {
+        int i0[N][W];
+        f32 f[N][W], u[N][W];
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+            {
+                i0[k][l] = noise_floor(p[k][l]);
+                f[k][l] = p[k][l] - (f32)i0[k][l];
+                u[k][l] = noise_fade(f[k][l]);
+            }
+
+        u32 base = noise_hash(seed + 0x9e3779b9);
+        for (size_t l = 0; l < W; ++l)
+            out[l] = 0.0f;
+
+        for (u32 c = 0; c < (1u << N); ++c)
+        {
+            u32 h[W];
+            f32 w[W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = base;
+                w[l] = 1.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+            {
+                u32 bit = (c >> k) & 1;
+                u32 prime = noise_prime(k);
+                for (size_t l = 0; l < W; ++l)
+                {
+                    h[l] += (u32)(i0[k][l] + (int)bit) * prime;
+                    w[l] *= bit ? u[k][l] : 1.0f - u[k][l];
+                }
+            }
+
+            // 8 bits per gradient component
+            f32 gd[W], gg[W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = noise_hash(h[l]);
+                gd[l] = 0.0f;
+                gg[l] = 0.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+            {
+                f32 bit = (f32)((c >> k) & 1);
+                for (size_t l = 0; l < W; ++l)
+                {
+                    f32 g = (f32)((h[l] >> (k * 8)) & 0xff) * (2.0f / 255.0f) - 1.0f;
+                    gd[l] += g * (f[k][l] - bit);
+                    gg[l] += g * g;
+                }
+            }
+
+            for (size_t l = 0; l < W; ++l)
+                out[l] += w[l] * gd[l] / sqrt(gg[l] + 1e-12f);
+        }
+
+        // max amplitude with unit gradients is sqrt(N) / 2
+        f32 scale = 2.0f / sqrt((f32)N);
+        for (size_t l = 0; l < W; ++l)
+            out[l] *= scale;
+    }
+
+    //
+    // simplex noise
+    //
+
+    // n dimensional simplex noise with unit length gradients, the lattice is skewed so each cell is split into n!
+    // simplices and a point takes contributions from the N + 1 corners of the simplex containing it
+    template <size_t N, size_t W>
+    inline void simplex_noise_lanes(const f32 (&p)[N][W], u32 seed, f32 (&out)[W])
+    {
+        // reciprocal of the max amplitude with unit gradients for 2, 3 and 4 dimensions
+        static const f32 k_scale[5] = {0.0f, 0.0f, 99.1f, 107.5f, 108.4f};
+
+        const f32 sq = sqrt((f32)(N + 1));
+        const f32 skew = (sq - 1.0f) / (f32)N;
+        const f32 unskew = (1.0f - 1.0f / sq) / (f32)N;
+
+        f32 s[W], t[W];
+        for (size_t l = 0; l < W; ++l)
+        {
+            s[l] = 0.0f;
+            t[l] = 0.0f;
+        }
+
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+                s[l] += p[k][l];
+
+        int i0[N][W];
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+            {
+                i0[k][l] = noise_floor(p[k][l] + s[l] * skew);
+                t[l] += (f32)i0[k][l];
+            }
+
+        f32 x0[N][W];
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+                x0[k][l] = p[k][l] - ((f32)i0[k][l] - t[l] * unskew);
+
+        // rank of each axis by the offset within the cell, 0 = largest, the simplex is walked in rank order
+        u32 rank[N][W];
+        for (size_t k = 0; k < N; ++k)
+        {
+            for (size_t l = 0; l < W; ++l)
+                rank[k][l] = 0;
+
+            for (size_t j = 0; j < N; ++j)
+            {
+                if (j == k)
+                    continue;
+
+                for (size_t l = 0; l < W; ++l)
+                    rank[k][l] += (j < k ? x0[j][l] >= x0[k][l] : x0[j][l] > x0[k][l]) ? 1 : 0;
+            }
+        }
+
+        u32 base = noise_hash(seed + 0x9e3779b9);
+        for (size_t l = 0; l < W; ++l)
+            out[l] = 0.0f;
+
+        for (u32 v = 0; v <= N; ++v)
+        {
+            u32 h[W];
+            f32 d2[W];
+            f32 d[N][W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = base;
+                d2[l] = 0.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+            {
+                u32 prime = noise_prime(k);
+                for (size_t l = 0; l < W; ++l)
+                {
+                    u32 o = rank[k][l] < v ? 1 : 0;
+                    h[l] += (u32)(i0[k][l] + (int)o) * prime;
+                    d[k][l] = x0[k][l] - (f32)o + (f32)v * unskew;
+                    d2[l] += d[k][l] * d[k][l];
+                }
+            }
+
+            f32 gd[W], gg[W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = noise_hash(h[l]);
+                gd[l] = 0.0f;
+                gg[l] = 0.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+                for (size_t l = 0; l < W; ++l)
+                {
+                    f32 g = (f32)((h[l] >> (k * 8)) & 0xff) * (2.0f / 255.0f) - 1.0f;
+                    gd[l] += g * d[k][l];
+                    gg[l] += g * g;
+                }
+
+            for (size_t l = 0; l < W; ++l)
+            {
+                f32 a = max(0.5f - d2[l], 0.0f);
+                a *= a;
+                out[l] += a * a * gd[l] / sqrt(gg[l] + 1e-12f);
+            }
+        }
+
+        for (size_t l = 0; l < W; ++l)
+            out[l] *= k_scale[N];
+    }
+
+    //
+    // worley (cellular) noise
+    //
+
+    // distances to the nearest and second nearest of one randomly placed feature point per cell
+    template <size_t N, size_t W>
+    inline void worley_noise_lanes(const f32 (&p)[N][W], u32 seed, f32 (&f1)[W], f32 (&f2)[W])
+    {
+        int i0[N][W];
+        f32 f[N][W];
+        for (size_t k = 0; k < N; ++k)
+            for (size_t l = 0; l < W; ++l)
+            {
+                i0[k][l] = noise_floor(p[k][l]);
+                f[k][l] = p[k][l] - (f32)i0[k][l];
+            }
+
+        u32 num_neighbours = 1;
+        for (size_t k = 0; k < N; ++k)
+            num_neighbours *= 3;
+
+        u32 base = noise_hash(seed + 0x9e3779b9);
+        f32 d1[W], d2[W];
+        for (size_t l = 0; l < W; ++l)
+        {
+            d1[l] = FLT_MAX;
+            d2[l] = FLT_MAX;
+        }
+
+        for (u32 n = 0; n < num_neighbours; ++n)
+        {
+            int off[N];
+            u32 r = n;
+            for (size_t k = 0; k < N; ++k)
+            {
+                off[k] = (int)(r % 3) - 1;
+                r /= 3;
+            }
+
+            u32 h[W];
+            for (size_t l = 0; l < W; ++l)
+                h[l] = base;
+
+            for (size_t k = 0; k < N; ++k)
+            {
+                u32 prime = noise_prime(k);
+                for (size_t l = 0; l < W; ++l)
+                    h[l] += (u32)(i0[k][l] + off[k]) * prime;
+            }
+
+            f32 dist[W];
+            for (size_t l = 0; l < W; ++l)
+            {
+                h[l] = noise_hash(h[l]);
+                dist[l] = 0.0f;
+            }
+
+            for (size_t k = 0; k < N; ++k)
+                for (size_t l = 0; l < W; ++l)
+                {
+                    f32 jitter = (f32)((h[l] >> (k * 8)) & 0xff) * (1.0f / 255.0f);
+                    f32 d = (f32)off[k] + jitter - f[k][l];
+                    dist[l] += d * d;
+                }
+
+            for (size_t l = 0; l < W; ++l)
+            {
+                f32 second = max(d1[l], dist[l]);
+                f32 first = min(d1[l], dist[l]);
+                d2[l] = min(d2[l], second);
+                d1[l] = first;
+            }
+        }
+
+        for (size_t l = 0; l < W; ++l)
+        {
+            f1[l] = sqrt(d1[l]);
+            f2[l] = sqrt(d2[l]);
+        }
+    }
+
+    template <size_t N, size_t W>
+    inline void worley_noise_lanes(const f32 (&p)[N][W], u32 seed, f32 (&out)[W])
+    {
+        f32 f2[W];
+        worley_noise_lanes<N, W>(p, seed, out, f2);
+    }
+
+    //
+    // single point versions, p points to N coordinates
+    //
+
+    template <size_t N>
+    inline f32 value_noise(const f32* p, u32 seed)
+    {
+        f32 lp[N][1], out[1];
+        for (size_t k = 0; k < N; ++k)
+            lp[k][0] = p[k];
+        value_noise_lanes<N, 1>(lp, seed, out);
+        return out[0];
+    }
+
+    template <size_t N>
+    inline f32 perlin_noise(const f32* p, u32 seed)
+    {
+        f32 lp[N][1], out[1];
+        for (size_t k = 0; k < N; ++k)
+            lp[k][0] = p[k];
+        perlin_noise_lanes<N, 1>(lp, seed, out);
+        return out[0];
+    }
+
+    template <size_t N>
+    inline f32 simplex_noise(const f32* p, u32 seed)
+    {
+        f32 lp[N][1], out[1];
+        for (size_t k = 0; k < N; ++k)
+            lp[k][0] = p[k];
+        simplex_noise_lanes<N, 1>(lp, seed, out);
+        return out[0];
+    }
+
+    template <size_t N>
+    inline void worley_noise(const f32* p, u32 seed, f32& f1, f32& f2)
+    {
+        f32 lp[N][1], o1[1], o2[1];
+        for (size_t k = 0; k < N; ++k)
+            lp[k][0] = p[k];
+        worley_noise_lanes<N, 1>(lp, seed, o1, o2);
+        f1 = o1[0];
+        f2 = o2[0];
+    }
+
+    template <size_t N>
+    inline f32 worley_noise(const f32* p, u32 seed)
+    {
+        f32 f1, f2;
+        worley_noise<N>(p, seed, f1, f2);
+        return f1;
+    }
+
+    //
+    // vec versions
+    //
+
+    template <size_t N>
+    maths_inline f32 value_noise(const Vec<N, f32>& p, u32 seed = 0)
+    {
+        return value_noise<N>(&p.v[0], seed);
+    }
+
+    template <size_t N>
+    maths_inline f32 perlin_noise(const Vec<N, f32>& p, u32 seed = 0)
+    {
+        return perlin_noise<N>(&p.v[0], seed);
+    }
+
+    template <size_t N>
+    maths_inline f32 simplex_noise(const Vec<N, f32>& p, u32 seed = 0)
+    {
+        return simplex_noise<N>(&p.v[0], seed);
+    }
+
+    template <size_t N>
+    maths_inline f32 worley_noise(const Vec<N, f32>& p, u32 seed = 0)
+    {
+        return worley_noise<N>(&p.v[0], seed);
+    }
+
+    template <size_t N>
+    maths_inline void worley_noise(const Vec<N, f32>& p, u32 seed, f32& f1, f32& f2)
+    {
+        worley_noise<N>(&p.v[0], seed, f1, f2);
+    }
+
+    template <size_t N>
+    inline f32 noise(e_noise type, const f32* p, u32 seed)
+    {
+        switch (type)
+        {
+            case e_noise::value:
+                return value_noise<N>(p, seed);
+            case e_noise::perlin:
+                return perlin_noise<N>(p, seed);
+            case e_noise::simplex:
+                return simplex_noise<N>(p, seed);
+            case e_noise::worley:
+            default:
+                return worley_noise<N>(p, seed);
+        }
+    }
+
+    template <size_t N>
+    maths_inline f32 noise(e_noise type, const Vec<N, f32>& p, u32 seed = 0)
+    {
+        return noise<N>(type, &p.v[0], seed);
+    }
+
+    //
+    // fractal sums
+    //
+
+    // fractal brownian motion, octaves of noise with frequency scaled by lacunarity and amplitude by gain each octave.
+    // each octave uses a different seed so features do not line up at the origin, the sum is normalised by the total
+    // amplitude. zero octaves sum to 0
+    template <size_t N>
+    inline f32 fbm(e_noise type, const Vec<N, f32>& p, u32 seed = 0, u32 octaves = 5, f32 lacunarity = 2.0f, f32 gain = 0.5f)
+    {
+        f32 sum = 0.0f, amp = 1.0f, norm = 0.0f, freq = 1.0f;
+        for (u32 o = 0; o < octaves; ++o)
+        {
+            sum += amp * noise<N>(type, p * freq, seed + o);
+            norm += amp;
+            amp *= gain;
+            freq *= lacunarity;
+        }
+        return norm != 0.0f ? sum / norm : 0.0f;
+    }
+
+    // ridged multi fractal, (1 - |noise|)^2 summed over octaves giving sharp ridges where the noise crosses 0
+    template <size_t N>
+    inline f32 ridged(e_noise type, const Vec<N, f32>& p, u32 seed = 0, u32 octaves = 5, f32 lacunarity = 2.0f, f32 gain = 0.5f)
+    {
+        f32 sum = 0.0f, amp = 1.0f, norm = 0.0f, freq = 1.0f;
+        for (u32 o = 0; o < octaves; ++o)
+        {
+            f32 n = 1.0f - fabsf(noise<N>(type, p * freq, seed + o));
+            sum += amp * n * n;
+            norm += amp;
+            amp *= gain;
+            freq *= lacunarity;
+        }
+        return norm != 0.0f ? sum / norm : 0.0f;
+    }
+
+    //
+    // batch versions
+    //
+
+    // accumulates out[i] += amplitude * noise(coords * frequency) or amplitude * (1 - |noise|)^2 when ridge is set,
+    // points are processed k_noise_lanes at a time, the last partial block is padded by repeating its first point
+    template <size_t N, void (*F)(const f32 (&)[N][k_noise_lanes], u32, f32 (&)[k_noise_lanes])>
+    inline void noise_accumulate(const f32* const* coords, size_t count, u32 seed, f32 frequency, f32 amplitude,
+                                 bool ridge, f32* out)
+    {
+        for (size_t base = 0; base < count; base += k_noise_lanes)
+        {
+            size_t n = min(k_noise_lanes, count - base);
+
+            f32 p[N][k_noise_lanes];
+            for (size_t k = 0; k < N; ++k)
+                for (size_t l = 0; l < k_noise_lanes; ++l)
+                    p[k][l] = coords[k][base + (l < n ? l : 0)] * frequency;
+
+            f32 r[k_noise_lanes];
+            F(p, seed, r);
+
+            if (ridge)
+            {
+                for (size_t l = 0; l < k_noise_lanes; ++l)
+                {
+                    f32 a = 1.0f - fabsf(r[l]);
+                    r[l] = a * a;
+                }
+            }
+
+            for (size_t l = 0; l < n; ++l)
+                out[base + l] += amplitude * r[l];
+        }
+    }
+
+    template <size_t N>
+    inline void noise_accumulate(e_noise type, const f32* const* coords, size_t count, u32 seed, f32 frequency,
+                                 f32 amplitude, bool ridge, f32* out)
+    {
+        switch (type)
+        {
+            case e_noise::value:
+                noise_accumulate<N, value_noise_lanes<N, k_noise_lanes>>(coords, count, seed, frequency, amplitude, ridge, out);
+                break;
+            case e_noise::perlin:
+                noise_accumulate<N, perlin_noise_lanes<N, k_noise_lanes>>(coords, count, seed, frequency, amplitude, ridge, out);
+                break;
+            case e_noise::simplex:
+                noise_accumulate<N, simplex_noise_lanes<N, k_noise_lanes>>(coords, count, seed, frequency, amplitude, ridge, out);
+                break;
+            case e_noise::worley:
+                noise_accumulate<N, worley_noise_lanes<N, k_noise_lanes>>(coords, count, seed, frequency, amplitude, ridge, out);
+                break;
+        }
+    }
+
+    // evaluates noise at count points, coords holds N arrays of count coordinates (ie. {x, y, z})
+    template <size_t N>
+    inline void noise(e_noise type, const f32* const* coords, size_t count, u32 seed, f32* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = 0.0f;
+        noise_accumulate<N>(type, coords, count, seed, 1.0f, 1.0f, false, out);
+    }
+
+    // batch fbm, octaves are accumulated one at a time over all points so the inner loop is a single noise type
+    template <size_t N>
+    inline void fbm(e_noise type, const f32* const* coords, size_t count, u32 seed, f32* out, u32 octaves = 5,
+                    f32 lacunarity = 2.0f, f32 gain = 0.5f)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = 0.0f;
+
+        f32 amp = 1.0f, norm = 0.0f, freq = 1.0f;
+        for (u32 o = 0; o < octaves; ++o)
+        {
+            noise_accumulate<N>(type, coords, count, seed + o, freq, amp, false, out);
+            norm += amp;
+            amp *= gain;
+            freq *= lacunarity;
+        }
+
+        f32 rn = norm != 0.0f ? 1.0f / norm : 0.0f;
+        for (size_t i = 0; i < count; ++i)
+            out[i] *= rn;
+    }
+
+    // batch ridged
+    template <size_t N>
+    inline void ridged(e_noise type, const f32* const* coords, size_t count, u32 seed, f32* out, u32 octaves = 5,
+                       f32 lacunarity = 2.0f, f32 gain = 0.5f)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = 0.0f;
+
+        f32 amp = 1.0f, norm = 0.0f, freq = 1.0f;
+        for (u32 o = 0; o < octaves; ++o)
+        {
+            noise_accumulate<N>(type, coords, count, seed + o, freq, amp, true, out);
+            norm += amp;
+            amp *= gain;
+            freq *= lacunarity;
+        }
+
+        f32 rn = norm != 0.0f ? 1.0f / norm : 0.0f;
+        for (size_t i = 0; i < count; ++i)
+            out[i] *= rn;
+    }
+} // namespace maths
@@ -0,0 +1,366 @@
+// occlusion.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// software occlusion culling.
+// occluder triangles are rasterised into a low resolution depth buffer stored in 8x8 pixel tiles, a min-max depth
+// hierarchy is built from it and occludee aabbs are tested against the hierarchy by their projected screen rect.
+// screen coordinates follow project_to_sc (vup, y.0 = bottom) and depth is the screen space z from project_to_sc,
+// smaller values being closer to the camera (inverse depth projections are not supported).
+// results are conservative: triangles crossing the near plane are not rasterised and aabbs crossing it are visible.
+
+namespace maths
+{
+    constexpr u32 k_occlusion_tile_size = 8;
+    constexpr f32 k_occlusion_near_w = 1e-5f;
+
+    class occlusion_buffer
+    {
+    public:
+        // width and height are in pixels and are rounded up to a multiple of the tile size
+        void init(u32 width, u32 height)
+        {
+            _width = width;
+            _height = height;
+            _tiles_x = (width + k_occlusion_tile_size - 1) / k_occlusion_tile_size;
+            _tiles_y = (height + k_occlusion_tile_size - 1) / k_occlusion_tile_size;
+            _depth.resize((size_t)_tiles_x * _tiles_y * k_occlusion_tile_size * k_occlusion_tile_size);
+            clear();
+        }
+
+        // resets all depths to the far plane
+        void clear()
+        {
+            std::fill(_depth.begin(), _depth.end(), 1.0f);
+            _levels.clear();
+        }
+
+        void set_view_projection(const mat4& view_projection)
+        {
+            _view_projection = view_projection;
+        }
+
+        // rasterise indexed occluder triangles with vertices in world space
+        void rasterise_occluders(const vec3f* vertices, size_t vertex_count, const u32* indices, size_t index_count)
+        {
+            _clip.resize(vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i)
+                _clip[i] = _view_projection.transform_vector(vec4f(vertices[i], 1.0f));
+
+            for (size_t i = 0; i + 2 < index_count; i += 3)
+                rasterise_triangle(_clip[indices[i]], _clip[indices[i + 1]], _clip[indices[i + 2]]);
+        }
+
+        // rasterise non indexed occluder triangles with vertices in world space
+        void rasterise_occluders(const vec3f* vertices, size_t vertex_count)
+        {
+            for (size_t i = 0; i + 2 < vertex_count; i += 3)
+            {
+                vec4f v0 = _view_projection.transform_vector(vec4f(vertices[i], 1.0f));
+                vec4f v1 = _view_projection.transform_vector(vec4f(vertices[i + 1], 1.0f));
+                vec4f v2 = _view_projection.transform_vector(vec4f(vertices[i + 2], 1.0f));
+                rasterise_triangle(v0, v1, v2);
+            }
+        }
+
+        // builds the min-max depth hierarchy, call after all occluders have been rasterised and before testing
+        void build_hierarchy()
+        {
+            _levels.clear();
+
+            // each level halves the resolution of the one below, starting from the depth buffer
+            u32 w = _width, h = _height;
+            while (w > 1 || h > 1)
+            {
+                u32 cw = w, ch = h;
+                w = (w + 1) / 2;
+                h = (h + 1) / 2;
+
+                level l;
+                l.width = w;
+                l.height = h;
+                l.min_z.resize((size_t)w * h);
+                l.max_z.resize((size_t)w * h);
+
+                for (u32 y = 0; y < h; ++y)
+                {
+                    for (u32 x = 0; x < w; ++x)
+                    {
+                        f32 zmin = FLT_MAX, zmax = -FLT_MAX;
+                        for (u32 j = 0; j < 2; ++j)
+                        {
+                            for (u32 i = 0; i < 2; ++i)
+                            {
+                                u32 cx = x * 2 + i, cy = y * 2 + j;
+                                if (cx >= cw || cy >= ch)
+                                    continue;
+
+                                f32 cmin, cmax;
+                                texel(_levels.size(), cx, cy, cmin, cmax);
+                                zmin = min(zmin, cmin);
+                                zmax = max(zmax, cmax);
+                            }
+                        }
+                        l.min_z[(size_t)y * w + x] = zmin;
+                        l.max_z[(size_t)y * w + x] = zmax;
+                    }
+                }
+
+                _levels.push_back(l);
+            }
+        }
+
+        // returns the depth of pixel x, y after rasterisation
+        f32 depth(u32 x, u32 y) const
+        {
+            return _depth[pixel_index(x, y)];
+        }
+
+        // returns true if the aabb might be visible, false if it is completely hidden by occluders or off screen
+        bool is_visible(const vec3f& aabb_min, const vec3f& aabb_max) const
+        {
+            f32 rect[4];
+            f32 zmin;
+            if (!project_aabb(aabb_min, aabb_max, rect, zmin))
+                return true;
+
+            // clip rect to the screen
+            if (rect[2] < 0.0f || rect[3] < 0.0f || rect[0] >= (f32)_width || rect[1] >= (f32)_height)
+                return false;
+
+            u32 pixels[4] = {
+                (u32)max(rect[0], 0.0f),
+                (u32)max(rect[1], 0.0f),
+                (u32)min(rect[2], (f32)(_width - 1)),
+                (u32)min(rect[3], (f32)(_height - 1))
+            };
+
+            // start at the level where the rect covers roughly 2x2 texels and refine from there
+            u32 extent = max(pixels[2] - pixels[0], pixels[3] - pixels[1]);
+            size_t level = 0;
+            while (level < _levels.size() && (extent >> level) > 1)
+                ++level;
+
+            return test_region(level, pixels, zmin);
+        }
+
+        // batch version of is_visible
+        void is_visible(const vec3f* aabb_min, const vec3f* aabb_max, size_t count, bool* visible_out) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                visible_out[i] = is_visible(aabb_min[i], aabb_max[i]);
+        }
+
+        u32 width() const
+        {
+            return _width;
+        }
+
+        u32 height() const
+        {
+            return _height;
+        }
+
+    private:
+        struct level
+        {
+            u32              width;
+            u32              height;
+            std::vector<f32> min_z;
+            std::vector<f32> max_z;
+        };
+
+        size_t pixel_index(u32 x, u32 y) const
+        {
+            u32 tx = x / k_occlusion_tile_size, ty = y / k_occlusion_tile_size;
+            u32 px = x % k_occlusion_tile_size, py = y % k_occlusion_tile_size;
+            size_t tile = (size_t)ty * _tiles_x + tx;
+            return tile * k_occlusion_tile_size * k_occlusion_tile_size + py * k_occlusion_tile_size + px;
+        }
+
+        // level 0 is the depth buffer, level n is _levels[n - 1]
+        void texel(size_t lvl, u32 x, u32 y, f32& zmin, f32& zmax) const
+        {
+            if (lvl == 0)
+            {
+                zmin = zmax = _depth[pixel_index(x, y)];
+                return;
+            }
+
+            const level& l = _levels[lvl - 1];
+            zmin = l.min_z[(size_t)y * l.width + x];
+            zmax = l.max_z[(size_t)y * l.width + x];
+        }
+
+        // returns true if anything at depth zmin could be visible in the part of texel x, y covered by the pixel rect
+        bool test_texel(size_t lvl, u32 x, u32 y, const u32* rect, f32 zmin) const
+        {
+            f32 tmin, tmax;
+            texel(lvl, x, y, tmin, tmax);
+
+            // behind everything in this texel
+            if (zmin > tmax)
+                return false;
+
+            // in front of everything in this texel
+            if (zmin <= tmin || lvl == 0)
+                return true;
+
+            // ambiguous, refine the children covered by the rect at the next level down
+            size_t cl = lvl - 1;
+            u32 cx0 = max(x * 2, rect[0] >> cl), cx1 = min(x * 2 + 1, rect[2] >> cl);
+            u32 cy0 = max(y * 2, rect[1] >> cl), cy1 = min(y * 2 + 1, rect[3] >> cl);
+            for (u32 cy = cy0; cy <= cy1; ++cy)
+                for (u32 cx = cx0; cx <= cx1; ++cx)
+                    if (test_texel(cl, cx, cy, rect, zmin))
+                        return true;
+
+            return false;
+        }
+
+        // returns true if anything at depth zmin could be visible inside the pixel rect (x0, y0, x1, y1 inclusive)
+        bool test_region(size_t lvl, const u32* rect, f32 zmin) const
+        {
+            for (u32 y = rect[1] >> lvl; y <= (rect[3] >> lvl); ++y)
+                for (u32 x = rect[0] >> lvl; x <= (rect[2] >> lvl); ++x)
+                    if (test_texel(lvl, x, y, rect, zmin))
+                        return true;
+
+            return false;
+        }
+
+        // projects the corners of an aabb to screen space, returns false if the aabb crosses the near plane
+        bool project_aabb(const vec3f& aabb_min, const vec3f& aabb_max, f32* rect, f32& zmin) const
+        {
+            rect[0] = rect[1] = FLT_MAX;
+            rect[2] = rect[3] = -FLT_MAX;
+            zmin = FLT_MAX;
+
+            for (u32 i = 0; i < 8; ++i)
+            {
+                vec3f c = vec3f(i & 1 ? aabb_max.x : aabb_min.x, i & 2 ? aabb_max.y : aabb_min.y, i & 4 ? aabb_max.z : aabb_min.z);
+                vec4f p = _view_projection.transform_vector(vec4f(c, 1.0f));
+                if (p.w <= k_occlusion_near_w)
+                    return false;
+
+                vec3f sc = to_screen(p);
+                rect[0] = min(rect[0], sc.x);
+                rect[1] = min(rect[1], sc.y);
+                rect[2] = max(rect[2], sc.x);
+                rect[3] = max(rect[3], sc.y);
+                zmin = min(zmin, sc.z);
+            }
+
+            return true;
+        }
+
+        // same mapping as project_to_sc
+        vec3f to_screen(const vec4f& clip) const
+        {
+            f32 rw = 1.0f / clip.w;
+            return vec3f((clip.x * rw * 0.5f + 0.5f) * (f32)_width, (clip.y * rw * 0.5f + 0.5f) * (f32)_height,
+                         clip.z * rw * 0.5f + 0.5f);
+        }
+
+        void rasterise_triangle(const vec4f& c0, const vec4f& c1, const vec4f& c2)
+        {
+            // skip triangles crossing the near plane, not drawing an occluder is always conservative
+            if (c0.w <= k_occlusion_near_w || c1.w <= k_occlusion_near_w || c2.w <= k_occlusion_near_w)
+                return;
+
+            vec3f v0 = to_screen(c0);
+            vec3f v1 = to_screen(c1);
+            vec3f v2 = to_screen(c2);
+
+            f32 area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+            if (area == 0.0f)
+                return;
+
+            // occluders are double sided
+            if (area < 0.0f)
+            {
+                std::swap(v1, v2);
+                area = -area;
+            }
+
+            f32 xmin = max(min(v0.x, v1.x, v2.x), 0.0f);
+            f32 ymin = max(min(v0.y, v1.y, v2.y), 0.0f);
+            f32 xmax = min(max(v0.x, v1.x, v2.x), (f32)_width - 1.0f);
+            f32 ymax = min(max(v0.y, v1.y, v2.y), (f32)_height - 1.0f);
+            if (xmin > xmax || ymin > ymax)
+                return;
+
+            // edge functions e(x, y) = a * x + b * y + c, positive inside
+            f32 ea[3], eb[3], ec[3];
+            const vec3f* v[3] = {&v0, &v1, &v2};
+            for (u32 e = 0; e < 3; ++e)
+            {
+                const vec3f& a = *v[(e + 1) % 3];
+                const vec3f& b = *v[(e + 2) % 3];
+                ea[e] = a.y - b.y;
+                eb[e] = b.x - a.x;
+                ec[e] = a.x * b.y - a.y * b.x;
+            }
+
+            // depth plane, z(x, y) = za * x + zb * y + zc
+            f32 rarea = 1.0f / area;
+            f32 za = (ea[0] * v0.z + ea[1] * v1.z + ea[2] * v2.z) * rarea;
+            f32 zb = (eb[0] * v0.z + eb[1] * v1.z + eb[2] * v2.z) * rarea;
+            f32 zc = (ec[0] * v0.z + ec[1] * v1.z + ec[2] * v2.z) * rarea;
+
+            const u32 ts = k_occlusion_tile_size;
+            u32 tx0 = (u32)xmin / ts, tx1 = (u32)xmax / ts;
+            u32 ty0 = (u32)ymin / ts, ty1 = (u32)ymax / ts;
+
+            for (u32 ty = ty0; ty <= ty1; ++ty)
+            {
+                for (u32 tx = tx0; tx <= tx1; ++tx)
+                {
+                    // trivially reject tiles entirely outside one of the edges
+                    f32 cx0 = (f32)(tx * ts), cy0 = (f32)(ty * ts);
+                    f32 cx1 = cx0 + (f32)ts, cy1 = cy0 + (f32)ts;
+                    bool outside = false;
+                    for (u32 e = 0; e < 3; ++e)
+                    {
+                        f32 best = ea[e] * (ea[e] > 0.0f ? cx1 : cx0) + eb[e] * (eb[e] > 0.0f ? cy1 : cy0) + ec[e];
+                        outside |= best < 0.0f;
+                    }
+                    if (outside)
+                        continue;
+
+                    f32* tile = &_depth[((size_t)ty * _tiles_x + tx) * ts * ts];
+                    for (u32 py = 0; py < ts; ++py)
+                    {
+                        f32 fy = cy0 + (f32)py + 0.5f;
+                        for (u32 px = 0; px < ts; ++px)
+                        {
+                            f32 fx = cx0 + (f32)px + 0.5f;
+                            f32 e0 = ea[0] * fx + eb[0] * fy + ec[0];
+                            f32 e1 = ea[1] * fx + eb[1] * fy + ec[1];
+                            f32 e2 = ea[2] * fx + eb[2] * fy + ec[2];
+                            f32 z = za * fx + zb * fy + zc;
+                            f32& d = tile[py * ts + px];
+                            bool inside = e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f && z >= 0.0f;
+                            d = inside && z < d ? z : d;
+                        }
+                    }
+                }
+            }
+        }
+
+        u32                _width = 0;
+        u32                _height = 0;
+        u32                _tiles_x = 0;
+        u32                _tiles_y = 0;
+        mat4               _view_projection = mat4::create_identity();
+        std::vector<f32>   _depth;
+        std::vector<level> _levels;
+        std::vector<vec4f> _clip;
+    };
+} // namespace maths
@@ -0,0 +1,398 @@
+// octree.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// loose octree of object aabbs for scenes where objects move every frame.
+// each node's bounds are its cell grown to twice the size, so an object is stored in the deepest cell at least as big
+// as the object which contains its centre, found directly from its size and position. moving an object only touches
+// the tree when its centre leaves the cell, most updates just overwrite the stored bounds.
+// nodes and objects live in pooled arrays with free lists, nodes are created on demand and recycled once empty.
+// queries accept whole subtrees without per object tests when a node's loose bounds are fully inside the query volume.
+
+namespace maths
+{
+    constexpr u32 k_octree_default_depth = 8;
+    constexpr u32 k_octree_max_depth = 16;
+    constexpr u32 k_octree_invalid = 0xffffffff;
+
+    class loose_octree
+    {
+    public:
+        // the tree covers the cube centre +/- half_size, objects outside it are kept in a list which is always tested
+        void init(const vec3f& centre, f32 half_size, u32 max_depth = k_octree_default_depth)
+        {
+            _max_depth = min(max_depth, k_octree_max_depth);
+            _nodes.clear();
+            _objects.clear();
+            _free_node = k_octree_invalid;
+            _free_object = k_octree_invalid;
+            _outside = k_octree_invalid;
+            _count = 0;
+            alloc_node(centre, half_size, k_octree_invalid, 0);
+        }
+
+        // returns a handle used to update or remove the object
+        u32 insert(const vec3f& aabb_min, const vec3f& aabb_max)
+        {
+            u32 handle;
+            if (_free_object != k_octree_invalid)
+            {
+                handle = _free_object;
+                _free_object = _objects[handle].next;
+            }
+            else
+            {
+                handle = (u32)_objects.size();
+                _objects.push_back(object());
+            }
+
+            object& o = _objects[handle];
+            o.aabb_min = aabb_min;
+            o.aabb_max = aabb_max;
+            link(handle, find_node(aabb_min, aabb_max));
+            ++_count;
+            return handle;
+        }
+
+        // moves an object to new bounds, the object stays in its node if the node still fits it
+        void update(u32 handle, const vec3f& aabb_min, const vec3f& aabb_max)
+        {
+            object& o = _objects[handle];
+            o.aabb_min = aabb_min;
+            o.aabb_max = aabb_max;
+
+            if (o.node != k_octree_invalid && fits(o.node, aabb_min, aabb_max))
+                return;
+
+            // unlink first so nodes freed on the way out are not the ones the object moves into
+            unlink(handle);
+            link(handle, find_node(aabb_min, aabb_max));
+        }
+
+        void remove(u32 handle)
+        {
+            unlink(handle);
+            object& o = _objects[handle];
+            o.node = k_removed;
+            o.next = _free_object;
+            _free_object = handle;
+            --_count;
+        }
+
+        size_t size() const
+        {
+            return _count;
+        }
+
+        // nodes currently allocated, including the root
+        size_t node_count() const
+        {
+            size_t free_count = 0;
+            for (u32 n = _free_node; n != k_octree_invalid; n = _nodes[n].parent)
+                ++free_count;
+            return _nodes.size() - free_count;
+        }
+
+        void get_aabb(u32 handle, vec3f& aabb_min, vec3f& aabb_max) const
+        {
+            aabb_min = _objects[handle].aabb_min;
+            aabb_max = _objects[handle].aabb_max;
+        }
+
+        // appends handles of objects inside or intersecting the frustum defined by 6 planes, see aabb_vs_frustum
+        void query_frustum(const vec4f* planes, std::vector<u32>& handles_out) const
+        {
+            vec4f p[6];
+            for (u32 i = 0; i < 6; ++i)
+                p[i] = planes[i];
+
+            query(
+                [&p](const vec3f& centre, const vec3f& extent) -> u32 {
+                    // bounding sphere first as it is cheaper than the box
+                    if (!sphere_vs_frustum(centre, mag(extent), p))
+                        return k_outside;
+
+                    if (!aabb_vs_frustum(centre, extent, p))
+                        return k_outside;
+
+                    for (u32 i = 0; i < 6; ++i)
+                    {
+                        f32 d = dot(centre, p[i].xyz) + dot(extent, fabs(p[i].xyz)) + p[i].w;
+                        if (d > 0.0f)
+                            return k_intersect;
+                    }
+                    return k_inside;
+                },
+                [&p](const vec3f& aabb_min, const vec3f& aabb_max) {
+                    return aabb_vs_frustum((aabb_min + aabb_max) * 0.5f, (aabb_max - aabb_min) * 0.5f, p);
+                },
+                handles_out);
+        }
+
+        // appends handles of objects overlapping the box
+        void query_aabb(const vec3f& query_min, const vec3f& query_max, std::vector<u32>& handles_out) const
+        {
+            query(
+                [&](const vec3f& centre, const vec3f& extent) -> u32 {
+                    vec3f nmin = centre - extent;
+                    vec3f nmax = centre + extent;
+                    if (!aabb_vs_aabb(nmin, nmax, query_min, query_max))
+                        return k_outside;
+
+                    for (u32 i = 0; i < 3; ++i)
+                        if (nmin[i] < query_min[i] || nmax[i] > query_max[i])
+                            return k_intersect;
+
+                    return k_inside;
+                },
+                [&](const vec3f& aabb_min, const vec3f& aabb_max) {
+                    return aabb_vs_aabb(aabb_min, aabb_max, query_min, query_max);
+                },
+                handles_out);
+        }
+
+        // appends handles of objects hit by the ray with origin r1 and direction rv, in no particular order
+        void query_ray(const vec3f& r1, const vec3f& rv, std::vector<u32>& handles_out) const
+        {
+            query(
+                [&](const vec3f& centre, const vec3f& extent) -> u32 {
+                    vec3f ip;
+                    return ray_vs_aabb(centre - extent, centre + extent, r1, rv, ip) ? k_intersect : k_outside;
+                },
+                [&](const vec3f& aabb_min, const vec3f& aabb_max) {
+                    vec3f ip;
+                    return ray_vs_aabb(aabb_min, aabb_max, r1, rv, ip);
+                },
+                handles_out);
+        }
+
+    private:
+        enum : u32
+        {
+            k_outside = 0,
+            k_intersect = 1,
+            k_inside = 2,
+            k_outside_node = 0xfffffffe, // objects in the outside list
+            k_removed = 0xfffffffd
+        };
+
+        struct node
+        {
+            vec3f centre;
+            f32   half;   // half size of the cell, the loose bounds are twice this
+            u32   parent; // next free node when in the free list
+            u32   children[8];
+            u32   first;  // first object in this node
+            u32   count;  // objects in this node and below
+            u32   depth;
+        };
+
+        struct object
+        {
+            vec3f aabb_min;
+            vec3f aabb_max;
+            u32   node = k_octree_invalid;
+            u32   prev = k_octree_invalid;
+            u32   next = k_octree_invalid; // next free object when removed
+        };
+
+        u32 alloc_node(const vec3f& centre, f32 half, u32 parent, u32 depth)
+        {
+            u32 index;
+            if (_free_node != k_octree_invalid)
+            {
+                index = _free_node;
+                _free_node = _nodes[index].parent;
+            }
+            else
+            {
+                index = (u32)_nodes.size();
+                _nodes.push_back(node());
+            }
+
+            node& n = _nodes[index];
+            n.centre = centre;
+            n.half = half;
+            n.parent = parent;
+            for (u32 i = 0; i < 8; ++i)
+                n.children[i] = k_octree_invalid;
+            n.first = k_octree_invalid;
+            n.count = 0;
+            n.depth = depth;
+            return index;
+        }
+
+        // true if the object belongs in node: it is no bigger than the cell, not small enough for a child cell and
+        // its centre is inside the cell
+        bool fits(u32 ni, const vec3f& aabb_min, const vec3f& aabb_max) const
+        {
+            if (ni == k_outside_node)
+                return false;
+
+            const node& n = _nodes[ni];
+            vec3f       extent = (aabb_max - aabb_min) * 0.5f;
+            vec3f       centre = (aabb_min + aabb_max) * 0.5f;
+            f32         e = max(extent.x, extent.y, extent.z);
+            if (e > n.half || (n.depth < _max_depth && e <= n.half * 0.5f))
+                return false;
+
+            vec3f d = abs(centre - n.centre);
+            return max(d.x, d.y, d.z) <= n.half;
+        }
+
+        // walks from the root to the deepest cell which fits the object, creating nodes on the way
+        u32 find_node(const vec3f& aabb_min, const vec3f& aabb_max)
+        {
+            vec3f extent = (aabb_max - aabb_min) * 0.5f;
+            vec3f centre = (aabb_min + aabb_max) * 0.5f;
+            f32   e = max(extent.x, extent.y, extent.z);
+
+            const node& root = _nodes[0];
+            vec3f       d = abs(centre - root.centre);
+            if (e > root.half || max(d.x, d.y, d.z) > root.half)
+                return k_outside_node;
+
+            u32 ni = 0;
+            while (_nodes[ni].depth < _max_depth && e <= _nodes[ni].half * 0.5f)
+            {
+                const node& n = _nodes[ni];
+                u32         ci = (centre.x >= n.centre.x ? 1 : 0) | (centre.y >= n.centre.y ? 2 : 0) |
+                         (centre.z >= n.centre.z ? 4 : 0);
+
+                u32 child = n.children[ci];
+                if (child == k_octree_invalid)
+                {
+                    f32   h = n.half * 0.5f;
+                    vec3f c = n.centre + vec3f(ci & 1 ? h : -h, ci & 2 ? h : -h, ci & 4 ? h : -h);
+                    u32   depth = n.depth + 1;
+                    child = alloc_node(c, h, ni, depth); // may reallocate _nodes
+                    _nodes[ni].children[ci] = child;
+                }
+                ni = child;
+            }
+            return ni;
+        }
+
+        void link(u32 handle, u32 ni)
+        {
+            object& o = _objects[handle];
+            o.node = ni;
+            o.prev = k_octree_invalid;
+
+            u32& head = ni == k_outside_node ? _outside : _nodes[ni].first;
+            o.next = head;
+            if (head != k_octree_invalid)
+                _objects[head].prev = handle;
+            head = handle;
+
+            if (ni == k_outside_node)
+                return;
+
+            for (u32 n = ni; n != k_octree_invalid; n = _nodes[n].parent)
+                _nodes[n].count++;
+        }
+
+        void unlink(u32 handle)
+        {
+            object& o = _objects[handle];
+            u32     ni = o.node;
+
+            u32& head = ni == k_outside_node ? _outside : _nodes[ni].first;
+            if (o.prev != k_octree_invalid)
+                _objects[o.prev].next = o.next;
+            else
+                head = o.next;
+            if (o.next != k_octree_invalid)
+                _objects[o.next].prev = o.prev;
+
+            o.node = k_octree_invalid;
+            if (ni == k_outside_node)
+                return;
+
+            // empty nodes below the root go back to the pool
+            for (u32 n = ni; n != k_octree_invalid;)
+            {
+                u32 parent = _nodes[n].parent;
+                if (--_nodes[n].count == 0 && parent != k_octree_invalid)
+                {
+                    for (u32 i = 0; i < 8; ++i)
+                        if (_nodes[parent].children[i] == n)
+                            _nodes[parent].children[i] = k_octree_invalid;
+
+                    _nodes[n].parent = _free_node;
+                    _free_node = n;
+                }
+                n = parent;
+            }
+        }
+
+        void append_objects(u32 first, std::vector<u32>& handles_out) const
+        {
+            for (u32 o = first; o != k_octree_invalid; o = _objects[o].next)
+                handles_out.push_back(o);
+        }
+
+        void append_subtree(u32 ni, std::vector<u32>& handles_out) const
+        {
+            const node& n = _nodes[ni];
+            append_objects(n.first, handles_out);
+            for (u32 i = 0; i < 8; ++i)
+                if (n.children[i] != k_octree_invalid)
+                    append_subtree(n.children[i], handles_out);
+        }
+
+        // node_test(centre, loose_extent) classifies nodes as k_outside, k_intersect or k_inside,
+        // object_test(aabb_min, aabb_max) is only called for objects in intersecting nodes
+        template <class NodeTest, class ObjectTest>
+        void query(NodeTest node_test, ObjectTest object_test, std::vector<u32>& handles_out) const
+        {
+            for (u32 o = _outside; o != k_octree_invalid; o = _objects[o].next)
+                if (object_test(_objects[o].aabb_min, _objects[o].aabb_max))
+                    handles_out.push_back(o);
+
+            if (_nodes.empty() || _nodes[0].count == 0)
+                return;
+
+            u32 stack[k_octree_max_depth * 7 + 1];
+            u32 sp = 0;
+            stack[sp++] = 0;
+            while (sp > 0)
+            {
+                u32         ni = stack[--sp];
+                const node& n = _nodes[ni];
+
+                u32 c = node_test(n.centre, vec3f(n.half * 2.0f));
+                if (c == k_outside)
+                    continue;
+
+                if (c == k_inside)
+                {
+                    append_subtree(ni, handles_out);
+                    continue;
+                }
+
+                for (u32 o = n.first; o != k_octree_invalid; o = _objects[o].next)
+                    if (object_test(_objects[o].aabb_min, _objects[o].aabb_max))
+                        handles_out.push_back(o);
+
+                for (u32 i = 0; i < 8; ++i)
+                    if (n.children[i] != k_octree_invalid)
+                        stack[sp++] = n.children[i];
+            }
+        }
+
+        std::vector<node>   _nodes;
+        std::vector<object> _objects;
+        u32                 _free_node = k_octree_invalid;
+        u32                 _free_object = k_octree_invalid;
+        u32                 _outside = k_octree_invalid;
+        u32                 _max_depth = k_octree_default_depth;
+        size_t              _count = 0;
+    };
+} // namespace maths
@@ -0,0 +1,531 @@
+// parallel.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// executors and parallel_for entry points for the batch functions in maths.h
+// work is always split into fixed size chunks which depend only on the element count and chunk size, never on the
+// number of threads, so results (including per chunk reductions combined in chunk order) are reproducible.
+
+namespace maths
+{
+    constexpr size_t k_parallel_chunk_size = 4096;
+    constexpr size_t k_parallel_radix_chunk_size = 65536; // larger chunks keep the per chunk histograms small
+
+    // pluggable executor interface, run must invoke task(i) exactly once for every i in [0, num_tasks)
+    // and only return once all tasks have completed. tasks may execute in any order and on any thread.
+    class executor
+    {
+    public:
+        virtual ~executor()
+        {
+        }
+
+        virtual void   run(size_t num_tasks, const std::function<void(size_t)>& task) = 0;
+        virtual size_t num_threads() const = 0;
+    };
+
+    // runs all tasks in order on the calling thread
+    class serial_executor : public executor
+    {
+    public:
+        void run(size_t num_tasks, const std::function<void(size_t)>& task) override
+        {
+            for (size_t i = 0; i < num_tasks; ++i)
+                task(i);
+        }
+
+        size_t num_threads() const override
+        {
+            return 1;
+        }
+    };
+
+    // fixed size pool of worker threads, the calling thread also takes part in run.
+    // idle threads claim the next unstarted task from a shared atomic counter so uneven tasks balance themselves out.
+    // run called from inside one of the pool's own tasks (or concurrently from another thread while busy) executes
+    // serially instead of deadlocking, tasks of a different pool can still run it in parallel. if tasks throw, the
+    // remaining unstarted tasks are skipped and the first exception is rethrown from run once the workers have stopped.
+    class thread_pool : public executor
+    {
+    public:
+        // num_threads includes the calling thread, 0 = std::thread::hardware_concurrency
+        explicit thread_pool(size_t num_threads = 0)
+        {
+            if (num_threads == 0)
+                num_threads = max<size_t>(std::thread::hardware_concurrency(), 1);
+
+            for (size_t i = 1; i < num_threads; ++i)
+                _workers.push_back(std::thread(&thread_pool::worker_loop, this));
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _quit = true;
+            }
+            _wake.notify_all();
+
+            for (auto& t : _workers)
+                t.join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        void run(size_t num_tasks, const std::function<void(size_t)>& task) override
+        {
+            if (num_tasks == 0)
+                return;
+
+            // a nested run from one of this pool's tasks must not touch _run_mutex, which may be held by this thread
+            if (executing_on_this_thread() || num_tasks == 1 || _workers.empty())
+            {
+                run_serial(num_tasks, task);
+                return;
+            }
+
+            std::unique_lock<std::mutex> busy(_run_mutex, std::try_to_lock);
+            if (!busy.owns_lock())
+            {
+                run_serial(num_tasks, task);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _task = &task;
+                _num_tasks = num_tasks;
+                _next.store(0);
+                _active = _workers.size();
+                ++_generation;
+            }
+            _wake.notify_all();
+
+            {
+                run_frame frame(this);
+                execute();
+            }
+
+            // wait for the workers even if a task threw, task must outlive every call to it
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _done.wait(lock, [this] { return _active == 0; });
+                _task = nullptr;
+                error = _error;
+                _error = nullptr;
+            }
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        size_t num_threads() const override
+        {
+            return _workers.size() + 1;
+        }
+
+    private:
+        // pools whose tasks the current thread is executing, innermost first. workers hold a frame for their own pool
+        // for their whole lifetime, the calling thread of run holds one while it executes tasks.
+        struct run_frame
+        {
+            const thread_pool* pool;
+            run_frame*         prev;
+
+            explicit run_frame(const thread_pool* p) : pool(p), prev(current())
+            {
+                current() = this;
+            }
+
+            ~run_frame()
+            {
+                current() = prev;
+            }
+
+            run_frame(const run_frame&) = delete;
+            run_frame& operator=(const run_frame&) = delete;
+
+            static run_frame*& current()
+            {
+                static thread_local run_frame* frame = nullptr;
+                return frame;
+            }
+        };
+
+        bool executing_on_this_thread() const
+        {
+            for (const run_frame* f = run_frame::current(); f; f = f->prev)
+                if (f->pool == this)
+                    return true;
+            return false;
+        }
+
+        static void run_serial(size_t num_tasks, const std::function<void(size_t)>& task)
+        {
+            for (size_t i = 0; i < num_tasks; ++i)
+                task(i);
+        }
+
+        void execute()
+        {
+            for (;;)
+            {
+                size_t i = _next.fetch_add(1);
+                if (i >= _num_tasks)
+                    break;
+
+                try
+                {
+                    (*_task)(i);
+                }
+                catch (...)
+                {
+                    // keep the first exception and skip the tasks nobody has claimed yet
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (!_error)
+                        _error = std::current_exception();
+                    _next.store(_num_tasks);
+                }
+            }
+        }
+
+        void worker_loop()
+        {
+            run_frame frame(this);
+            u64       generation = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [&] { return _quit || _generation != generation; });
+                    if (_quit)
+                        return;
+                    generation = _generation;
+                }
+
+                execute();
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    --_active;
+                }
+                _done.notify_one();
+            }
+        }
+
+        std::vector<std::thread>           _workers;
+        std::mutex                         _mutex;
+        std::mutex                         _run_mutex;
+        std::condition_variable            _wake;
+        std::condition_variable            _done;
+        const std::function<void(size_t)>* _task = nullptr;
+        size_t                             _num_tasks = 0;
+        std::atomic<size_t>                _next{0};
+        size_t                             _active = 0;
+        std::exception_ptr                 _error;
+        u64                                _generation = 0;
+        bool                               _quit = false;
+    };
+
+    // returns a process wide thread pool using all hardware threads, created on first use
+    inline thread_pool& get_default_thread_pool()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    // returns the number of chunks parallel_for splits count elements into
+    maths_inline size_t parallel_chunk_count(size_t count, size_t chunk_size)
+    {
+        return (count + chunk_size - 1) / chunk_size;
+    }
+
+    // calls func(begin, end) for consecutive ranges of chunk_size elements covering [0, count)
+    // chunk c always covers [c * chunk_size, min((c + 1) * chunk_size, count)) regardless of the executor
+    inline void parallel_for(executor& exec, size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& func)
+    {
+        chunk_size = max<size_t>(chunk_size, 1);
+        size_t num_chunks = parallel_chunk_count(count, chunk_size);
+        exec.run(num_chunks, [&](size_t c) {
+            size_t begin = c * chunk_size;
+            size_t end = min(begin + chunk_size, count);
+            func(begin, end);
+        });
+    }
+
+    inline void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& func)
+    {
+        parallel_for(get_default_thread_pool(), count, chunk_size, func);
+    }
+
+    //
+    // parallel batch functions, see the batch versions in maths.h for details
+    //
+
+    inline void aabb_vs_frustum(executor& exec, const vec3f* aabb_pos, const vec3f* aabb_extent, size_t count,
+                                const vec4f* planes, bool* inside_out, size_t chunk_size = k_parallel_chunk_size)
+    {
+        parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+            aabb_vs_frustum(aabb_pos + begin, aabb_extent + begin, end - begin, planes, inside_out + begin);
+        });
+    }
+
+    inline void sphere_vs_frustum(executor& exec, const vec3f* pos, const f32* radius, size_t count, const vec4f* planes,
+                                  bool* inside_out, size_t chunk_size = k_parallel_chunk_size)
+    {
+        parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+            sphere_vs_frustum(pos + begin, radius + begin, end - begin, planes, inside_out + begin);
+        });
+    }
+
+    inline void transform_points(executor& exec, const mat4& mat, const vec3f* points, size_t count, vec3f* points_out,
+                                 size_t chunk_size = k_parallel_chunk_size)
+    {
+        parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+            transform_points(mat, points + begin, end - begin, points_out + begin);
+        });
+    }
+
+    inline void point_inside_poly(executor& exec, const vec2f* points, size_t count, const std::vector<vec2f>& poly,
+                                  bool* inside_out, size_t chunk_size = k_parallel_chunk_size)
+    {
+        parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+            point_inside_poly(points + begin, end - begin, poly, inside_out + begin);
+        });
+    }
+
+    //
+    // convex hull
+    //
+
+    // andrew's monotone chain, sorts points in place and writes the hull into hull_out with the same winding as
+    // convex_hull_from_points, collinear points on the hull edges are discarded
+    inline void convex_hull_monotone_chain(std::vector<vec2f>& points, std::vector<vec2f>& hull_out)
+    {
+        hull_out.clear();
+        size_t n = points.size();
+        if (n < 3)
+        {
+            hull_out = points;
+            return;
+        }
+
+        std::sort(points.begin(), points.end(), [](const vec2f& a, const vec2f& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+
+        hull_out.resize(2 * n);
+        size_t k = 0;
+
+        // lower
+        for (size_t i = 0; i < n; ++i)
+        {
+            while (k >= 2 && cross(hull_out[k - 1] - hull_out[k - 2], points[i] - hull_out[k - 2]) <= 0.0f)
+                --k;
+            hull_out[k++] = points[i];
+        }
+
+        // upper
+        for (size_t i = n - 1, t = k + 1; i > 0; --i)
+        {
+            while (k >= t && cross(hull_out[k - 1] - hull_out[k - 2], points[i - 1] - hull_out[k - 2]) <= 0.0f)
+                --k;
+            hull_out[k++] = points[i - 1];
+        }
+
+        // last point is the same as the first
+        hull_out.resize(k - 1);
+    }
+
+    // parallel convex hull for large point sets, output has the same winding as convex_hull_from_points.
+    // 1. the 8 extreme points in x, y, x + y and x - y are found and points strictly inside the polygon they form are
+    //    discarded (akl-toussaint heuristic), which typically removes almost all of the input.
+    // 2. the survivors of each chunk are hulled independently.
+    // 3. the chunk hulls are merged with a final hull pass.
+    inline void convex_hull_from_points(executor& exec, std::vector<vec2f>& hull, const std::vector<vec2f>& points,
+                                        size_t chunk_size = k_parallel_chunk_size * 16)
+    {
+        hull.clear();
+        size_t n = points.size();
+        if (n == 0)
+            return;
+
+        // extremes: min x, max x, min y, max y, min x+y, max x+y, min x-y, max x-y
+        static const size_t k_extremes = 8;
+        size_t num_chunks = parallel_chunk_count(n, chunk_size);
+        std::vector<size_t> chunk_extremes(num_chunks * k_extremes);
+
+        parallel_for(exec, n, chunk_size, [&](size_t begin, size_t end) {
+            size_t* e = &chunk_extremes[(begin / chunk_size) * k_extremes];
+            f32 best[k_extremes];
+            for (size_t j = 0; j < k_extremes; ++j)
+            {
+                e[j] = begin;
+                best[j] = -FLT_MAX;
+            }
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const vec2f& p = points[i];
+                f32 keys[k_extremes] = {-p.x, p.x, -p.y, p.y, -(p.x + p.y), p.x + p.y, -(p.x - p.y), p.x - p.y};
+                for (size_t j = 0; j < k_extremes; ++j)
+                {
+                    bool better = keys[j] > best[j];
+                    best[j] = better ? keys[j] : best[j];
+                    e[j] = better ? i : e[j];
+                }
+            }
+        });
+
+        // reduce extremes in chunk order and build the culling polygon from them
+        std::vector<vec2f> cull_poly;
+        {
+            std::vector<vec2f> extreme_points;
+            for (size_t c = 0; c < num_chunks; ++c)
+                for (size_t j = 0; j < k_extremes; ++j)
+                    extreme_points.push_back(points[chunk_extremes[c * k_extremes + j]]);
+
+            convex_hull_monotone_chain(extreme_points, cull_poly);
+        }
+
+        // cull interior points and hull each chunk of survivors
+        std::vector<std::vector<vec2f>> chunk_hulls(num_chunks);
+        parallel_for(exec, n, chunk_size, [&](size_t begin, size_t end) {
+            std::vector<vec2f> survivors;
+            size_t np = cull_poly.size();
+            for (size_t i = begin; i < end; ++i)
+            {
+                const vec2f& p = points[i];
+                bool inside = np >= 3;
+                for (size_t e = 0; e < np; ++e)
+                {
+                    const vec2f& a = cull_poly[e];
+                    const vec2f& b = cull_poly[e + 1 == np ? 0 : e + 1];
+                    inside &= cross(b - a, p - a) > 0.0f;
+                }
+
+                if (!inside)
+                    survivors.push_back(p);
+            }
+
+            convex_hull_monotone_chain(survivors, chunk_hulls[begin / chunk_size]);
+        });
+
+        // merge
+        std::vector<vec2f> merged;
+        for (auto& ch : chunk_hulls)
+            merged.insert(merged.end(), ch.begin(), ch.end());
+
+        convex_hull_monotone_chain(merged, hull);
+    }
+
+    //
+    // radix sort
+    //
+
+    template <class K, class V, bool with_values>
+    inline void radix_sort_impl(executor& exec, K* keys, V* values, size_t count, K* keys_temp, V* values_temp,
+                                u32 digit_bits, size_t chunk_size)
+    {
+        if (count < 2)
+            return;
+
+        digit_bits = clamp<u32>(digit_bits, 1, 16);
+        chunk_size = max<size_t>(chunk_size, 1);
+        const u32    radix = 1u << digit_bits;
+        const u32    mask = radix - 1;
+        const u32    passes = radix_passes<K>(digit_bits);
+        const size_t num_chunks = parallel_chunk_count(count, chunk_size);
+
+        // counts and then scatter offsets per chunk, chunk c uses [c * radix, (c + 1) * radix)
+        std::vector<size_t> hist(num_chunks * radix);
+
+        K* src = keys;
+        K* dst = keys_temp;
+        V* vsrc = values;
+        V* vdst = values_temp;
+        for (u32 p = 0; p < passes; ++p)
+        {
+            u32 shift = p * digit_bits;
+            parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+                size_t* h = &hist[(begin / chunk_size) * radix];
+                std::fill(h, h + radix, 0);
+                for (size_t i = begin; i < end; ++i)
+                    h[(u32)((radix_key(src[i]) >> shift) & mask)]++;
+            });
+
+            // offsets in digit then chunk order keep the sort stable
+            size_t sum = 0;
+            bool   skip = false;
+            for (u32 d = 0; d < radix && !skip; ++d)
+            {
+                size_t start = sum;
+                for (size_t c = 0; c < num_chunks; ++c)
+                {
+                    size_t n = hist[c * radix + d];
+                    hist[c * radix + d] = sum;
+                    sum += n;
+                }
+                skip = start == 0 && sum == count;
+            }
+
+            // every key has the same digit
+            if (skip)
+                continue;
+
+            parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+                size_t* h = &hist[(begin / chunk_size) * radix];
+                for (size_t i = begin; i < end; ++i)
+                {
+                    size_t o = h[(u32)((radix_key(src[i]) >> shift) & mask)]++;
+                    dst[o] = src[i];
+                    if (with_values)
+                        vdst[o] = vsrc[i];
+                }
+            });
+
+            std::swap(src, dst);
+            std::swap(vsrc, vdst);
+        }
+
+        if (src != keys)
+        {
+            parallel_for(exec, count, chunk_size, [&](size_t begin, size_t end) {
+                std::copy(src + begin, src + end, keys + begin);
+                if (with_values)
+                    std::copy(vsrc + begin, vsrc + end, values + begin);
+            });
+        }
+    }
+
+    // parallel version of radix_sort in util.h with identical results. each pass histograms fixed size chunks in
+    // parallel, prefix sums the counts in digit then chunk order and scatters the chunks in parallel.
+    template <class K>
+    inline void radix_sort(executor& exec, K* keys, size_t count, K* keys_temp, u32 digit_bits = 8,
+                           size_t chunk_size = k_parallel_radix_chunk_size)
+    {
+        radix_sort_impl<K, K, false>(exec, keys, nullptr, count, keys_temp, nullptr, digit_bits, chunk_size);
+    }
+
+    template <class K, class V>
+    inline void radix_sort(executor& exec, K* keys, V* values, size_t count, K* keys_temp, V* values_temp,
+                           u32 digit_bits = 8, size_t chunk_size = k_parallel_radix_chunk_size)
+    {
+        radix_sort_impl<K, V, true>(exec, keys, values, count, keys_temp, values_temp, digit_bits, chunk_size);
+    }
+} // namespace maths
@@ -0,0 +1,541 @@
+// point_cloud.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "vec.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// streaming point cloud reader for ply (ascii, binary little and big endian) and xyz text files.
+// points are decoded straight into fixed size soa blocks, so downstream kernels can consume a block while the rest of
+// the file is still being read. the file is read through a single buffer allocated on open, decoding does not allocate.
+
+namespace maths
+{
+    constexpr size_t k_point_block_size = 4096;
+    constexpr size_t k_point_read_buffer_size = 1024 * 1024;
+
+    // soa block of positions
+    struct point_block
+    {
+        f32    x[k_point_block_size];
+        f32    y[k_point_block_size];
+        f32    z[k_point_block_size];
+        size_t count = 0;
+
+        vec3f get(size_t i) const
+        {
+            return vec3f(x[i], y[i], z[i]);
+        }
+    };
+
+    enum e_point_cloud_format
+    {
+        POINT_CLOUD_UNKNOWN = 0,
+        POINT_CLOUD_XYZ,
+        POINT_CLOUD_PLY_ASCII,
+        POINT_CLOUD_PLY_BINARY_LE,
+        POINT_CLOUD_PLY_BINARY_BE
+    };
+
+    class point_cloud_reader
+    {
+    public:
+        point_cloud_reader() = default;
+        point_cloud_reader(const point_cloud_reader&) = delete;
+        point_cloud_reader& operator=(const point_cloud_reader&) = delete;
+
+        ~point_cloud_reader()
+        {
+            close();
+        }
+
+        // opens filename and parses the ply header if there is one, files not starting with "ply" are read as xyz
+        bool open(const char* filename)
+        {
+            close();
+            _file = fopen(filename, "rb");
+            if (!_file)
+                return false;
+
+            _buffer.resize(k_point_read_buffer_size);
+            _head = _tail = 0;
+            _eof = false;
+            _error = false;
+            _remaining = 0;
+
+            if (!fill(3))
+            {
+                close();
+                return false;
+            }
+
+            if (_tail - _head >= 3 && strncmp(_buffer.data() + _head, "ply", 3) == 0)
+            {
+                if (!parse_ply_header())
+                {
+                    close();
+                    return false;
+                }
+            }
+            else
+            {
+                _format = POINT_CLOUD_XYZ;
+            }
+
+            return true;
+        }
+
+        void close()
+        {
+            if (_file)
+                fclose(_file);
+            _file = nullptr;
+            _format = POINT_CLOUD_UNKNOWN;
+            _vertex_count = 0;
+        }
+
+        // decodes up to k_point_block_size points into block, returns the number decoded or 0 at the end of the data
+        size_t read(point_block& block)
+        {
+            block.count = 0;
+            if (!_file || _error)
+                return 0;
+
+            switch (_format)
+            {
+                case POINT_CLOUD_XYZ:
+                    read_ascii(block, 0, 1, 2, 3, false);
+                    break;
+                case POINT_CLOUD_PLY_ASCII:
+                    read_ascii(block, _prop_xyz[0], _prop_xyz[1], _prop_xyz[2], _vertex_props.size(), true);
+                    break;
+                case POINT_CLOUD_PLY_BINARY_LE:
+                case POINT_CLOUD_PLY_BINARY_BE:
+                    read_binary(block);
+                    break;
+                default:
+                    break;
+            }
+
+            return block.count;
+        }
+
+        e_point_cloud_format format() const
+        {
+            return _format;
+        }
+
+        // number of vertices declared in the ply header, 0 for xyz files where the count is not known up front
+        u64 vertex_count() const
+        {
+            return _vertex_count;
+        }
+
+        // true if a malformed line or truncated binary data was encountered
+        bool error() const
+        {
+            return _error;
+        }
+
+    private:
+        enum e_ply_type
+        {
+            PLY_INVALID = 0,
+            PLY_S8,
+            PLY_U8,
+            PLY_S16,
+            PLY_U16,
+            PLY_S32,
+            PLY_U32,
+            PLY_F32,
+            PLY_F64
+        };
+
+        struct ply_property
+        {
+            u32 type;
+            u32 offset;
+        };
+
+        static u32 ply_type_from_string(const char* s)
+        {
+            static const struct { const char* name; u32 type; } types[] = {
+                {"char", PLY_S8},   {"int8", PLY_S8},    {"uchar", PLY_U8},  {"uint8", PLY_U8},
+                {"short", PLY_S16}, {"int16", PLY_S16},  {"ushort", PLY_U16}, {"uint16", PLY_U16},
+                {"int", PLY_S32},   {"int32", PLY_S32},  {"uint", PLY_U32},  {"uint32", PLY_U32},
+                {"float", PLY_F32}, {"float32", PLY_F32}, {"double", PLY_F64}, {"float64", PLY_F64}
+            };
+
+            for (auto& t : types)
+                if (strcmp(s, t.name) == 0)
+                    return t.type;
+
+            return PLY_INVALID;
+        }
+
+        static u32 ply_type_size(u32 type)
+        {
+            static const u32 sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+            return sizes[type];
+        }
+
+        // ensures at least n bytes are buffered if the file has them, returns false if fewer are available
+        bool fill(size_t n)
+        {
+            if (_tail - _head >= n)
+                return true;
+
+            // compact
+            size_t avail = _tail - _head;
+            if (_head > 0)
+            {
+                memmove(_buffer.data(), _buffer.data() + _head, avail);
+                _head = 0;
+                _tail = avail;
+            }
+
+            if (n > _buffer.size())
+                _buffer.resize(n);
+
+            while (!_eof && _tail < n)
+            {
+                size_t r = fread(_buffer.data() + _tail, 1, _buffer.size() - _tail, _file);
+                if (r == 0)
+                    _eof = true;
+                _tail += r;
+            }
+
+            return _tail - _head >= n;
+        }
+
+        // returns a null terminated line from the buffer, or nullptr at the end of the file
+        char* next_line()
+        {
+            for (;;)
+            {
+                char* start = _buffer.data() + _head;
+                char* nl = (char*)memchr(start, '\n', _tail - _head);
+                if (nl)
+                {
+                    *nl = '\0';
+                    _head = (size_t)(nl - _buffer.data()) + 1;
+                    return start;
+                }
+
+                if (_eof)
+                {
+                    if (_head == _tail)
+                        return nullptr;
+
+                    // last line without a newline, terminate it in place
+                    if (_tail == _buffer.size())
+                        _buffer.push_back('\0');
+                    _buffer[_tail] = '\0';
+                    start = _buffer.data() + _head;
+                    _head = _tail;
+                    return start;
+                }
+
+                // no complete line buffered, fetch more (growing if a single line exceeds the buffer)
+                size_t avail = _tail - _head;
+                fill(avail + 1 > _buffer.size() / 2 ? _buffer.size() * 2 : _buffer.size());
+            }
+        }
+
+        bool parse_ply_header()
+        {
+            bool in_vertex = false;
+            bool found_vertex = false;
+            u32  offset = 0;
+            _skip_bytes = 0;
+            _skip_lines = 0;
+            _prop_xyz[0] = _prop_xyz[1] = _prop_xyz[2] = (size_t)-1;
+            _vertex_props.clear();
+
+            char* line = next_line();
+            if (!line || strncmp(line, "ply", 3) != 0)
+                return false;
+
+            char tok[4][64];
+            while ((line = next_line()) != nullptr)
+            {
+                int n = sscanf(line, "%63s %63s %63s %63s", tok[0], tok[1], tok[2], tok[3]);
+                if (n <= 0)
+                    continue;
+
+                if (strcmp(tok[0], "format") == 0 && n >= 2)
+                {
+                    if (strcmp(tok[1], "ascii") == 0)
+                        _format = POINT_CLOUD_PLY_ASCII;
+                    else if (strcmp(tok[1], "binary_little_endian") == 0)
+                        _format = POINT_CLOUD_PLY_BINARY_LE;
+                    else if (strcmp(tok[1], "binary_big_endian") == 0)
+                        _format = POINT_CLOUD_PLY_BINARY_BE;
+                    else
+                        return false;
+                }
+                else if (strcmp(tok[0], "element") == 0 && n >= 3)
+                {
+                    if (found_vertex)
+                    {
+                        // elements after the vertices are never read
+                        in_vertex = false;
+                        continue;
+                    }
+
+                    if (in_vertex)
+                    {
+                        found_vertex = true;
+                        in_vertex = false;
+                        continue;
+                    }
+
+                    u64 count = strtoull(tok[2], nullptr, 10);
+                    if (strcmp(tok[1], "vertex") == 0)
+                    {
+                        in_vertex = true;
+                        _vertex_count = count;
+                    }
+                    else
+                    {
+                        // elements before the vertices are skipped, which needs their size
+                        _pending_skip_count = count;
+                        _skip_lines += count;
+                    }
+                }
+                else if (strcmp(tok[0], "property") == 0 && n >= 3)
+                {
+                    if (strcmp(tok[1], "list") == 0)
+                    {
+                        // variable size elements can not be skipped or strided
+                        if (in_vertex || !found_vertex)
+                            return false;
+                        continue;
+                    }
+
+                    u32 type = ply_type_from_string(tok[1]);
+                    if (type == PLY_INVALID)
+                        return false;
+
+                    if (in_vertex)
+                    {
+                        size_t index = _vertex_props.size();
+                        if (strcmp(tok[2], "x") == 0)
+                            _prop_xyz[0] = index;
+                        else if (strcmp(tok[2], "y") == 0)
+                            _prop_xyz[1] = index;
+                        else if (strcmp(tok[2], "z") == 0)
+                            _prop_xyz[2] = index;
+
+                        ply_property p = {type, offset};
+                        _vertex_props.push_back(p);
+                        offset += ply_type_size(type);
+                    }
+                    else if (!found_vertex)
+                    {
+                        _skip_bytes += _pending_skip_count * ply_type_size(type);
+                    }
+                }
+                else if (strcmp(tok[0], "end_header") == 0)
+                {
+                    break;
+                }
+            }
+
+            if (!line)
+                return false;
+
+            for (size_t i = 0; i < 3; ++i)
+                if (_prop_xyz[i] == (size_t)-1)
+                    return false;
+
+            _vertex_stride = offset;
+            _remaining = _vertex_count;
+
+            // skip any elements which come before the vertices
+            if (_format == POINT_CLOUD_PLY_ASCII)
+            {
+                for (u64 i = 0; i < _skip_lines; ++i)
+                    if (!next_line())
+                        return false;
+            }
+            else
+            {
+                u64 skip = _skip_bytes;
+                while (skip > 0)
+                {
+                    size_t chunk = (size_t)min<u64>(skip, (u64)_buffer.size());
+                    if (!fill(chunk))
+                        return false;
+                    _head += chunk;
+                    skip -= chunk;
+                }
+            }
+
+            return true;
+        }
+
+        void read_ascii(point_block& block, size_t ix, size_t iy, size_t iz, size_t num_props, bool ply)
+        {
+            size_t max_prop = max(ix, iy, iz);
+            while (block.count < k_point_block_size)
+            {
+                if (ply && _remaining == 0)
+                    return;
+
+                char* line = next_line();
+                if (!line)
+                {
+                    if (ply)
+                        _error = true;
+                    return;
+                }
+
+                // skip blank lines and comments in xyz files
+                char* p = line;
+                while (*p == ' ' || *p == '\t' || *p == '\r')
+                    ++p;
+                if (*p == '\0' || *p == '#')
+                {
+                    if (!ply)
+                        continue;
+                    _error = true;
+                    return;
+                }
+
+                f32 xyz[3] = {0.0f, 0.0f, 0.0f};
+                for (size_t prop = 0; prop <= max_prop && prop < num_props; ++prop)
+                {
+                    char* end = nullptr;
+                    f32 v = strtof(p, &end);
+                    if (end == p)
+                    {
+                        _error = true;
+                        return;
+                    }
+                    p = end;
+
+                    if (prop == ix)
+                        xyz[0] = v;
+                    else if (prop == iy)
+                        xyz[1] = v;
+                    else if (prop == iz)
+                        xyz[2] = v;
+                }
+
+                block.x[block.count] = xyz[0];
+                block.y[block.count] = xyz[1];
+                block.z[block.count] = xyz[2];
+                ++block.count;
+
+                if (ply)
+                    --_remaining;
+            }
+        }
+
+        f32 decode(const char* src, u32 type) const
+        {
+            uint8_t bytes[8];
+            u32     size = ply_type_size(type);
+            if (_format == POINT_CLOUD_PLY_BINARY_BE)
+            {
+                for (u32 i = 0; i < size; ++i)
+                    bytes[i] = (uint8_t)src[size - 1 - i];
+            }
+            else
+            {
+                memcpy(bytes, src, size);
+            }
+
+            switch (type)
+            {
+                case PLY_S8: { int8_t v; memcpy(&v, bytes, 1); return (f32)v; }
+                case PLY_U8: { uint8_t v; memcpy(&v, bytes, 1); return (f32)v; }
+                case PLY_S16: { int16_t v; memcpy(&v, bytes, 2); return (f32)v; }
+                case PLY_U16: { uint16_t v; memcpy(&v, bytes, 2); return (f32)v; }
+                case PLY_S32: { int32_t v; memcpy(&v, bytes, 4); return (f32)v; }
+                case PLY_U32: { uint32_t v; memcpy(&v, bytes, 4); return (f32)v; }
+                case PLY_F32: { f32 v; memcpy(&v, bytes, 4); return v; }
+                case PLY_F64: { f64 v; memcpy(&v, bytes, 8); return (f32)v; }
+                default: return 0.0f;
+            }
+        }
+
+        void read_binary(point_block& block)
+        {
+            const ply_property& px = _vertex_props[_prop_xyz[0]];
+            const ply_property& py = _vertex_props[_prop_xyz[1]];
+            const ply_property& pz = _vertex_props[_prop_xyz[2]];
+            const bool fast = _format == POINT_CLOUD_PLY_BINARY_LE && px.type == PLY_F32 && py.type == PLY_F32 &&
+                              pz.type == PLY_F32 && is_little_endian();
+
+            while (block.count < k_point_block_size && _remaining > 0)
+            {
+                // decode as many whole vertices as are buffered
+                if (!fill(_vertex_stride))
+                {
+                    _error = true;
+                    return;
+                }
+
+                size_t avail = (_tail - _head) / _vertex_stride;
+                size_t n = (size_t)min<u64>(min(avail, k_point_block_size - block.count), _remaining);
+                const char* src = _buffer.data() + _head;
+
+                if (fast)
+                {
+                    for (size_t i = 0; i < n; ++i, src += _vertex_stride)
+                    {
+                        memcpy(&block.x[block.count + i], src + px.offset, 4);
+                        memcpy(&block.y[block.count + i], src + py.offset, 4);
+                        memcpy(&block.z[block.count + i], src + pz.offset, 4);
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < n; ++i, src += _vertex_stride)
+                    {
+                        block.x[block.count + i] = decode(src + px.offset, px.type);
+                        block.y[block.count + i] = decode(src + py.offset, py.type);
+                        block.z[block.count + i] = decode(src + pz.offset, pz.type);
+                    }
+                }
+
+                block.count += n;
+                _head += n * _vertex_stride;
+                _remaining -= n;
+            }
+        }
+
+        static bool is_little_endian()
+        {
+            const u32 one = 1;
+            uint8_t   b;
+            memcpy(&b, &one, 1);
+            return b == 1;
+        }
+
+        FILE*                     _file = nullptr;
+        std::vector<char>         _buffer;
+        size_t                    _head = 0;
+        size_t                    _tail = 0;
+        bool                      _eof = false;
+        bool                      _error = false;
+        e_point_cloud_format      _format = POINT_CLOUD_UNKNOWN;
+        u64                       _vertex_count = 0;
+        u64                       _remaining = 0;
+        u64                       _skip_bytes = 0;
+        u64                       _skip_lines = 0;
+        u64                       _pending_skip_count = 0;
+        u32                       _vertex_stride = 0;
+        size_t                    _prop_xyz[3];
+        std::vector<ply_property> _vertex_props;
+    };
+} // namespace maths
@@ -0,0 +1,351 @@
+// rtree.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// static 2d r-tree over boxes, bulk loaded with sort-tile-recursive (leutenegger et al. 1997): entries are sorted into
+// vertical slices by x, each slice is sorted by y and packed into full nodes, then the same is repeated for each level
+// of nodes. packed nodes overlap very little, so a point query visits a handful of nodes.
+// polygon_index builds an rtree over polygon bounds and runs point_inside_poly or line_vs_poly on the candidates.
+
+namespace maths
+{
+    constexpr u32 k_rtree_node_size = 16;
+    constexpr u32 k_rtree_invalid = 0xffffffff;
+    constexpr u32 k_rtree_max_depth = 32;
+
+    // true if the segment a-b touches the box, a separating axis test on the box axes and the segment normal
+    inline bool segment_vs_aabb(const vec2f& a, const vec2f& b, const vec2f& aabb_min, const vec2f& aabb_max)
+    {
+        if (max(a.x, b.x) < aabb_min.x || min(a.x, b.x) > aabb_max.x)
+            return false;
+
+        if (max(a.y, b.y) < aabb_min.y || min(a.y, b.y) > aabb_max.y)
+            return false;
+
+        vec2f n = vec2f(a.y - b.y, b.x - a.x);
+        vec2f c = (aabb_min + aabb_max) * 0.5f - a;
+        vec2f e = (aabb_max - aabb_min) * 0.5f;
+        return fabs(dot(n, c)) <= fabs(n.x) * e.x + fabs(n.y) * e.y;
+    }
+
+    class rtree
+    {
+    public:
+        void build(const vec2f* aabb_min, const vec2f* aabb_max, size_t count, u32 node_size = k_rtree_node_size)
+        {
+            _node_size = max<u32>(node_size, 2);
+            _nodes.clear();
+            _items.resize(count);
+            std::iota(_items.begin(), _items.end(), 0);
+            if (count == 0)
+                return;
+
+            // entries are sorted by the centres of their boxes
+            std::vector<vec2f> centres(count);
+            for (size_t i = 0; i < count; ++i)
+                centres[i] = (aabb_min[i] + aabb_max[i]) * 0.5f;
+
+            str_sort(_items.data(), count, centres);
+
+            _item_min.resize(count);
+            _item_max.resize(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                _item_min[i] = aabb_min[_items[i]];
+                _item_max[i] = aabb_max[_items[i]];
+            }
+
+            // leaves
+            std::vector<node> level;
+            for (u32 i = 0; i < count; i += _node_size)
+            {
+                node n;
+                n.first = i;
+                n.count = min<u32>(_node_size, (u32)count - i);
+                n.leaf = 1;
+                n.aabb_min = _item_min[i];
+                n.aabb_max = _item_max[i];
+                for (u32 j = 1; j < n.count; ++j)
+                {
+                    n.aabb_min = min_union(n.aabb_min, _item_min[i + j]);
+                    n.aabb_max = max_union(n.aabb_max, _item_max[i + j]);
+                }
+                level.push_back(n);
+            }
+
+            // pack each level into parents until a single root remains, children are stored before their parents
+            while (level.size() > 1)
+            {
+                u32              num = (u32)level.size();
+                std::vector<u32> order(num);
+                std::iota(order.begin(), order.end(), 0);
+                centres.resize(num);
+                for (u32 i = 0; i < num; ++i)
+                    centres[i] = (level[i].aabb_min + level[i].aabb_max) * 0.5f;
+                str_sort(order.data(), num, centres);
+
+                u32 base = (u32)_nodes.size();
+                for (u32 i = 0; i < num; ++i)
+                    _nodes.push_back(level[order[i]]);
+
+                level.clear();
+                for (u32 i = 0; i < num; i += _node_size)
+                {
+                    node n;
+                    n.first = base + i;
+                    n.count = min<u32>(_node_size, num - i);
+                    n.leaf = 0;
+                    n.aabb_min = _nodes[base + i].aabb_min;
+                    n.aabb_max = _nodes[base + i].aabb_max;
+                    for (u32 j = 1; j < n.count; ++j)
+                    {
+                        n.aabb_min = min_union(n.aabb_min, _nodes[base + i + j].aabb_min);
+                        n.aabb_max = max_union(n.aabb_max, _nodes[base + i + j].aabb_max);
+                    }
+                    level.push_back(n);
+                }
+            }
+
+            _nodes.push_back(level[0]);
+        }
+
+        size_t size() const
+        {
+            return _items.size();
+        }
+
+        // bounds of everything in the tree, returns false when empty
+        bool get_aabb(vec2f& aabb_min, vec2f& aabb_max) const
+        {
+            if (_nodes.empty())
+                return false;
+
+            aabb_min = _nodes.back().aabb_min;
+            aabb_max = _nodes.back().aabb_max;
+            return true;
+        }
+
+        // appends the indices of boxes containing p
+        void query_point(const vec2f& p, std::vector<u32>& indices_out) const
+        {
+            traverse([&](const vec2f& bmin, const vec2f& bmax) { return point_inside_aabb(bmin, bmax, p); },
+                     [&](u32 index) {
+                         indices_out.push_back(index);
+                         return true;
+                     });
+        }
+
+        // appends the indices of boxes touched by the segment a-b
+        void query_segment(const vec2f& a, const vec2f& b, std::vector<u32>& indices_out) const
+        {
+            traverse([&](const vec2f& bmin, const vec2f& bmax) { return segment_vs_aabb(a, b, bmin, bmax); },
+                     [&](u32 index) {
+                         indices_out.push_back(index);
+                         return true;
+                     });
+        }
+
+        // appends the indices of boxes overlapping query_min-query_max
+        void query_aabb(const vec2f& query_min, const vec2f& query_max, std::vector<u32>& indices_out) const
+        {
+            traverse(
+                [&](const vec2f& bmin, const vec2f& bmax) {
+                    return bmin.x <= query_max.x && bmax.x >= query_min.x && bmin.y <= query_max.y &&
+                           bmax.y >= query_min.y;
+                },
+                [&](u32 index) {
+                    indices_out.push_back(index);
+                    return true;
+                });
+        }
+
+        // calls visit(index) for each box passing box_test(aabb_min, aabb_max), stops early if visit returns false
+        template <class BoxTest, class Visit>
+        void traverse(BoxTest box_test, Visit visit) const
+        {
+            if (_nodes.empty())
+                return;
+
+            u32              stack[k_rtree_max_depth * k_rtree_node_size];
+            std::vector<u32> heap_stack;
+            u32*             s = stack;
+            if (_node_size > k_rtree_node_size)
+            {
+                heap_stack.resize(k_rtree_max_depth * _node_size);
+                s = heap_stack.data();
+            }
+
+            u32 sp = 0;
+            s[sp++] = (u32)_nodes.size() - 1;
+            while (sp > 0)
+            {
+                const node& n = _nodes[s[--sp]];
+                if (!box_test(n.aabb_min, n.aabb_max))
+                    continue;
+
+                if (n.leaf)
+                {
+                    for (u32 i = n.first; i < n.first + n.count; ++i)
+                        if (box_test(_item_min[i], _item_max[i]))
+                            if (!visit(_items[i]))
+                                return;
+                }
+                else
+                {
+                    for (u32 i = n.first + n.count; i-- > n.first;)
+                        s[sp++] = i;
+                }
+            }
+        }
+
+    private:
+        struct node
+        {
+            vec2f aabb_min;
+            vec2f aabb_max;
+            u32   first; // first item for leaves, first child node otherwise
+            u32   count;
+            u32   leaf;
+        };
+
+        // sort-tile-recursive ordering of count entries by centre
+        void str_sort(u32* entries, size_t count, const std::vector<vec2f>& centres) const
+        {
+            std::sort(entries, entries + count, [&](u32 a, u32 b) { return centres[a].x < centres[b].x; });
+
+            size_t leaves = (count + _node_size - 1) / _node_size;
+            size_t slices = (size_t)ceil(sqrt((f64)leaves));
+            size_t slice_size = slices * _node_size;
+            for (size_t i = 0; i < count; i += slice_size)
+            {
+                size_t end = min(i + slice_size, count);
+                std::sort(entries + i, entries + end, [&](u32 a, u32 b) { return centres[a].y < centres[b].y; });
+            }
+        }
+
+        std::vector<node>  _nodes;
+        std::vector<u32>   _items;
+        std::vector<vec2f> _item_min;
+        std::vector<vec2f> _item_max;
+        u32                _node_size = k_rtree_node_size;
+    };
+
+    // polygons indexed by their bounds for classifying points and segments against many regions
+    class polygon_index
+    {
+    public:
+        void build(const std::vector<std::vector<vec2f>>& polygons, u32 node_size = k_rtree_node_size)
+        {
+            _polygons = polygons;
+            size_t             n = polygons.size();
+            std::vector<vec2f> bmin(n, vec2f(FLT_MAX)), bmax(n, vec2f(-FLT_MAX));
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (auto& v : polygons[i])
+                {
+                    bmin[i] = min_union(bmin[i], v);
+                    bmax[i] = max_union(bmax[i], v);
+                }
+            }
+            _tree.build(bmin.data(), bmax.data(), n, node_size);
+        }
+
+        size_t size() const
+        {
+            return _polygons.size();
+        }
+
+        const std::vector<vec2f>& polygon(size_t i) const
+        {
+            return _polygons[i];
+        }
+
+        const rtree& tree() const
+        {
+            return _tree;
+        }
+
+        // lowest index polygon containing p, or k_rtree_invalid
+        u32 find_polygon(const vec2f& p) const
+        {
+            u32 found = k_rtree_invalid;
+            _tree.traverse([&](const vec2f& bmin, const vec2f& bmax) { return point_inside_aabb(bmin, bmax, p); },
+                           [&](u32 index) {
+                               if (index < found && point_inside_poly(p, _polygons[index]))
+                                   found = index;
+                               return true;
+                           });
+            return found;
+        }
+
+        // appends every polygon containing p, for overlapping regions
+        void find_polygons(const vec2f& p, std::vector<u32>& indices_out) const
+        {
+            _tree.traverse([&](const vec2f& bmin, const vec2f& bmax) { return point_inside_aabb(bmin, bmax, p); },
+                           [&](u32 index) {
+                               if (point_inside_poly(p, _polygons[index]))
+                                   indices_out.push_back(index);
+                               return true;
+                           });
+        }
+
+        // appends every polygon the segment a-b crosses the boundary of or lies inside
+        void find_polygons(const vec2f& a, const vec2f& b, std::vector<u32>& indices_out) const
+        {
+            std::vector<vec2f> ips;
+            _tree.traverse([&](const vec2f& bmin, const vec2f& bmax) { return segment_vs_aabb(a, b, bmin, bmax); },
+                           [&](u32 index) {
+                               const std::vector<vec2f>& poly = _polygons[index];
+                               if (line_vs_poly(a, b, poly, ips) || point_inside_poly(a, poly))
+                                   indices_out.push_back(index);
+                               return true;
+                           });
+        }
+
+        // find_polygon for count points. the queries are visited in morton order over the bounds of the index so
+        // consecutive queries walk the same nodes and polygons, results are written in the original order.
+        void find_polygon(const vec2f* points, size_t count, u32* indices_out) const
+        {
+            vec2f bmin, bmax;
+            if (!_tree.get_aabb(bmin, bmax))
+            {
+                std::fill(indices_out, indices_out + count, k_rtree_invalid);
+                return;
+            }
+
+            vec2f extent = bmax - bmin;
+            vec2f scale = vec2f(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+                                extent.y > 0.0f ? 65535.0f / extent.y : 0.0f);
+
+            std::vector<u32> codes(count), order(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                vec2f q = (points[i] - bmin) * scale;
+                u64   x = (u64)clamp(q.x, 0.0f, 65535.0f);
+                u64   y = (u64)clamp(q.y, 0.0f, 65535.0f);
+                u64   d;
+                morton_xy2d(x, y, &d);
+                codes[i] = (u32)d;
+                order[i] = (u32)i;
+            }
+
+            std::vector<u32> codes_temp(count), order_temp(count);
+            ::radix_sort(codes.data(), order.data(), count, codes_temp.data(), order_temp.data());
+
+            for (size_t i = 0; i < count; ++i)
+                indices_out[order[i]] = find_polygon(points[order[i]]);
+        }
+
+    private:
+        std::vector<std::vector<vec2f>> _polygons;
+        rtree                           _tree;
+    };
+} // namespace maths
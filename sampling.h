@@ -0,0 +1,485 @@
+// sampling.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+// random number generation and sampling of geometric domains for monte carlo integration.
+// warps map uniform u in [0, 1)^2 to points on a domain so they can be fed from any source of samples, the batch
+// samplers draw u from a multi stream pcg32 generator and build any basis they need once per call.
+// low discrepancy sequences (sobol, halton and r1 / r2 / r3) produce better stratified u for the warps.
+
+namespace maths
+{
+    // number of independent streams advanced together by pcg32_lanes
+    constexpr size_t k_sampling_lanes = 8;
+
+    // pcg32 (pcg-xsh-rr 64/32), seed selects the position in the sequence and stream selects one of 2^63 independent
+    // sequences. matches the reference pcg32_srandom / pcg32_random implementation.
+    struct pcg32
+    {
+        u64 state = 0x853c49e6748fea9bULL;
+        u64 inc = 0xda3e39cb94b95bdbULL;
+
+        pcg32() = default;
+
+        explicit pcg32(u64 seed, u64 stream = 0)
+        {
+            init(seed, stream);
+        }
+
+        void init(u64 seed, u64 stream = 0)
+        {
+            state = 0;
+            inc = (stream << 1) | 1;
+            next();
+            state += seed;
+            next();
+        }
+
+        u32 next()
+        {
+            u64 old = state;
+            state = old * 6364136223846793005ULL + inc;
+            u32 xorshifted = (u32)(((old >> 18) ^ old) >> 27);
+            u32 rot = (u32)(old >> 59);
+            return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+        }
+
+        // uniform float in [0, 1) with 24 bits of precision
+        f32 next_f32()
+        {
+            return (f32)(next() >> 8) * (1.0f / 16777216.0f);
+        }
+
+        // uniform integer in [0, bound) without modulo bias
+        u32 next_bounded(u32 bound)
+        {
+            u32 threshold = (0u - bound) % bound;
+            for (;;)
+            {
+                u32 r = next();
+                if (r >= threshold)
+                    return r % bound;
+            }
+        }
+    };
+
+    // stateless pcg based hash (jarzynski and olano), used to derive independent seeds
+    maths_inline u32 pcg_hash(u32 x)
+    {
+        u32 state = x * 747796405u + 2891336453u;
+        u32 word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+        return (word >> 22) ^ word;
+    }
+
+    // k_sampling_lanes pcg32 generators on consecutive streams, stored soa so each step advances all streams together
+    struct pcg32_lanes
+    {
+        u64 state[k_sampling_lanes];
+        u64 inc[k_sampling_lanes];
+
+        explicit pcg32_lanes(u64 seed = 0, u64 first_stream = 0)
+        {
+            init(seed, first_stream);
+        }
+
+        // lane l produces the same sequence as pcg32(seed, first_stream + l)
+        void init(u64 seed, u64 first_stream = 0)
+        {
+            for (size_t l = 0; l < k_sampling_lanes; ++l)
+            {
+                pcg32 g(seed, first_stream + l);
+                state[l] = g.state;
+                inc[l] = g.inc;
+            }
+        }
+
+        void next(u32 (&out)[k_sampling_lanes])
+        {
+            for (size_t l = 0; l < k_sampling_lanes; ++l)
+            {
+                u64 old = state[l];
+                state[l] = old * 6364136223846793005ULL + inc[l];
+                u32 xorshifted = (u32)(((old >> 18) ^ old) >> 27);
+                u32 rot = (u32)(old >> 59);
+                out[l] = (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+            }
+        }
+
+        void next_f32(f32 (&out)[k_sampling_lanes])
+        {
+            u32 r[k_sampling_lanes];
+            next(r);
+            for (size_t l = 0; l < k_sampling_lanes; ++l)
+                out[l] = (f32)(r[l] >> 8) * (1.0f / 16777216.0f);
+        }
+
+        // fills count floats in [0, 1), value i comes from lane i % k_sampling_lanes
+        void next_f32(f32* out, size_t count)
+        {
+            for (size_t base = 0; base < count; base += k_sampling_lanes)
+            {
+                f32 r[k_sampling_lanes];
+                next_f32(r);
+                size_t n = min(k_sampling_lanes, count - base);
+                for (size_t l = 0; l < n; ++l)
+                    out[base + l] = r[l];
+            }
+        }
+    };
+
+    //
+    // low discrepancy sequences
+    //
+
+    constexpr u32 k_sobol_dimensions = 4;
+    constexpr u32 k_halton_dimensions = 16;
+
+    // plastic number and its 3d counterpart, the generalised golden ratios for r2 and r3
+    constexpr double M_PLASTIC = 1.32471795724474602596;
+    constexpr double M_PHI3    = 1.22074408460575947536;
+
+    // converts 32 bits of fixed point to a float in [0, 1), rounding down so 1 is never returned
+    maths_inline f32 u32_to_unit_f32(u32 x)
+    {
+        return (f32)(x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    maths_inline u32 reverse_bits(u32 x)
+    {
+        x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+        x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+        x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+        x = ((x >> 8) & 0x00ff00ff) | ((x & 0x00ff00ff) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // returns the sobol generator matrices for k_sobol_dimensions dimensions built on first use from the joe-kuo
+    // primitive polynomials and initial direction numbers, column i is the contribution of bit i of the index
+    inline const u32* get_sobol_matrices()
+    {
+        struct table
+        {
+            u32 v[k_sobol_dimensions * 32];
+            table()
+            {
+                // degree s, polynomial coefficients a and initial direction numbers m for dimensions 1 - 3
+                static const u32 k_s[k_sobol_dimensions] = {0, 1, 2, 3};
+                static const u32 k_a[k_sobol_dimensions] = {0, 0, 1, 1};
+                static const u32 k_m[k_sobol_dimensions][3] = {{0, 0, 0}, {1, 0, 0}, {1, 3, 0}, {1, 3, 1}};
+
+                for (u32 i = 0; i < 32; ++i)
+                    v[i] = 1u << (31 - i);
+
+                for (u32 d = 1; d < k_sobol_dimensions; ++d)
+                {
+                    u32* dv = &v[d * 32];
+                    u32  s = k_s[d];
+                    for (u32 i = 0; i < 32; ++i)
+                    {
+                        if (i < s)
+                        {
+                            dv[i] = k_m[d][i] << (31 - i);
+                            continue;
+                        }
+
+                        dv[i] = dv[i - s] ^ (dv[i - s] >> s);
+                        for (u32 k = 1; k < s; ++k)
+                            dv[i] ^= ((k_a[d] >> (s - 1 - k)) & 1) * dv[i - k];
+                    }
+                }
+            }
+        };
+        static const table t;
+        return t.v;
+    }
+
+    // sobol point index in dimension as 32 bit fixed point
+    inline u32 sobol_u32(u32 index, u32 dimension)
+    {
+        const u32* v = get_sobol_matrices() + dimension * 32;
+        u32 x = 0;
+        for (u32 i = 0; index; index >>= 1, ++i)
+            x ^= (index & 1) * v[i];
+        return x;
+    }
+
+    // hash based owen scramble (laine-karras permutation) of bits in reversed order
+    maths_inline u32 laine_karras_permutation(u32 x, u32 seed)
+    {
+        x += seed;
+        x ^= x * 0x6c50b47c;
+        x ^= x * 0xb82f1e52;
+        x ^= x * 0xc7afe638;
+        x ^= x * 0x8d22f6e6;
+        return x;
+    }
+
+    // nested uniform (owen) scramble of the 32 bit fixed point value x
+    maths_inline u32 nested_uniform_scramble(u32 x, u32 seed)
+    {
+        return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+    }
+
+    // sobol point index in dimension (< k_sobol_dimensions) in [0, 1)
+    inline f32 sobol(u32 index, u32 dimension)
+    {
+        return u32_to_unit_f32(sobol_u32(index, dimension));
+    }
+
+    // owen scrambled sobol, the index is shuffled and every dimension scrambled with an independent seed derived
+    // from seed. keeps the stratification of power of 2 prefixes while removing the structure of plain sobol.
+    inline f32 sobol_owen(u32 index, u32 dimension, u32 seed)
+    {
+        u32 shuffled = nested_uniform_scramble(index, pcg_hash(seed));
+        u32 x = sobol_u32(shuffled, dimension);
+        return u32_to_unit_f32(nested_uniform_scramble(x, pcg_hash(seed + dimension + 1)));
+    }
+
+    // radical inverse of index in base, the digits of index mirrored about the decimal point
+    inline f32 radical_inverse(u32 base, u32 index)
+    {
+        f64 inv_base = 1.0 / (f64)base;
+        f64 scale = inv_base;
+        f64 result = 0.0;
+        while (index)
+        {
+            result += (f64)(index % base) * scale;
+            index /= base;
+            scale *= inv_base;
+        }
+        return min((f32)result, 0.99999994f);
+    }
+
+    // halton point index in dimension (< k_halton_dimensions), the radical inverse in the dimension'th prime base
+    inline f32 halton(u32 index, u32 dimension)
+    {
+        static const u32 k_primes[k_halton_dimensions] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+        return radical_inverse(k_primes[dimension], index);
+    }
+
+    // additive recurrences frac(0.5 + index * alpha) with alpha from the generalised golden ratio of the dimension,
+    // evaluated in 32 bit fixed point so precision does not degrade with large indices
+    inline f32 r1(u32 index)
+    {
+        const u32 alpha = (u32)(M_INV_PHI * 4294967296.0);
+        return u32_to_unit_f32(0x80000000u + index * alpha);
+    }
+
+    inline vec2f r2(u32 index)
+    {
+        const u32 a0 = (u32)(1.0 / M_PLASTIC * 4294967296.0);
+        const u32 a1 = (u32)(1.0 / (M_PLASTIC * M_PLASTIC) * 4294967296.0);
+        return vec2f(u32_to_unit_f32(0x80000000u + index * a0), u32_to_unit_f32(0x80000000u + index * a1));
+    }
+
+    inline vec3f r3(u32 index)
+    {
+        const u32 a0 = (u32)(1.0 / M_PHI3 * 4294967296.0);
+        const u32 a1 = (u32)(1.0 / (M_PHI3 * M_PHI3) * 4294967296.0);
+        const u32 a2 = (u32)(1.0 / (M_PHI3 * M_PHI3 * M_PHI3) * 4294967296.0);
+        return vec3f(u32_to_unit_f32(0x80000000u + index * a0), u32_to_unit_f32(0x80000000u + index * a1),
+                     u32_to_unit_f32(0x80000000u + index * a2));
+    }
+
+    // batch versions, write count points starting at sequence index first
+
+    inline void sobol(u32 first, size_t count, vec2f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec2f(sobol(first + (u32)i, 0), sobol(first + (u32)i, 1));
+    }
+
+    inline void sobol(u32 first, size_t count, vec3f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec3f(sobol(first + (u32)i, 0), sobol(first + (u32)i, 1), sobol(first + (u32)i, 2));
+    }
+
+    inline void sobol_owen(u32 first, size_t count, u32 seed, vec2f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec2f(sobol_owen(first + (u32)i, 0, seed), sobol_owen(first + (u32)i, 1, seed));
+    }
+
+    inline void sobol_owen(u32 first, size_t count, u32 seed, vec3f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec3f(sobol_owen(first + (u32)i, 0, seed), sobol_owen(first + (u32)i, 1, seed),
+                           sobol_owen(first + (u32)i, 2, seed));
+    }
+
+    inline void halton(u32 first, size_t count, vec2f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec2f(halton(first + (u32)i, 0), halton(first + (u32)i, 1));
+    }
+
+    inline void halton(u32 first, size_t count, vec3f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = vec3f(halton(first + (u32)i, 0), halton(first + (u32)i, 1), halton(first + (u32)i, 2));
+    }
+
+    inline void r2(u32 first, size_t count, vec2f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = r2(first + (u32)i);
+    }
+
+    inline void r3(u32 first, size_t count, vec3f* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = r3(first + (u32)i);
+    }
+
+    //
+    // warps from u in [0, 1)^2
+    //
+
+    // uniform point in the unit disk
+    maths_inline vec2f warp_disk(const vec2f& u)
+    {
+        f32 r = sqrt(u.x);
+        f32 phi = (f32)M_TWO_PI * u.y;
+        return vec2f(r * cos(phi), r * sin(phi));
+    }
+
+    // uniform direction on the unit sphere
+    maths_inline vec3f warp_direction(const vec2f& u)
+    {
+        f32 z = 1.0f - 2.0f * u.x;
+        f32 r = sqrt(max(0.0f, 1.0f - z * z));
+        f32 phi = (f32)M_TWO_PI * u.y;
+        return vec3f(r * cos(phi), r * sin(phi), z);
+    }
+
+    // uniform point inside the unit sphere, u3 selects the radius
+    maths_inline vec3f warp_sphere(const vec2f& u, f32 u3)
+    {
+        return warp_direction(u) * cbrtf(u3);
+    }
+
+    // cosine weighted direction in the hemisphere around +z, pdf = z / pi
+    maths_inline vec3f warp_cosine_hemisphere(const vec2f& u)
+    {
+        vec2f d = warp_disk(u);
+        return vec3f(d.x, d.y, sqrt(max(0.0f, 1.0f - d.x * d.x - d.y * d.y)));
+    }
+
+    // uniform barycentric coordinates (b1, b2) for a triangle, the point is t0 + b1 * (t1 - t0) + b2 * (t2 - t0)
+    maths_inline vec2f warp_triangle(const vec2f& u)
+    {
+        f32 su = sqrt(u.x);
+        return vec2f(su * (1.0f - u.y), su * u.y);
+    }
+
+    //
+    // batch samplers
+    //
+
+    // count uniform points in the unit disk
+    inline void sample_disk(pcg32_lanes& rng, size_t count, vec2f* out)
+    {
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            size_t n = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < n; ++l)
+                out[base + l] = warp_disk(vec2f(u1[l], u2[l]));
+        }
+    }
+
+    // count uniform directions on the unit sphere
+    inline void sample_direction(pcg32_lanes& rng, size_t count, vec3f* out)
+    {
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            size_t n = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < n; ++l)
+                out[base + l] = warp_direction(vec2f(u1[l], u2[l]));
+        }
+    }
+
+    // count uniform points inside the sphere at centre with radius
+    inline void sample_sphere(pcg32_lanes& rng, const vec3f& centre, f32 radius, size_t count, vec3f* out)
+    {
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes], u3[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            rng.next_f32(u3);
+            size_t n = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < n; ++l)
+                out[base + l] = centre + warp_sphere(vec2f(u1[l], u2[l]), u3[l]) * radius;
+        }
+    }
+
+    // count uniform points on the triangle t0, t1, t2
+    inline void sample_triangle(pcg32_lanes& rng, const vec3f& t0, const vec3f& t1, const vec3f& t2, size_t count,
+                                vec3f* out)
+    {
+        vec3f e1 = t1 - t0;
+        vec3f e2 = t2 - t0;
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            size_t n = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < n; ++l)
+            {
+                vec2f b = warp_triangle(vec2f(u1[l], u2[l]));
+                out[base + l] = t0 + e1 * b.x + e2 * b.y;
+            }
+        }
+    }
+
+    // count cosine weighted directions in the hemisphere around the normalised vector n, the basis is built once
+    inline void sample_cosine_hemisphere(pcg32_lanes& rng, const vec3f& n, size_t count, vec3f* out)
+    {
+        vec3f b1, b2;
+        get_orthonormal_basis_frisvad(n, b1, b2);
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            size_t c = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < c; ++l)
+            {
+                vec3f d = warp_cosine_hemisphere(vec2f(u1[l], u2[l]));
+                out[base + l] = b1 * d.x + b2 * d.y + n * d.z;
+            }
+        }
+    }
+
+    // one cosine weighted direction around each of count normalised normals
+    inline void sample_cosine_hemisphere(pcg32_lanes& rng, const vec3f* normals, size_t count, vec3f* out)
+    {
+        for (size_t base = 0; base < count; base += k_sampling_lanes)
+        {
+            f32 u1[k_sampling_lanes], u2[k_sampling_lanes];
+            rng.next_f32(u1);
+            rng.next_f32(u2);
+            size_t c = min(k_sampling_lanes, count - base);
+            for (size_t l = 0; l < c; ++l)
+            {
+                const vec3f& n = normals[base + l];
+                vec3f b1, b2;
+                get_orthonormal_basis_frisvad(n, b1, b2);
+                vec3f d = warp_cosine_hemisphere(vec2f(u1[l], u2[l]));
+                out[base + l] = b1 * d.x + b2 * d.y + n * d.z;
+            }
+        }
+    }
+} // namespace maths
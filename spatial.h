@@ -0,0 +1,199 @@
+// spatial.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <string.h>
+#include <vector>
+
+// space filling curve codes for point sets, built on the morton and hilbert functions in util.h.
+// points are quantised to a grid of 2^21 cells per axis over a bounding box, so codes fit in 64 bits. the batch
+// functions process blocks of k_spatial_batch_block points through local arrays so the quantise loop vectorises.
+// sorting points by their codes puts points that are close in space close in memory, which speeds up neighbour queries
+// and any scan that touches nearby points together.
+
+namespace maths
+{
+    constexpr u32    k_spatial_bits_3d = 21;
+    constexpr size_t k_spatial_batch_block = 64;
+
+    enum class e_space_filling_curve
+    {
+        morton, // z order, cheapest to encode
+        hilbert // no jumps between distant cells, better locality for a little more work
+    };
+
+    // bounding box of count points, empty sets return an inverted box
+    inline void get_aabb(const vec3f* points, size_t count, vec3f& aabb_min, vec3f& aabb_max)
+    {
+        aabb_min = vec3f(FLT_MAX);
+        aabb_max = vec3f(-FLT_MAX);
+        for (size_t i = 0; i < count; ++i)
+        {
+            aabb_min = min_union(aabb_min, points[i]);
+            aabb_max = max_union(aabb_max, points[i]);
+        }
+    }
+
+    // quantises points to integer cells of a 2^bits grid over aabb_min-aabb_max, points outside the box clamp to the
+    // edge cells. a flat axis (zero extent) quantises to 0.
+    inline void quantise_points(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                                u32* x_out, u32* y_out, u32* z_out, u32 bits = k_spatial_bits_3d)
+    {
+        f32   max_cell = (f32)((1u << bits) - 1);
+        vec3f extent = aabb_max - aabb_min;
+        f32   scale[3];
+        for (u32 j = 0; j < 3; ++j)
+            scale[j] = extent[j] > 0.0f ? (f32)(1u << bits) / extent[j] : 0.0f;
+
+        f32 px[k_spatial_batch_block], py[k_spatial_batch_block], pz[k_spatial_batch_block];
+        u32 qx[k_spatial_batch_block], qy[k_spatial_batch_block], qz[k_spatial_batch_block];
+        for (size_t base = 0; base < count; base += k_spatial_batch_block)
+        {
+            size_t n = min(k_spatial_batch_block, count - base);
+            for (size_t i = 0; i < n; ++i)
+            {
+                px[i] = points[base + i].x;
+                py[i] = points[base + i].y;
+                pz[i] = points[base + i].z;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                f32 x = (px[i] - aabb_min.x) * scale[0];
+                f32 y = (py[i] - aabb_min.y) * scale[1];
+                f32 z = (pz[i] - aabb_min.z) * scale[2];
+                x = x < 0.0f ? 0.0f : x;
+                y = y < 0.0f ? 0.0f : y;
+                z = z < 0.0f ? 0.0f : z;
+                x = x > max_cell ? max_cell : x;
+                y = y > max_cell ? max_cell : y;
+                z = z > max_cell ? max_cell : z;
+                qx[i] = (u32)x;
+                qy[i] = (u32)y;
+                qz[i] = (u32)z;
+            }
+
+            memcpy(x_out + base, qx, n * sizeof(u32));
+            memcpy(y_out + base, qy, n * sizeof(u32));
+            memcpy(z_out + base, qz, n * sizeof(u32));
+        }
+    }
+
+    // 63 bit morton codes of count points quantised over aabb_min-aabb_max
+    inline void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                              u64* codes_out)
+    {
+        u32 qx[k_spatial_batch_block], qy[k_spatial_batch_block], qz[k_spatial_batch_block];
+        for (size_t base = 0; base < count; base += k_spatial_batch_block)
+        {
+            size_t n = min(k_spatial_batch_block, count - base);
+            quantise_points(points + base, n, aabb_min, aabb_max, qx, qy, qz);
+            for (size_t i = 0; i < n; ++i)
+                morton_xyz3d(qx[i], qy[i], qz[i], &codes_out[base + i]);
+        }
+    }
+
+    // 63 bit hilbert indices of count points quantised over aabb_min-aabb_max
+    inline void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                               u64* codes_out)
+    {
+        u32 qx[k_spatial_batch_block], qy[k_spatial_batch_block], qz[k_spatial_batch_block];
+        for (size_t base = 0; base < count; base += k_spatial_batch_block)
+        {
+            size_t n = min(k_spatial_batch_block, count - base);
+            quantise_points(points + base, n, aabb_min, aabb_max, qx, qy, qz);
+            for (size_t i = 0; i < n; ++i)
+                hilbert_xyz3d(qx[i], qy[i], qz[i], &codes_out[base + i]);
+        }
+    }
+
+    inline void spatial_encode(e_space_filling_curve curve, const vec3f* points, size_t count, const vec3f& aabb_min,
+                               const vec3f& aabb_max, u64* codes_out)
+    {
+        if (curve == e_space_filling_curve::hilbert)
+            hilbert_encode(points, count, aabb_min, aabb_max, codes_out);
+        else
+            morton_encode(points, count, aabb_min, aabb_max, codes_out);
+    }
+
+    // permutation that sorts points along the curve, permutation[i] is the index of the point which moves to i.
+    // points with the same code keep their original order.
+    inline void spatial_sort_order(e_space_filling_curve curve, const vec3f* points, size_t count,
+                                   std::vector<u32>& permutation_out)
+    {
+        vec3f aabb_min, aabb_max;
+        get_aabb(points, count, aabb_min, aabb_max);
+
+        std::vector<u64> codes(count);
+        spatial_encode(curve, points, count, aabb_min, aabb_max, codes.data());
+
+        permutation_out.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            permutation_out[i] = (u32)i;
+
+        std::vector<u64> codes_temp(count);
+        std::vector<u32> permutation_temp(count);
+        ::radix_sort(codes.data(), permutation_out.data(), count, codes_temp.data(), permutation_temp.data(), 11);
+    }
+
+    // gathers out[i] = in[permutation[i]], in and out must not overlap
+    template <class T>
+    inline void apply_permutation(const u32* permutation, size_t count, const T* in, T* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = in[permutation[i]];
+    }
+
+    // reorders data in place, data must have as many elements as the permutation
+    template <class T>
+    inline void apply_permutation(const std::vector<u32>& permutation, std::vector<T>& data)
+    {
+        std::vector<T> reordered(data.size());
+        apply_permutation(permutation.data(), permutation.size(), data.data(), reordered.data());
+        data.swap(reordered);
+    }
+
+    // inverse_out[permutation[i]] = i, maps old indices to new ones, ie. to remap an index buffer after reordering
+    // the vertices it refers to
+    inline void invert_permutation(const u32* permutation, size_t count, u32* inverse_out)
+    {
+        for (size_t i = 0; i < count; ++i)
+            inverse_out[permutation[i]] = (u32)i;
+    }
+
+    // replaces each index with its new position after reordering with permutation
+    inline void remap_indices(const std::vector<u32>& permutation, u32* indices, size_t count)
+    {
+        std::vector<u32> inverse(permutation.size());
+        invert_permutation(permutation.data(), permutation.size(), inverse.data());
+        for (size_t i = 0; i < count; ++i)
+            indices[i] = inverse[indices[i]];
+    }
+
+    inline void spatial_reorder_attributes(const std::vector<u32>&)
+    {
+    }
+
+    template <class T, class... Attributes>
+    inline void spatial_reorder_attributes(const std::vector<u32>& permutation, std::vector<T>& attribute,
+                                           Attributes&... attributes)
+    {
+        apply_permutation(permutation, attribute);
+        spatial_reorder_attributes(permutation, attributes...);
+    }
+
+    // sorts points along the curve in place and moves any number of attribute arrays (std::vector of any type, one
+    // entry per point) with them. returns the permutation for reordering anything else, see apply_permutation.
+    template <class... Attributes>
+    inline void spatial_reorder(e_space_filling_curve curve, std::vector<vec3f>& points,
+                                std::vector<u32>& permutation_out, Attributes&... attributes)
+    {
+        spatial_sort_order(curve, points.data(), points.size(), permutation_out);
+        apply_permutation(permutation_out, points);
+        spatial_reorder_attributes(permutation_out, attributes...);
+    }
+} // namespace maths
@@ -9,8 +9,13 @@
 #include <cmath>
 #include <float.h>
 #include <iostream>
+#include <string.h>
 #include <vector>
 
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #define MATHS_ALWAYS_INLINE
 
 #ifndef MATHS_ALWAYS_INLINE
@@ -287,6 +292,173 @@ maths_inline T clamp(T a, T lower, T upper)
         return a;
 }
 
+// float_to_sortable - maps floats to unsigned integers which compare in the same order, -0 sorts before +0 and nans
+// sort beyond the infinities of the same sign
+
+maths_inline u32 float_to_sortable(f32 f)
+{
+    u32 u;
+    memcpy(&u, &f, sizeof(u));
+    u32 mask = (u32)(-(int32_t)(u >> 31)) | 0x80000000;
+    return u ^ mask;
+}
+
+maths_inline f32 sortable_to_float(u32 u)
+{
+    u32 mask = ((u >> 31) - 1) | 0x80000000;
+    u ^= mask;
+    f32 f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+maths_inline u64 float_to_sortable(f64 f)
+{
+    u64 u;
+    memcpy(&u, &f, sizeof(u));
+    u64 mask = (u64)(-(int64_t)(u >> 63)) | 0x8000000000000000;
+    return u ^ mask;
+}
+
+maths_inline f64 sortable_to_float(u64 u)
+{
+    u64 mask = ((u >> 63) - 1) | 0x8000000000000000;
+    u ^= mask;
+    f64 f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// radix_key - the unsigned integer a radix sort orders a key by
+
+maths_inline u32 radix_key(u32 k)
+{
+    return k;
+}
+
+maths_inline u64 radix_key(u64 k)
+{
+    return k;
+}
+
+maths_inline u32 radix_key(int32_t k)
+{
+    return (u32)k ^ 0x80000000;
+}
+
+maths_inline u64 radix_key(int64_t k)
+{
+    return (u64)k ^ 0x8000000000000000;
+}
+
+maths_inline u32 radix_key(f32 k)
+{
+    return float_to_sortable(k);
+}
+
+maths_inline u64 radix_key(f64 k)
+{
+    return float_to_sortable(k);
+}
+
+// number of radix_sort passes for key type K with digit_bits per pass
+template <class K>
+maths_inline u32 radix_passes(u32 digit_bits)
+{
+    return (u32)(sizeof(radix_key(K())) * 8 + digit_bits - 1) / digit_bits;
+}
+
+template <class K, class V, bool with_values>
+inline void radix_sort_impl(K* keys, V* values, size_t count, K* keys_temp, V* values_temp, u32 digit_bits)
+{
+    if (count < 2)
+        return;
+
+    digit_bits = clamp<u32>(digit_bits, 1, 16);
+    const u32 radix = 1u << digit_bits;
+    const u32 mask = radix - 1;
+    const u32 passes = radix_passes<K>(digit_bits);
+
+    // a single read histograms the digits of every pass
+    std::vector<size_t> hist((size_t)passes * radix, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto k = radix_key(keys[i]);
+        for (u32 p = 0; p < passes; ++p)
+            hist[(size_t)p * radix + (u32)((k >> (p * digit_bits)) & mask)]++;
+    }
+
+    K* src = keys;
+    K* dst = keys_temp;
+    V* vsrc = values;
+    V* vdst = values_temp;
+    for (u32 p = 0; p < passes; ++p)
+    {
+        u32     shift = p * digit_bits;
+        size_t* h = &hist[(size_t)p * radix];
+
+        // skip passes where every key has the same digit, ie. the high bytes of small keys
+        if (h[(radix_key(src[0]) >> shift) & mask] == count)
+            continue;
+
+        size_t sum = 0;
+        for (u32 d = 0; d < radix; ++d)
+        {
+            size_t c = h[d];
+            h[d] = sum;
+            sum += c;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t o = h[(u32)((radix_key(src[i]) >> shift) & mask)]++;
+            dst[o] = src[i];
+            if (with_values)
+                vdst[o] = vsrc[i];
+        }
+
+        std::swap(src, dst);
+        std::swap(vsrc, vdst);
+    }
+
+    if (src != keys)
+    {
+        std::copy(src, src + count, keys);
+        if (with_values)
+            std::copy(vsrc, vsrc + count, values);
+    }
+}
+
+// stable lsd radix sort of count keys (u32, u64, int32_t, int64_t, f32 or f64), keys_temp must hold count keys.
+// digit_bits per pass trades histogram size for passes, 8 suits most sizes and 11 does 32 bit keys in 3 passes.
+template <class K>
+inline void radix_sort(K* keys, size_t count, K* keys_temp, u32 digit_bits = 8)
+{
+    radix_sort_impl<K, K, false>(keys, nullptr, count, keys_temp, nullptr, digit_bits);
+}
+
+// sorts keys and moves values with them, values_temp must hold count values
+template <class K, class V>
+inline void radix_sort(K* keys, V* values, size_t count, K* keys_temp, V* values_temp, u32 digit_bits = 8)
+{
+    radix_sort_impl<K, V, true>(keys, values, count, keys_temp, values_temp, digit_bits);
+}
+
+template <class K>
+inline void radix_sort(std::vector<K>& keys, u32 digit_bits = 8)
+{
+    std::vector<K> temp(keys.size());
+    radix_sort(keys.data(), keys.size(), temp.data(), digit_bits);
+}
+
+template <class K, class V>
+inline void radix_sort(std::vector<K>& keys, std::vector<V>& values, u32 digit_bits = 8)
+{
+    std::vector<K> keys_temp(keys.size());
+    std::vector<V> values_temp(values.size());
+    radix_sort(keys.data(), values.data(), keys.size(), keys_temp.data(), values_temp.data(), digit_bits);
+}
+
 // only makes sense with T=float or double
 template <class T>
 maths_inline T smooth_step(T r)
@@ -377,27 +549,35 @@ maths_inline unsigned int round_down_to_power_of_two(unsigned int n)
     return 1 << exponent;
 }
 
-inline void morton_xy2d(u64 x, u64 y, u64 *d)
+// morton_spread2 - spread the low 32 bits of x into the even bits
+
+inline u64 morton_spread2(u64 x)
 {
+#if defined(__BMI2__)
+    return _pdep_u64(x, 0x5555555555555555);
+#else
+    x &= 0x00000000FFFFFFFF;
     x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
     x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
     x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
     x = (x | (x << 2)) & 0x3333333333333333;
     x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+#endif
+}
 
-    y = (y | (y << 16)) & 0x0000FFFF0000FFFF;
-    y = (y | (y << 8)) & 0x00FF00FF00FF00FF;
-    y = (y | (y << 4)) & 0x0F0F0F0F0F0F0F0F;
-    y = (y | (y << 2)) & 0x3333333333333333;
-    y = (y | (y << 1)) & 0x5555555555555555;
-
-    *d = x | (y << 1);
+inline void morton_xy2d(u64 x, u64 y, u64 *d)
+{
+    *d = morton_spread2(x) | (morton_spread2(y) << 1);
 }
 
 // morton_1 - extract even bits
 
 inline u32 morton_1(u64 x)
 {
+#if defined(__BMI2__)
+    return (u32)_pext_u64(x, 0x5555555555555555);
+#else
     x = x & 0x5555555555555555;
     x = (x | (x >> 1))  & 0x3333333333333333;
     x = (x | (x >> 2))  & 0x0F0F0F0F0F0F0F0F;
@@ -405,6 +585,7 @@ inline u32 morton_1(u64 x)
     x = (x | (x >> 8))  & 0x0000FFFF0000FFFF;
     x = (x | (x >> 16)) & 0x00000000FFFFFFFF;
     return (uint32_t)x;
+#endif
 }
 
 inline void morton_d2xy(u64 d, u64 &x, u64 &y)
@@ -413,6 +594,161 @@ inline void morton_d2xy(u64 d, u64 &x, u64 &y)
     y = morton_1(d >> 1);
 }
 
+// morton_spread3 - spread the low 21 bits of x into every third bit
+
+inline u64 morton_spread3(u64 x)
+{
+#if defined(__BMI2__)
+    return _pdep_u64(x, 0x1249249249249249);
+#else
+    x &= 0x00000000001FFFFF;
+    x = (x | (x << 32)) & 0x001F00000000FFFF;
+    x = (x | (x << 16)) & 0x001F0000FF0000FF;
+    x = (x | (x << 8))  & 0x100F00F00F00F00F;
+    x = (x | (x << 4))  & 0x10C30C30C30C30C3;
+    x = (x | (x << 2))  & 0x1249249249249249;
+    return x;
+#endif
+}
+
+// morton_3 - extract every third bit
+
+inline u32 morton_3(u64 x)
+{
+#if defined(__BMI2__)
+    return (u32)_pext_u64(x, 0x1249249249249249);
+#else
+    x &= 0x1249249249249249;
+    x = (x | (x >> 2))  & 0x10C30C30C30C30C3;
+    x = (x | (x >> 4))  & 0x100F00F00F00F00F;
+    x = (x | (x >> 8))  & 0x001F0000FF0000FF;
+    x = (x | (x >> 16)) & 0x001F00000000FFFF;
+    x = (x | (x >> 32)) & 0x00000000001FFFFF;
+    return (u32)x;
+#endif
+}
+
+// 3d morton code with 21 bits per axis, x in the lowest bit
+
+inline void morton_xyz3d(u64 x, u64 y, u64 z, u64 *d)
+{
+    *d = morton_spread3(x) | (morton_spread3(y) << 1) | (morton_spread3(z) << 2);
+}
+
+inline void morton_d2xyz(u64 d, u64 &x, u64 &y, u64 &z)
+{
+    x = morton_3(d);
+    y = morton_3(d >> 1);
+    z = morton_3(d >> 2);
+}
+
+// hilbert curve indices via skilling's transform ("programming the hilbert curve", 2004). the coordinates are
+// converted in place to the transposed index, interleaving the transposed bits gives the index with axis 0 most
+// significant. bits is the number of bits per axis, consecutive indices are always neighbouring cells.
+
+template <size_t N>
+inline void hilbert_axes_to_transpose(u32 (&x)[N], u32 bits)
+{
+    u32 m = 1u << (bits - 1);
+
+    // inverse undo
+    for (u32 q = m; q > 1; q >>= 1)
+    {
+        u32 p = q - 1;
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (x[i] & q)
+            {
+                x[0] ^= p;
+            }
+            else
+            {
+                u32 t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    // gray encode
+    for (size_t i = 1; i < N; ++i)
+        x[i] ^= x[i - 1];
+
+    u32 t = 0;
+    for (u32 q = m; q > 1; q >>= 1)
+        if (x[N - 1] & q)
+            t ^= q - 1;
+
+    for (size_t i = 0; i < N; ++i)
+        x[i] ^= t;
+}
+
+template <size_t N>
+inline void hilbert_transpose_to_axes(u32 (&x)[N], u32 bits)
+{
+    u64 n = (u64)2 << (bits - 1);
+
+    // gray decode
+    u32 t = x[N - 1] >> 1;
+    for (size_t i = N - 1; i > 0; --i)
+        x[i] ^= x[i - 1];
+    x[0] ^= t;
+
+    // undo excess work
+    for (u64 q = 2; q != n; q <<= 1)
+    {
+        u32 p = (u32)q - 1;
+        for (size_t i = N; i-- > 0;)
+        {
+            if (x[i] & q)
+            {
+                x[0] ^= p;
+            }
+            else
+            {
+                t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+}
+
+// 2d hilbert index of x, y with bits per axis (up to 32)
+
+inline void hilbert_xy2d(u64 x, u64 y, u64 *d, u32 bits = 32)
+{
+    u32 h[2] = {(u32)x, (u32)y};
+    hilbert_axes_to_transpose(h, bits);
+    *d = (morton_spread2(h[0]) << 1) | morton_spread2(h[1]);
+}
+
+inline void hilbert_d2xy(u64 d, u64 &x, u64 &y, u32 bits = 32)
+{
+    u32 h[2] = {morton_1(d >> 1), morton_1(d)};
+    hilbert_transpose_to_axes(h, bits);
+    x = h[0];
+    y = h[1];
+}
+
+// 3d hilbert index of x, y, z with bits per axis (up to 21)
+
+inline void hilbert_xyz3d(u64 x, u64 y, u64 z, u64 *d, u32 bits = 21)
+{
+    u32 h[3] = {(u32)x, (u32)y, (u32)z};
+    hilbert_axes_to_transpose(h, bits);
+    *d = (morton_spread3(h[0]) << 2) | (morton_spread3(h[1]) << 1) | morton_spread3(h[2]);
+}
+
+inline void hilbert_d2xyz(u64 d, u64 &x, u64 &y, u64 &z, u32 bits = 21)
+{
+    u32 h[3] = {morton_3(d >> 2), morton_3(d >> 1), morton_3(d)};
+    hilbert_transpose_to_axes(h, bits);
+    x = h[0];
+    y = h[1];
+    z = h[2];
+}
+
 inline int intlog2(int x)
 {
     int exp = -1;
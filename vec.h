@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <type_traits>
 
 #ifdef WIN32
 #undef min
@@ -1115,12 +1116,26 @@ maths_inline T triple(const Vec<3, T>& a, const Vec<3, T>& b, const Vec<3, T>& c
            a.v[2] * (b.v[0] * c.v[1] - b.v[1] * c.v[0]);
 }
 
+// 64 bit integer mix (murmur3 finaliser)
+maths_inline size_t hash(size_t h)
+{
+    unsigned long long x = h;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+// integer vectors only, ie. grid coordinates. float components would be truncated (and negative ones undefined)
 template <size_t N, typename T>
 maths_inline size_t hash(const Vec<N, T>& a)
 {
-    size_t h = a.v[0];
+    static_assert(std::is_integral<T>::value, "error: hash requires integer vector components");
+    size_t h = hash((size_t)a.v[0]);
     for (size_t i = 1; i < N; ++i)
-        h = hash(h ^ a.v[i]);
+        h = hash(h ^ (size_t)a.v[i]);
     return h;
 }
 
@@ -0,0 +1,646 @@
+// voxel.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <unordered_map>
+#include <vector>
+
+// uniform grid traversal for rays in 2d and 3d (amanatides and woo 1987). the ray is first clipped to the grid with
+// ray_vs_aabb, then steps exactly one cell at a time across whichever cell boundary it reaches next, so every cell the
+// ray passes through is visited once, in order, with the ray parameter t where it enters and leaves the cell.
+// sparse grids store 8x8x8 blocks of voxels in a hash map keyed by block coordinate, only blocks which are written to
+// (or lie within the narrow band of a surface) take memory. voxel i sits at origin + i * voxel_size, blocks which were
+// never allocated read as a per block tile value or the grid background.
+
+namespace maths
+{
+    constexpr u32 k_voxel_block_log2 = 3;
+    constexpr int k_voxel_block_size = 1 << k_voxel_block_log2;
+    constexpr u32 k_voxel_block_voxels = k_voxel_block_size * k_voxel_block_size * k_voxel_block_size;
+    constexpr u32 k_voxel_invalid_block = 0xffffffff;
+
+    // dims cells of cell_size starting at origin, the min corner of cell 0
+    template <size_t N>
+    struct uniform_grid
+    {
+        Vec<N, f32> origin;
+        Vec<N, f32> cell_size;
+        Vec<N, int> dims;
+    };
+
+    typedef uniform_grid<2> uniform_grid2;
+    typedef uniform_grid<3> uniform_grid3;
+
+    // walks the cells of a uniform_grid along the ray r1 + rv * t for t in [0, max_t]
+    //  for (grid_ray3 it(grid, r1, rv); it.valid(); it.next())
+    //      visit(it.cell(), it.t_entry(), it.t_exit());
+    template <size_t N>
+    class grid_ray
+    {
+    public:
+        typedef Vec<N, f32> vec_t;
+        typedef Vec<N, int> cell_t;
+
+        grid_ray() = default;
+
+        grid_ray(const uniform_grid<N>& grid, const vec_t& r1, const vec_t& rv, f32 max_t = FLT_MAX)
+        {
+            init(grid, r1, rv, max_t);
+        }
+
+        // returns false if the ray misses the grid within max_t
+        bool init(const uniform_grid<N>& grid, const vec_t& r1, const vec_t& rv, f32 max_t = FLT_MAX)
+        {
+            _valid = false;
+            _dims = grid.dims;
+            _max_t = max_t;
+
+            f32 len2 = dot(rv, rv);
+            if (len2 == 0.0f)
+                return false;
+
+            // 2d grids are clipped as a slab of unit depth
+            vec3f emin = vec3f(-1.0f), emax = vec3f(1.0f), o = vec3f(0.0f), d = vec3f(0.0f);
+            for (u32 i = 0; i < N; ++i)
+            {
+                if (grid.dims[i] <= 0)
+                    return false;
+
+                emin[i] = grid.origin[i];
+                emax[i] = grid.origin[i] + grid.cell_size[i] * (f32)grid.dims[i];
+                o[i] = r1[i];
+                d[i] = rv[i];
+            }
+
+            vec3f ip;
+            if (!ray_vs_aabb(emin, emax, o, d, ip))
+                return false;
+
+            // ip is the entry point of the infinite line, which is behind r1 when r1 is inside the grid
+            f32 t = 0.0f;
+            for (u32 i = 0; i < N; ++i)
+                t += (ip[i] - r1[i]) * rv[i];
+            t = max(t / len2, 0.0f);
+            if (t > max_t)
+                return false;
+
+            for (u32 i = 0; i < N; ++i)
+            {
+                f32 p = r1[i] + rv[i] * t;
+                _cell[i] = clamp((int)floor((p - grid.origin[i]) / grid.cell_size[i]), 0, _dims[i] - 1);
+
+                if (rv[i] > 0.0f)
+                {
+                    _step[i] = 1;
+                    _t_next[i] = (grid.origin[i] + grid.cell_size[i] * (f32)(_cell[i] + 1) - r1[i]) / rv[i];
+                    _t_delta[i] = grid.cell_size[i] / rv[i];
+                }
+                else if (rv[i] < 0.0f)
+                {
+                    _step[i] = -1;
+                    _t_next[i] = (grid.origin[i] + grid.cell_size[i] * (f32)_cell[i] - r1[i]) / rv[i];
+                    _t_delta[i] = -grid.cell_size[i] / rv[i];
+                }
+                else
+                {
+                    _step[i] = 0;
+                    _t_next[i] = FLT_MAX;
+                    _t_delta[i] = FLT_MAX;
+                }
+            }
+
+            _t_entry = t;
+            _t_exit = min(min_t_next(), _max_t);
+            _valid = true;
+            return true;
+        }
+
+        bool valid() const
+        {
+            return _valid;
+        }
+
+        const cell_t& cell() const
+        {
+            return _cell;
+        }
+
+        f32 t_entry() const
+        {
+            return _t_entry;
+        }
+
+        f32 t_exit() const
+        {
+            return _t_exit;
+        }
+
+        // steps into the next cell, the iterator becomes invalid when the ray leaves the grid or passes max_t
+        void next()
+        {
+            u32 axis = 0;
+            for (u32 i = 1; i < N; ++i)
+                if (_t_next[i] < _t_next[axis])
+                    axis = i;
+
+            _t_entry = _t_next[axis];
+            _cell[axis] += _step[axis];
+            if (_t_entry >= _max_t || _cell[axis] < 0 || _cell[axis] >= _dims[axis])
+            {
+                _valid = false;
+                return;
+            }
+
+            _t_next[axis] += _t_delta[axis];
+            _t_exit = min(min_t_next(), _max_t);
+        }
+
+    private:
+        f32 min_t_next() const
+        {
+            f32 t = _t_next[0];
+            for (u32 i = 1; i < N; ++i)
+                t = min(t, _t_next[i]);
+            return t;
+        }
+
+        cell_t _cell;
+        cell_t _step;
+        cell_t _dims;
+        vec_t  _t_next;  // t at which the ray crosses the next boundary on each axis
+        vec_t  _t_delta; // t to cross a whole cell on each axis
+        f32    _t_entry = 0.0f;
+        f32    _t_exit = 0.0f;
+        f32    _max_t = FLT_MAX;
+        bool   _valid = false;
+    };
+
+    typedef grid_ray<2> grid_ray2;
+    typedef grid_ray<3> grid_ray3;
+
+    // calls visit(cell, t_entry, t_exit) for each cell on the ray in order, stops early if visit returns false.
+    // returns false if visit stopped the walk.
+    template <size_t N, class Visit>
+    inline bool grid_raycast(const uniform_grid<N>& grid, const Vec<N, f32>& r1, const Vec<N, f32>& rv, f32 max_t,
+                             Visit visit)
+    {
+        for (grid_ray<N> it(grid, r1, rv, max_t); it.valid(); it.next())
+            if (!visit(it.cell(), it.t_entry(), it.t_exit()))
+                return false;
+        return true;
+    }
+
+    // appends the cells the ray passes through in order
+    template <size_t N>
+    inline void grid_ray_cells(const uniform_grid<N>& grid, const Vec<N, f32>& r1, const Vec<N, f32>& rv, f32 max_t,
+                               std::vector<Vec<N, int>>& cells_out)
+    {
+        for (grid_ray<N> it(grid, r1, rv, max_t); it.valid(); it.next())
+            cells_out.push_back(it.cell());
+    }
+
+    // true if no cell on the segment a-b is blocked, blocked(cell) is called for the cells in order from a
+    template <size_t N, class Blocked>
+    inline bool grid_line_of_sight(const uniform_grid<N>& grid, const Vec<N, f32>& a, const Vec<N, f32>& b,
+                                   Blocked blocked)
+    {
+        return grid_raycast(grid, a, b - a, 1.0f,
+                            [&](const Vec<N, int>& cell, f32, f32) { return !blocked(cell); });
+    }
+
+    struct vec_hash
+    {
+        template <size_t N, class T>
+        size_t operator()(const Vec<N, T>& v) const
+        {
+            return hash(v);
+        }
+    };
+
+    // coordinate of the block containing voxel, floors for negative voxels
+    inline vec3i voxel_block(const vec3i& voxel)
+    {
+        return vec3i(voxel.x >> k_voxel_block_log2, voxel.y >> k_voxel_block_log2, voxel.z >> k_voxel_block_log2);
+    }
+
+    // index of voxel inside its block, x varies fastest
+    inline u32 voxel_block_offset(const vec3i& voxel)
+    {
+        const int m = k_voxel_block_size - 1;
+        return (u32)((voxel.x & m) | (voxel.y & m) << k_voxel_block_log2 | (voxel.z & m) << (k_voxel_block_log2 * 2));
+    }
+
+    // voxel at offset inside block
+    inline vec3i voxel_from_block(const vec3i& block, u32 offset)
+    {
+        const u32 m = k_voxel_block_size - 1;
+        return block * k_voxel_block_size + vec3i((int)(offset & m), (int)((offset >> k_voxel_block_log2) & m),
+                                                  (int)(offset >> (k_voxel_block_log2 * 2)));
+    }
+
+    // blocks stored contiguously with a hash map from block coordinate to block index
+    template <class Block>
+    class sparse_blocks
+    {
+    public:
+        u32 find(const vec3i& coord) const
+        {
+            auto it = _lookup.find(coord);
+            return it == _lookup.end() ? k_voxel_invalid_block : it->second;
+        }
+
+        // returns the index of the block at coord, inserting a copy of init if it did not exist
+        u32 insert(const vec3i& coord, const Block& init, bool* inserted = nullptr)
+        {
+            auto r = _lookup.insert(std::make_pair(coord, (u32)_blocks.size()));
+            if (r.second)
+            {
+                _coords.push_back(coord);
+                _blocks.push_back(init);
+            }
+            if (inserted)
+                *inserted = r.second;
+            return r.first->second;
+        }
+
+        void clear()
+        {
+            _coords.clear();
+            _blocks.clear();
+            _lookup.clear();
+        }
+
+        size_t size() const
+        {
+            return _blocks.size();
+        }
+
+        const vec3i& coord(size_t i) const
+        {
+            return _coords[i];
+        }
+
+        Block& operator[](size_t i)
+        {
+            return _blocks[i];
+        }
+
+        const Block& operator[](size_t i) const
+        {
+            return _blocks[i];
+        }
+
+    private:
+        std::vector<vec3i>                        _coords;
+        std::vector<Block>                        _blocks;
+        std::unordered_map<vec3i, u32, vec_hash> _lookup;
+    };
+
+    // sparse grid of T values (ie. f32 signed distance), sampled with trilerp
+    template <class T>
+    class sparse_grid
+    {
+    public:
+        struct block
+        {
+            T values[k_voxel_block_voxels];
+        };
+
+        class const_iterator
+        {
+        public:
+            const_iterator(const sparse_grid* grid, size_t block, u32 offset) : _grid(grid), _block(block), _offset(offset)
+            {
+            }
+
+            vec3i voxel() const
+            {
+                return voxel_from_block(_grid->_blocks.coord(_block), _offset);
+            }
+
+            const T& value() const
+            {
+                return _grid->_blocks[_block].values[_offset];
+            }
+
+            const T& operator*() const
+            {
+                return value();
+            }
+
+            const_iterator& operator++()
+            {
+                if (++_offset == k_voxel_block_voxels)
+                {
+                    _offset = 0;
+                    ++_block;
+                }
+                return *this;
+            }
+
+            bool operator==(const const_iterator& other) const
+            {
+                return _block == other._block && _offset == other._offset;
+            }
+
+            bool operator!=(const const_iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            const sparse_grid* _grid;
+            size_t             _block;
+            u32                _offset;
+        };
+
+        void init(const vec3f& origin, f32 voxel_size, const T& background)
+        {
+            _origin = origin;
+            _voxel_size = voxel_size;
+            _background = background;
+            clear();
+        }
+
+        void clear()
+        {
+            _blocks.clear();
+            _tiles.clear();
+        }
+
+        const vec3f& origin() const
+        {
+            return _origin;
+        }
+
+        f32 voxel_size() const
+        {
+            return _voxel_size;
+        }
+
+        const T& background() const
+        {
+            return _background;
+        }
+
+        vec3f voxel_to_world(const vec3i& voxel) const
+        {
+            return _origin + vec3f((f32)voxel.x, (f32)voxel.y, (f32)voxel.z) * _voxel_size;
+        }
+
+        // continuous voxel coordinate of a world position
+        vec3f world_to_voxel(const vec3f& p) const
+        {
+            return (p - _origin) / _voxel_size;
+        }
+
+        // value at voxel, unallocated voxels return their block tile or the background
+        T get(const vec3i& voxel) const
+        {
+            vec3i bc = voxel_block(voxel);
+            u32   b = _blocks.find(bc);
+            if (b != k_voxel_invalid_block)
+                return _blocks[b].values[voxel_block_offset(voxel)];
+            return tile(bc);
+        }
+
+        // writes a voxel, allocating its block if needed
+        void set(const vec3i& voxel, const T& value)
+        {
+            touch_block(voxel_block(voxel)).values[voxel_block_offset(voxel)] = value;
+        }
+
+        // the block at block coordinate bc, allocated and filled with its tile value (or background) if needed
+        block& touch_block(const vec3i& bc)
+        {
+            u32 b = _blocks.find(bc);
+            if (b != k_voxel_invalid_block)
+                return _blocks[b];
+
+            block init;
+            T     fill = tile(bc);
+            for (u32 i = 0; i < k_voxel_block_voxels; ++i)
+                init.values[i] = fill;
+
+            _tiles.erase(bc);
+            return _blocks[_blocks.insert(bc, init)];
+        }
+
+        // sets a constant value for a whole unallocated block, ie. the inside of a narrow band sdf
+        void set_tile(const vec3i& bc, const T& value)
+        {
+            u32 b = _blocks.find(bc);
+            if (b != k_voxel_invalid_block)
+            {
+                for (u32 i = 0; i < k_voxel_block_voxels; ++i)
+                    _blocks[b].values[i] = value;
+                return;
+            }
+            _tiles[bc] = value;
+        }
+
+        T tile(const vec3i& bc) const
+        {
+            auto it = _tiles.find(bc);
+            return it == _tiles.end() ? _background : it->second;
+        }
+
+        // trilinear sample at world position p, the 8 voxels come from a single block lookup when they share a block
+        T sample(const vec3f& p) const
+        {
+            vec3f g = world_to_voxel(p);
+            vec3f f = vec3f(floor(g.x), floor(g.y), floor(g.z));
+            vec3i v = vec3i((int)f.x, (int)f.y, (int)f.z);
+            f = g - f;
+
+            T         c[8];
+            const int m = k_voxel_block_size - 1;
+            if ((v.x & m) != m && (v.y & m) != m && (v.z & m) != m)
+            {
+                vec3i bc = voxel_block(v);
+                u32   b = _blocks.find(bc);
+                u32   o = voxel_block_offset(v);
+                if (b == k_voxel_invalid_block)
+                    return tile(bc);
+
+                const T*  values = _blocks[b].values;
+                const u32 dy = k_voxel_block_size;
+                const u32 dz = k_voxel_block_size * k_voxel_block_size;
+                c[0] = values[o];
+                c[1] = values[o + 1];
+                c[2] = values[o + dy];
+                c[3] = values[o + dy + 1];
+                c[4] = values[o + dz];
+                c[5] = values[o + dz + 1];
+                c[6] = values[o + dz + dy];
+                c[7] = values[o + dz + dy + 1];
+            }
+            else
+            {
+                for (u32 i = 0; i < 8; ++i)
+                    c[i] = get(v + vec3i((int)(i & 1), (int)((i >> 1) & 1), (int)(i >> 2)));
+            }
+
+            return trilerp(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], f.x, f.y, f.z);
+        }
+
+        // allocates only the blocks within band of the surface of sdf(world_pos) over aabb_min-aabb_max and stores
+        // distances clamped to +-band. blocks further outside read as the background (set to band), blocks further
+        // inside become tiles of -band. sdf must not overestimate distance or thin features can be missed.
+        template <class SDF>
+        void fill_narrow_band(SDF sdf, const vec3f& aabb_min, const vec3f& aabb_max, T band)
+        {
+            _background = band;
+
+            vec3f gmin = world_to_voxel(aabb_min);
+            vec3f gmax = world_to_voxel(aabb_max);
+            vec3i bmin = voxel_block(vec3i((int)floor(gmin.x), (int)floor(gmin.y), (int)floor(gmin.z)));
+            vec3i bmax = voxel_block(vec3i((int)ceil(gmax.x), (int)ceil(gmax.y), (int)ceil(gmax.z)));
+
+            // distance from a block centre to its furthest voxel
+            const f32 half = (f32)(k_voxel_block_size - 1) * 0.5f;
+            const T   radius = (T)(half * sqrt(3.0f) * _voxel_size);
+
+            for (int z = bmin.z; z <= bmax.z; ++z)
+            {
+                for (int y = bmin.y; y <= bmax.y; ++y)
+                {
+                    for (int x = bmin.x; x <= bmax.x; ++x)
+                    {
+                        vec3i bc = vec3i(x, y, z);
+                        vec3f centre = voxel_to_world(bc * k_voxel_block_size) + vec3f(half * _voxel_size);
+                        T     d = sdf(centre);
+                        if (d > band + radius)
+                            continue;
+
+                        if (d < -(band + radius))
+                        {
+                            set_tile(bc, -band);
+                            continue;
+                        }
+
+                        block& blk = touch_block(bc);
+                        for (u32 i = 0; i < k_voxel_block_voxels; ++i)
+                            blk.values[i] = clamp(sdf(voxel_to_world(voxel_from_block(bc, i))), -band, band);
+                    }
+                }
+            }
+        }
+
+        size_t block_count() const
+        {
+            return _blocks.size();
+        }
+
+        const vec3i& block_coord(size_t i) const
+        {
+            return _blocks.coord(i);
+        }
+
+        const block& block_data(size_t i) const
+        {
+            return _blocks[i];
+        }
+
+        // iterates every voxel of the allocated blocks
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, _blocks.size(), 0);
+        }
+
+    private:
+        sparse_blocks<block>                    _blocks;
+        std::unordered_map<vec3i, T, vec_hash> _tiles;
+        vec3f                                   _origin = vec3f(0.0f);
+        f32                                     _voxel_size = 1.0f;
+        T                                       _background = T(0);
+    };
+
+    typedef sparse_grid<f32> sparse_gridf;
+
+    // sparse grid of occupancy bits, 64 bytes per block
+    class sparse_bit_grid
+    {
+    public:
+        struct block
+        {
+            u64 bits[k_voxel_block_voxels / 64];
+        };
+
+        void clear()
+        {
+            _blocks.clear();
+        }
+
+        bool get(const vec3i& voxel) const
+        {
+            u32 b = _blocks.find(voxel_block(voxel));
+            if (b == k_voxel_invalid_block)
+                return false;
+
+            u32 o = voxel_block_offset(voxel);
+            return (_blocks[b].bits[o >> 6] >> (o & 63)) & 1;
+        }
+
+        // setting a voxel allocates its block, clearing one does not
+        void set(const vec3i& voxel, bool occupied = true)
+        {
+            vec3i bc = voxel_block(voxel);
+            u32   b = _blocks.find(bc);
+            if (b == k_voxel_invalid_block)
+            {
+                if (!occupied)
+                    return;
+                b = _blocks.insert(bc, block());
+            }
+
+            u32  o = voxel_block_offset(voxel);
+            u64& word = _blocks[b].bits[o >> 6];
+            if (occupied)
+                word |= 1ull << (o & 63);
+            else
+                word &= ~(1ull << (o & 63));
+        }
+
+        // calls f(voxel) for every occupied voxel
+        template <class F>
+        void for_each(F f) const
+        {
+            for (size_t b = 0; b < _blocks.size(); ++b)
+            {
+                for (u32 w = 0; w < k_voxel_block_voxels / 64; ++w)
+                {
+                    u64 word = _blocks[b].bits[w];
+                    for (u32 i = 0; word; ++i, word >>= 1)
+                        if (word & 1)
+                            f(voxel_from_block(_blocks.coord(b), w * 64 + i));
+                }
+            }
+        }
+
+        // number of occupied voxels
+        size_t count() const
+        {
+            size_t n = 0;
+            for_each([&](const vec3i&) { ++n; });
+            return n;
+        }
+
+        size_t block_count() const
+        {
+            return _blocks.size();
+        }
+
+    private:
+        sparse_blocks<block> _blocks;
+    };
+} // namespace maths